@@ -0,0 +1,180 @@
+#include "freefall_atmosphere.h"
+#include "freefall_sim_engine.h"
+#include "freefall_demo_profiles.h"
+#include <benchmark/benchmark.h>
+#include <random>
+
+namespace
+{
+    FreeFallSim::FreeFallSimulationProfile make_drop_profile(double height)
+    {
+        auto freefall_sim_vars = FreeFallSim::make_demo_sim_vars();
+        freefall_sim_vars.position = height;
+        freefall_sim_vars.time_step = 0.001;
+        freefall_sim_vars.sampling = FreeFallSim::SamplingProfile::TimeInterval;
+        return freefall_sim_vars;
+    }
+
+    // Heights spread over [0, top] in random order, as many as a lookup batch
+    std::vector<double> make_heights(double top)
+    {
+        std::mt19937_64 generator{2024};
+        std::uniform_real_distribution<double> height{0.0, top};
+        std::vector<double> heights(4096);
+        for (auto& value : heights)
+            value = height(generator);
+        return heights;
+    }
+
+    double newton_gravity(const FreeFallSim::FreeFallSimulationProfile& sim_vars, double position)
+    {
+        const auto distance = sim_vars.kRadiusOfPlanet + position;
+        return sim_vars.kUniversalGravitationConst * sim_vars.kMassOfPlanet / (distance * distance);
+    }
+
+    // Largest relative error of table against exact over the heights
+    template <typename Exact>
+    double max_relative_error(const FreeFallSim::FreeFallUniformTable& table, const std::vector<double>& heights, Exact&& exact)
+    {
+        double max_error{0.0};
+        for (const auto height : heights)
+            max_error = std::max(max_error, std::abs(table(height) / exact(height) - 1.0));
+        return max_error;
+    }
+
+    void set_lookup_counters(benchmark::State& state, std::size_t lookups)
+    {
+        state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * lookups));
+        state.counters["time_per_lookup"] = benchmark::Counter(static_cast<double>(lookups),
+            benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+    }
+
+    // rho(x) straight from us_standard_atmosphere_density(), the "before" reference of the drag policy
+    struct DirectStandardAtmosphereDragPolicy
+    {
+        struct Coefficients
+        {
+            double drag_area_per_mass;      // (Cd*pi*r^2/m) m^2/kg
+        };
+        static Coefficients prepare(const FreeFallSim::FreeFallObjProfile& sim_obj_profile, const FreeFallSim::FreeFallSimulationProfile&)
+        {
+            return {sim_obj_profile.kDragCoefficient * M_PI * sim_obj_profile.radius_of_object * sim_obj_profile.radius_of_object /
+                sim_obj_profile.mass_of_object};
+        }
+        static double acceleration(const Coefficients& coefficients, double position, double velocity)
+        {
+            return coefficients.drag_area_per_mass * FreeFallSim::us_standard_atmosphere_density(position) * velocity * velocity;
+        }
+        static double terminal_velocity(const Coefficients& coefficients, double position, double gravity)
+        {
+            return std::sqrt(gravity / (coefficients.drag_area_per_mass * FreeFallSim::us_standard_atmosphere_density(position)));
+        }
+    };
+
+    using FreeFallDirectAtmosphereSimlation = FreeFallSim::SimEngine<FreeFallSim::NewtonGravityPolicy, DirectStandardAtmosphereDragPolicy,
+        FreeFallSim::ProfileSelectedIntegrator, FreeFallSim::ProfileSelectedSampler>;
+}
+
+// Accuracy against cost of the lookups, the argument is the fitted tolerance as 10^-arg.
+//   time_per_lookup  wall time per height, shown in ns
+//   max_rel_error    largest relative error over the batch against direct evaluation
+//   table_kib        memory of the table
+static void BM_DensityDirect(benchmark::State& state)
+{
+    const auto heights = make_heights(FreeFallSim::kStandardAtmosphereTop);
+    std::vector<double> densities(heights.size());
+    for (auto _ : state)
+    {
+        for (std::size_t i = 0; i < heights.size(); ++i)
+            densities[i] = FreeFallSim::us_standard_atmosphere_density(heights[i]);
+        benchmark::DoNotOptimize(densities.data());
+    }
+    set_lookup_counters(state, heights.size());
+}
+
+static void BM_DensityTable(benchmark::State& state)
+{
+    const auto heights = make_heights(FreeFallSim::kStandardAtmosphereTop);
+    // fitted like standard_atmosphere_density_table(), on geopotential heights with the layer boundaries on the grid
+    const auto table = FreeFallSim::FreeFallUniformTable::fit(FreeFallSim::us_standard_atmosphere_density_geopotential, 0.0,
+        FreeFallSim::kStandardAtmosphereTop, std::pow(10.0, -static_cast<double>(state.range(0))),
+        static_cast<std::size_t>(FreeFallSim::kStandardAtmosphereTop / 1000.0));
+    std::vector<double> geopotentials(heights.size());
+    std::vector<double> densities(heights.size());
+    for (auto _ : state)
+    {
+        for (std::size_t i = 0; i < heights.size(); ++i)
+            geopotentials[i] = FreeFallSim::geopotential_height(heights[i]);
+        table.evaluate(geopotentials.data(), densities.data(), geopotentials.size());
+        benchmark::DoNotOptimize(densities.data());
+    }
+    set_lookup_counters(state, heights.size());
+    std::vector<double> table_heights(heights.size());
+    for (std::size_t i = 0; i < heights.size(); ++i)
+        table_heights[i] = FreeFallSim::geopotential_height(heights[i]);
+    state.counters["max_rel_error"] = max_relative_error(table, table_heights, FreeFallSim::us_standard_atmosphere_density_geopotential);
+    state.counters["table_kib"] = static_cast<double>(table.size_bytes()) / 1024.0;
+}
+
+static void BM_GravityDirect(benchmark::State& state)
+{
+    const auto sim_vars = make_drop_profile(40000.0);
+    const auto heights = make_heights(sim_vars.position);
+    std::vector<double> gravities(heights.size());
+    for (auto _ : state)
+    {
+        for (std::size_t i = 0; i < heights.size(); ++i)
+            gravities[i] = newton_gravity(sim_vars, heights[i]);
+        benchmark::DoNotOptimize(gravities.data());
+    }
+    set_lookup_counters(state, heights.size());
+}
+
+static void BM_GravityTable(benchmark::State& state)
+{
+    const auto sim_vars = make_drop_profile(40000.0);
+    const auto heights = make_heights(sim_vars.position);
+    const auto table = FreeFallSim::make_newton_gravity_table(sim_vars, sim_vars.position, std::pow(10.0, -static_cast<double>(state.range(0))));
+    std::vector<double> gravities(heights.size());
+    for (auto _ : state)
+    {
+        table.evaluate(heights.data(), gravities.data(), heights.size());
+        benchmark::DoNotOptimize(gravities.data());
+    }
+    set_lookup_counters(state, heights.size());
+    state.counters["max_rel_error"] = max_relative_error(table, heights, [&sim_vars](double height) { return newton_gravity(sim_vars, height); });
+    state.counters["table_kib"] = static_cast<double>(table.size_bytes()) / 1024.0;
+}
+
+BENCHMARK(BM_DensityDirect);
+BENCHMARK(BM_DensityTable)->ArgName("tolerance_exp")->Arg(4)->Arg(6)->Arg(8);
+BENCHMARK(BM_GravityDirect);
+BENCHMARK(BM_GravityTable)->ArgName("tolerance_exp")->Arg(6)->Arg(10)->Arg(12);
+
+// Whole runs through the standard atmosphere, the argument is the drop height in m.
+//   time_per_step    wall time per integration step, shown in ns
+//   impact_speed     speed at the ground, compares the accuracy of the tabulated models with direct evaluation
+template <typename Simulation>
+static void BM_AtmosphereRunSim(benchmark::State& state)
+{
+    const auto freefall_sim_obj = FreeFallSim::make_demo_ball_profile();
+    const auto freefall_sim_vars = make_drop_profile(static_cast<double>(state.range(0)));
+    std::uint64_t steps{0};
+    double impact_speed{0.0};
+    for (auto _ : state)
+    {
+        Simulation sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+        const auto sim_plot_vars = sim.run_sim();
+        steps = sim_plot_vars.integrator_stats.steps_taken;
+        impact_speed = -sim_plot_vars.velocity_data.back();
+        benchmark::DoNotOptimize(sim_plot_vars.position_data.data());
+    }
+    state.counters["time_per_step"] = benchmark::Counter(static_cast<double>(steps),
+        benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+    state.counters["impact_speed"] = impact_speed;
+}
+
+BENCHMARK_TEMPLATE(BM_AtmosphereRunSim, FreeFallSim::FreeFallNewtonGravitySimlation)->ArgName("height_m")->Arg(30000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_AtmosphereRunSim, FreeFallDirectAtmosphereSimlation)->ArgName("height_m")->Arg(30000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_AtmosphereRunSim, FreeFallSim::FreeFallNewtonAtmosphereSimlation)->ArgName("height_m")->Arg(30000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_AtmosphereRunSim, FreeFallSim::FreeFallTabulatedAtmosphereSimlation)->ArgName("height_m")->Arg(30000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,63 @@
+#include "freefall_ensemble_simulation.h"
+#include "freefall_demo_profiles.h"
+#include <benchmark/benchmark.h>
+#include <random>
+
+namespace
+{
+    // 4096 balls of random mass dropped from random heights up to 1 km, dt 1 ms
+    FreeFallSim::FreeFallEnsembleProfiles make_ensemble_profiles()
+    {
+        auto freefall_sim_obj = FreeFallSim::make_demo_ball_profile();
+        auto freefall_sim_vars = FreeFallSim::make_demo_sim_vars();
+        freefall_sim_vars.time_step = 0.001;
+        freefall_sim_vars.sample_factor = 1;
+        freefall_sim_vars.locate_impact = false;
+
+        std::mt19937_64 generator{2024};
+        std::uniform_real_distribution<double> height{10.0, 1000.0};
+        std::uniform_real_distribution<double> mass{0.03, 0.6};
+        FreeFallSim::FreeFallEnsembleProfiles profiles;
+        for (int i = 0; i < 4096; ++i)
+        {
+            freefall_sim_obj.mass_of_object = mass(generator);
+            freefall_sim_vars.position = height(generator);
+            profiles.emplace_back(freefall_sim_obj, freefall_sim_vars);
+        }
+        return profiles;
+    }
+
+    // Object steps per second of the double engine and of the float engine with and without compensation
+    template <typename Ensemble>
+    void BM_EnsemblePrecision(benchmark::State& state)
+    {
+        const auto profiles = make_ensemble_profiles();
+        Ensemble ensemble{FreeFallSim::GravityProfile::ConstantGravity, state.range(0) != 0};
+        for (const auto& [obj, vars] : profiles)
+            ensemble.add_object(obj, vars);
+        std::uint64_t object_steps{0};
+        for (auto _ : state)
+        {
+            const auto result = ensemble.run_sim();
+            object_steps += result.total_object_steps;
+            benchmark::DoNotOptimize(result.impact_time.data());
+        }
+        state.SetItemsProcessed(static_cast<std::int64_t>(object_steps));
+        state.counters["lanes"] = Ensemble::simd_lanes();
+    }
+    BENCHMARK_TEMPLATE(BM_EnsemblePrecision, FreeFallSim::FreeFallEnsembleSimulation)->ArgName("compensated")->Arg(0)->Unit(benchmark::kMillisecond);
+    BENCHMARK_TEMPLATE(BM_EnsemblePrecision, FreeFallSim::FreeFallFloatEnsembleSimulation)->ArgName("compensated")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+    // Error of the float engine against the double engine over the standard profiles, reported as counters
+    void BM_FloatEnsembleError(benchmark::State& state)
+    {
+        const auto profiles = FreeFallSim::standard_precision_profiles();
+        FreeFallSim::FreeFallPrecisionError error;
+        for (auto _ : state)
+            error = FreeFallSim::measure_float_ensemble_error(FreeFallSim::GravityProfile::NewtonGravitationModel, profiles, state.range(0) != 0);
+        state.counters["max_time_error"] = error.max_impact_time_error;
+        state.counters["max_velocity_error"] = error.max_impact_velocity_error;
+        state.counters["max_step_difference"] = static_cast<double>(error.max_impact_step_difference);
+    }
+    BENCHMARK(BM_FloatEnsembleError)->ArgName("compensated")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->Iterations(1);
+}
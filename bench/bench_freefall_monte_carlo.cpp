@@ -0,0 +1,90 @@
+#include "freefall_monte_carlo.h"
+#include "freefall_parallel_sweep.h"
+#include "freefall_demo_profiles.h"
+#include <benchmark/benchmark.h>
+
+namespace
+{
+    FreeFallSim::FreeFallSimulationProfile make_drop_profile()
+    {
+        auto freefall_sim_vars = FreeFallSim::make_demo_sim_vars();
+        freefall_sim_vars.position = 100.0;
+        freefall_sim_vars.time_step = 0.001;
+        return freefall_sim_vars;
+    }
+
+    FreeFallSim::FreeFallMonteCarloProfile make_monte_carlo_profile(std::uint64_t sample_count)
+    {
+        FreeFallSim::FreeFallMonteCarloProfile monte_carlo;
+        monte_carlo.sample_count = sample_count;
+        monte_carlo.mass_of_object = FreeFallSim::FreeFallUncertainty::log_normal(0.0577, 0.05);
+        monte_carlo.radius_of_object = FreeFallSim::FreeFallUncertainty::normal(0.06661/2, 0.0005);
+        monte_carlo.drag_coefficient = FreeFallSim::FreeFallUncertainty::uniform(0.4, 0.55);
+        monte_carlo.fluid_density_air = FreeFallSim::FreeFallUncertainty::normal(1.22, 0.02);
+        return monte_carlo;
+    }
+
+    std::size_t plot_bytes(const FreeFallSim::FreeFallSimPlot& sim_plot)
+    {
+        return (sim_plot.time_data.capacity() + sim_plot.position_data.capacity() + sim_plot.velocity_data.capacity() +
+            sim_plot.netforce_data.capacity()) * sizeof(double) + sim_plot.events.capacity() * sizeof(FreeFallSim::FreeFallEvent);
+    }
+
+    void set_sample_counters(benchmark::State& state, std::uint64_t samples, std::size_t retained_bytes)
+    {
+        state.counters["time_per_sample"] = benchmark::Counter(static_cast<double>(samples),
+            benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+        state.counters["retained_kib"] = static_cast<double>(retained_bytes) / 1024.0;
+    }
+}
+
+// 100 m drops with uncertain mass, radius, Cd and air density, the argument is the sample count.
+//   time_per_sample  wall time per simulated drop, shown in us
+//   retained_kib     memory held by the results after the run
+// "Plots" keeps a FreeFallSimPlot of every sample and reduces afterwards, the way a sweep would.
+static void BM_MonteCarloPlots(benchmark::State& state)
+{
+    const auto freefall_sim_obj = FreeFallSim::make_demo_ball_profile();
+    const auto freefall_sim_vars = make_drop_profile();
+    const auto monte_carlo = make_monte_carlo_profile(static_cast<std::uint64_t>(state.range(0)));
+    FreeFallSim::FreeFallWorkStealingPool pool{1};
+    std::size_t retained_bytes{0};
+    for (auto _ : state)
+    {
+        std::vector<FreeFallSim::FreeFallSimModels> sim_models;
+        sim_models.reserve(monte_carlo.sample_count);
+        for (std::uint64_t index = 0; index < monte_carlo.sample_count; ++index)
+            sim_models.emplace_back(std::in_place_type<FreeFallSim::FreeFallConstGravitySimlation>,
+                FreeFallSim::draw_monte_carlo_profile(freefall_sim_obj, monte_carlo, index), freefall_sim_vars, FreeFallSim::FreeFallSimPlot{});
+        const auto sim_plots = FreeFallSim::run_parallel_sweep(sim_models, pool);
+        FreeFallSim::FreeFallWelford impact_time;
+        retained_bytes = 0;
+        for (const auto& sim_plot : sim_plots)
+        {
+            impact_time.add(sim_plot.time_data.back());
+            retained_bytes += plot_bytes(sim_plot);
+        }
+        benchmark::DoNotOptimize(impact_time.mean());
+    }
+    set_sample_counters(state, monte_carlo.sample_count, retained_bytes);
+}
+
+static void BM_MonteCarloStreaming(benchmark::State& state)
+{
+    const auto freefall_sim_obj = FreeFallSim::make_demo_ball_profile();
+    const auto freefall_sim_vars = make_drop_profile();
+    const auto monte_carlo = make_monte_carlo_profile(static_cast<std::uint64_t>(state.range(0)));
+    FreeFallSim::FreeFallWorkStealingPool pool{1};
+    std::size_t retained_bytes{0};
+    for (auto _ : state)
+    {
+        const auto result = FreeFallSim::run_monte_carlo<FreeFallSim::FreeFallConstGravitySimlation>(freefall_sim_obj, freefall_sim_vars,
+            monte_carlo, pool);
+        retained_bytes = result.memory_bytes();
+        benchmark::DoNotOptimize(result.impact_time.mean());
+    }
+    set_sample_counters(state, monte_carlo.sample_count, retained_bytes);
+}
+
+BENCHMARK(BM_MonteCarloPlots)->ArgName("samples")->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_MonteCarloStreaming)->ArgName("samples")->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
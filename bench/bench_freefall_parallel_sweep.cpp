@@ -0,0 +1,43 @@
+#include "freefall_parallel_sweep.h"
+#include "freefall_demo_profiles.h"
+#include <benchmark/benchmark.h>
+
+namespace
+{
+    // 64 Newton gravity drops, half from 40 m and half from 400 km. A 400 km drop takes ~5000 times
+    // the steps of a 40 m one, so a static split of the grid leaves most threads idle and only
+    // stealing keeps them busy.
+    std::vector<FreeFallSim::FreeFallSimModels> make_mixed_sweep()
+    {
+        FreeFallSim::FreeFallSweepGrid grid;
+        grid.gravity_profile = FreeFallSim::GravityProfile::NewtonGravitationModel;
+        grid.base_obj_profile = FreeFallSim::make_demo_ball_profile();
+        grid.base_sim_profile = FreeFallSim::make_demo_sim_vars();
+        grid.heights = {40.0, 400000.0};
+        grid.drag_coefficients = {0.3, 0.35, 0.4, 0.45, 0.47, 0.5, 0.55, 0.6};
+        grid.time_steps = {0.01f, 0.02f, 0.03f, 0.04f};
+        return FreeFallSim::expand_sweep_grid(grid);
+    }
+}
+
+// Mixed sweep on a pool of the given thread count.
+//   speedup      wall time of one thread over wall time of this thread count, from measure_sweep_scaling()
+//   efficiency   speedup per thread
+// Only meaningful up to the number of cores of the machine, past it the threads share cores.
+static void BM_ParallelSweepScaling(benchmark::State& state)
+{
+    const auto sim_models = make_mixed_sweep();
+    const auto thread_count = static_cast<std::size_t>(state.range(0));
+    FreeFallSim::FreeFallWorkStealingPool pool{thread_count};
+    for (auto _ : state)
+    {
+        const auto sim_plots = FreeFallSim::run_parallel_sweep(sim_models, pool);
+        benchmark::DoNotOptimize(sim_plots.data());
+    }
+    const auto scaling = FreeFallSim::measure_sweep_scaling(sim_models, {1, thread_count});
+    state.counters["speedup"] = scaling.back().speedup;
+    state.counters["efficiency"] = scaling.back().efficiency;
+    state.counters["models"] = static_cast<double>(sim_models.size());
+}
+
+BENCHMARK(BM_ParallelSweepScaling)->ArgName("threads")->RangeMultiplier(2)->Range(1, 64)->Unit(benchmark::kMillisecond)->UseRealTime();
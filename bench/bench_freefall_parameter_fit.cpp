@@ -0,0 +1,55 @@
+#include "freefall_parameter_fit.h"
+#include "freefall_analytic_solution.h"
+#include "freefall_demo_profiles.h"
+#include <benchmark/benchmark.h>
+#include <random>
+
+namespace
+{
+    // 100 m drops of slightly different balls measured every 0.02 s with 1 cm noise
+    std::vector<FreeFallSim::FreeFallMeasuredDrop> make_drops(std::size_t count)
+    {
+        std::mt19937_64 generator{14};
+        std::uniform_real_distribution<double> drag_coefficient{0.4, 0.55};
+        std::normal_distribution<double> error{0.0, 0.01};
+        std::vector<FreeFallSim::FreeFallMeasuredDrop> drops(count);
+        for (auto& drop : drops)
+        {
+            drop.initial_guess = FreeFallSim::make_demo_ball_profile();
+            drop.initial_guess.kDragCoefficient = drag_coefficient(generator);
+            drop.sim_vars = FreeFallSim::make_demo_sim_vars();
+            drop.sim_vars.position = 100.0;
+            const FreeFallSim::FreeFallConstGravityAnalytic analytic{drop.initial_guess, drop.sim_vars};
+            for (double time = 0.0; time < analytic.impact().time; time += 0.02)
+            {
+                drop.time_data.push_back(time);
+                drop.position_data.push_back(analytic.state_at(time).position + error(generator));
+            }
+            drop.initial_guess.kDragCoefficient = 0.3;
+        }
+        return drops;
+    }
+}
+
+// Batch of Cd fits, the argument is the thread count of the pool.
+//   time_per_fit     wall time per drop, shown in us
+//   iterations       mean Levenberg-Marquardt iterations per fit
+static void BM_FitDrops(benchmark::State& state)
+{
+    const auto drops = make_drops(256);
+    FreeFallSim::FreeFallWorkStealingPool pool{static_cast<std::size_t>(state.range(0))};
+    std::size_t iterations{0};
+    for (auto _ : state)
+    {
+        const auto results = FreeFallSim::fit_drops(drops, FreeFallSim::FreeFallFitProfile{}, pool);
+        iterations = 0;
+        for (const auto& result : results)
+            iterations += result.iterations;
+        benchmark::DoNotOptimize(results.data());
+    }
+    state.counters["time_per_fit"] = benchmark::Counter(static_cast<double>(drops.size()),
+        benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+    state.counters["iterations"] = static_cast<double>(iterations) / static_cast<double>(drops.size());
+}
+
+BENCHMARK(BM_FitDrops)->ArgName("threads")->Arg(1)->Arg(2)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
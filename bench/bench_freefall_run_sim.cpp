@@ -0,0 +1,217 @@
+#include "freefall_dragforce_simulation.h"
+#include "freefall_demo_profiles.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Every heap allocation of the process goes through these, so a run's allocations can be counted
+// around run_sim(). Only this benchmark binary replaces the global operators, all of the replaceable
+// forms, so a new[] or an over-aligned new never meets a delete the library still owns.
+namespace
+{
+    std::atomic<std::uint64_t> heap_allocations{0};
+
+    void* counted_alloc(std::size_t size) noexcept
+    {
+        heap_allocations.fetch_add(1, std::memory_order_relaxed);
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    void* counted_aligned_alloc(std::size_t size, std::align_val_t alignment) noexcept
+    {
+        heap_allocations.fetch_add(1, std::memory_order_relaxed);
+        // aligned_alloc wants the size as a multiple of the alignment
+        const auto align = static_cast<std::size_t>(alignment);
+        return std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align);
+    }
+
+    // Kept out of line: inlined into a caller, GCC pairs the free() with the operator new it sees
+    // there and warns about a mismatched deallocation
+    [[gnu::noinline]] void release(void* memory) noexcept
+    {
+        std::free(memory);
+    }
+
+    void* throw_if_null(void* memory)
+    {
+        if (memory == nullptr)
+            throw std::bad_alloc();
+        return memory;
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    return throw_if_null(counted_alloc(size));
+}
+
+void* operator new[](std::size_t size)
+{
+    return throw_if_null(counted_alloc(size));
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return counted_alloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return counted_alloc(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return throw_if_null(counted_aligned_alloc(size, alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return throw_if_null(counted_aligned_alloc(size, alignment));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return counted_aligned_alloc(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return counted_aligned_alloc(size, alignment);
+}
+
+void operator delete(void* memory) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    release(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+    release(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+    release(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+    release(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept
+{
+    release(memory);
+}
+
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    release(memory);
+}
+
+namespace
+{
+    // Benchmark arguments: time_step in microseconds, drop height in m, SamplingProfile
+    FreeFallSim::FreeFallSimulationProfile make_drop_profile(const benchmark::State& state)
+    {
+        auto freefall_sim_vars = FreeFallSim::make_demo_sim_vars();
+        freefall_sim_vars.time_step = static_cast<float>(state.range(0) * 1e-6);
+        freefall_sim_vars.position = static_cast<double>(state.range(1));
+        freefall_sim_vars.sampling = static_cast<FreeFallSim::SamplingProfile>(state.range(2));
+        freefall_sim_vars.sample_interval = 0.1;
+        freefall_sim_vars.max_points = 1000;
+        return freefall_sim_vars;
+    }
+
+    const char* sampling_label(std::int64_t sampling)
+    {
+        switch (static_cast<FreeFallSim::SamplingProfile>(sampling))
+        {
+            case FreeFallSim::SamplingProfile::HeightModulo:
+                return "height_modulo";
+            case FreeFallSim::SamplingProfile::TimeInterval:
+                return "time_interval";
+            case FreeFallSim::SamplingProfile::MaxPoints:
+                return "max_points";
+        }
+        return "unknown";
+    }
+}
+
+// One full run_sim() per iteration, the plot data included as an application would get it.
+//   time_per_step wall time per integration step, shown in ns
+//   steps_per_sec integration steps per second
+//   samples       samples emitted per run
+//   allocations   heap allocations per run, construction and result vectors included
+template <typename Simulation>
+static void BM_RunSim(benchmark::State& state)
+{
+    const auto freefall_sim_obj = FreeFallSim::make_demo_ball_profile();
+    const auto freefall_sim_vars = make_drop_profile(state);
+    std::uint64_t steps{0};
+    std::uint64_t samples{0};
+    std::uint64_t allocations{0};
+    for (auto _ : state)
+    {
+        const auto allocations_before = heap_allocations.load(std::memory_order_relaxed);
+        Simulation sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+        const auto sim_plot_vars = sim.run_sim();
+        allocations = heap_allocations.load(std::memory_order_relaxed) - allocations_before;
+        steps = sim_plot_vars.integrator_stats.steps_taken;
+        samples = sim_plot_vars.time_data.size();
+        benchmark::DoNotOptimize(sim_plot_vars.position_data.data());
+    }
+    const auto steps_per_run = static_cast<double>(steps);
+    state.counters["time_per_step"] = benchmark::Counter(steps_per_run,
+        benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+    state.counters["steps_per_sec"] = benchmark::Counter(steps_per_run, benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["samples"] = static_cast<double>(samples);
+    state.counters["allocations"] = static_cast<double>(allocations);
+    state.SetLabel(sampling_label(state.range(2)));
+}
+
+static void run_sim_arguments(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({"time_step_us", "height_m", "sampling"});
+    benchmark->ArgsProduct({{10000, 1000, 100}, {400, 4000},
+        {static_cast<std::int64_t>(FreeFallSim::SamplingProfile::HeightModulo),
+        static_cast<std::int64_t>(FreeFallSim::SamplingProfile::TimeInterval),
+        static_cast<std::int64_t>(FreeFallSim::SamplingProfile::MaxPoints)}});
+    benchmark->Unit(benchmark::kMicrosecond);
+}
+
+BENCHMARK_TEMPLATE(BM_RunSim, FreeFallSim::FreeFallConstGravitySimlation)->Apply(run_sim_arguments);
+BENCHMARK_TEMPLATE(BM_RunSim, FreeFallSim::FreeFallNewtonGravitySimlation)->Apply(run_sim_arguments);
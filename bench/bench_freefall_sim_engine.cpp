@@ -0,0 +1,119 @@
+#include "freefall_dragforce_simulation.h"
+#include "freefall_demo_profiles.h"
+#include <benchmark/benchmark.h>
+
+namespace
+{
+    FreeFallSim::FreeFallSimulationProfile make_drop_profile(double height)
+    {
+        auto freefall_sim_vars = FreeFallSim::make_demo_sim_vars();
+        freefall_sim_vars.position = height;
+        return freefall_sim_vars;
+    }
+
+    // Copy of the loop both gravity classes ran before SimEngine, the force lambdas and
+    // std::pow(time_step, 2) are evaluated on every step. Kept as the "before" reference.
+    template <typename GravityForce>
+    std::uint64_t legacy_run_sim(const FreeFallSim::FreeFallObjProfile& sim_obj_profile, FreeFallSim::FreeFallSimulationProfile sim_vars,
+        FreeFallSim::FreeFallSimPlot& sim_plot_vars, GravityForce&& gravity_force)
+    {
+        const auto height = sim_vars.position;
+        auto& initial_velocity = sim_vars.velocity;
+        auto& current_height = sim_vars.position;
+        std::uint64_t steps{0};
+        while (current_height >= 0)
+        {
+            const auto drag_force_on_obj = -FreeFallSim::drag_force(sim_obj_profile, sim_vars);
+            const auto net_force = drag_force_on_obj + gravity_force(sim_obj_profile, sim_vars);
+            const auto acceleration = net_force / sim_obj_profile.mass_of_object;
+            const auto new_velocity = initial_velocity + acceleration * sim_vars.time_step;
+            const auto new_height = current_height - (initial_velocity * sim_vars.time_step) - (0.5 * acceleration * std::pow(sim_vars.time_step, 2));
+            current_height = new_height;
+            initial_velocity = new_velocity;
+            ++steps;
+            auto samples_output = (int)(FreeFallSim::round_to(current_height, 1)) % sim_vars.sample_factor;
+            if (samples_output == 0)
+            {
+                const auto sim_time = FreeFallSim::round_to((height - current_height) / initial_velocity, 0.001);
+                if (sim_time > sim_vars.finish_time)
+                    break;
+                sim_plot_vars.time_data.emplace_back(sim_time);
+                sim_plot_vars.position_data.emplace_back(current_height);
+                sim_plot_vars.velocity_data.emplace_back(-initial_velocity);
+                sim_plot_vars.netforce_data.emplace_back(net_force);
+            }
+        }
+        return steps;
+    }
+
+    void set_step_counters(benchmark::State& state, std::uint64_t steps_per_run)
+    {
+        const auto steps = static_cast<double>(steps_per_run);
+        state.counters["steps"] = steps;
+        state.counters["steps_per_sec"] = benchmark::Counter(steps, benchmark::Counter::kIsIterationInvariantRate);
+        state.counters["time_per_step"] = benchmark::Counter(steps, benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+    }
+}
+
+static void BM_LegacyConstGravityStep(benchmark::State& state)
+{
+    const auto freefall_sim_obj = FreeFallSim::make_demo_ball_profile();
+    const auto freefall_sim_vars = make_drop_profile(static_cast<double>(state.range(0)));
+    std::uint64_t steps{0};
+    for (auto _ : state)
+    {
+        FreeFallSim::FreeFallSimPlot sim_plot_vars;
+        steps = legacy_run_sim(freefall_sim_obj, freefall_sim_vars, sim_plot_vars, FreeFallSim::const_weight_force);
+        benchmark::DoNotOptimize(sim_plot_vars.position_data.data());
+    }
+    set_step_counters(state, steps);
+}
+
+static void BM_EngineConstGravityStep(benchmark::State& state)
+{
+    const auto freefall_sim_obj = FreeFallSim::make_demo_ball_profile();
+    const auto freefall_sim_vars = make_drop_profile(static_cast<double>(state.range(0)));
+    std::uint64_t steps{0};
+    for (auto _ : state)
+    {
+        FreeFallSim::FreeFallConstGravitySimlation sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+        const auto sim_plot_vars = sim.run_sim();
+        steps = sim_plot_vars.integrator_stats.steps_taken;
+        benchmark::DoNotOptimize(sim_plot_vars.position_data.data());
+    }
+    set_step_counters(state, steps);
+}
+
+static void BM_LegacyNewtonGravityStep(benchmark::State& state)
+{
+    const auto freefall_sim_obj = FreeFallSim::make_demo_ball_profile();
+    const auto freefall_sim_vars = make_drop_profile(static_cast<double>(state.range(0)));
+    std::uint64_t steps{0};
+    for (auto _ : state)
+    {
+        FreeFallSim::FreeFallSimPlot sim_plot_vars;
+        steps = legacy_run_sim(freefall_sim_obj, freefall_sim_vars, sim_plot_vars, FreeFallSim::newton_gravitational_force);
+        benchmark::DoNotOptimize(sim_plot_vars.position_data.data());
+    }
+    set_step_counters(state, steps);
+}
+
+static void BM_EngineNewtonGravityStep(benchmark::State& state)
+{
+    const auto freefall_sim_obj = FreeFallSim::make_demo_ball_profile();
+    const auto freefall_sim_vars = make_drop_profile(static_cast<double>(state.range(0)));
+    std::uint64_t steps{0};
+    for (auto _ : state)
+    {
+        FreeFallSim::FreeFallNewtonGravitySimlation sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+        const auto sim_plot_vars = sim.run_sim();
+        steps = sim_plot_vars.integrator_stats.steps_taken;
+        benchmark::DoNotOptimize(sim_plot_vars.position_data.data());
+    }
+    set_step_counters(state, steps);
+}
+
+BENCHMARK(BM_LegacyConstGravityStep)->Arg(400)->Arg(40000);
+BENCHMARK(BM_EngineConstGravityStep)->Arg(400)->Arg(40000);
+BENCHMARK(BM_LegacyNewtonGravityStep)->Arg(400)->Arg(40000);
+BENCHMARK(BM_EngineNewtonGravityStep)->Arg(400)->Arg(40000);
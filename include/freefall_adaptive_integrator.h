@@ -0,0 +1,131 @@
+#ifndef FREEFALL_ADAPTIVE_INTEGRATOR_H
+#define FREEFALL_ADAPTIVE_INTEGRATOR_H
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace FreeFallSim
+{
+
+    // Dormand-Prince 5(4) tableau, the 5th order solution is propagated and the embedded
+    // 4th order one only drives the error estimate. The last stage equals the first stage of
+    // the next step (FSAL), so an accepted step costs six acceleration evaluations.
+    namespace DormandPrince45
+    {
+        constexpr double c2{1.0 / 5.0}, c3{3.0 / 10.0}, c4{4.0 / 5.0}, c5{8.0 / 9.0};
+        constexpr double a21{1.0 / 5.0};
+        constexpr double a31{3.0 / 40.0}, a32{9.0 / 40.0};
+        constexpr double a41{44.0 / 45.0}, a42{-56.0 / 15.0}, a43{32.0 / 9.0};
+        constexpr double a51{19372.0 / 6561.0}, a52{-25360.0 / 2187.0}, a53{64448.0 / 6561.0}, a54{-212.0 / 729.0};
+        constexpr double a61{9017.0 / 3168.0}, a62{-355.0 / 33.0}, a63{46732.0 / 5247.0}, a64{49.0 / 176.0}, a65{-5103.0 / 18656.0};
+        constexpr double b1{35.0 / 384.0}, b3{500.0 / 1113.0}, b4{125.0 / 192.0}, b5{-2187.0 / 6784.0}, b6{11.0 / 84.0};
+        // b(5th) - b(4th), used for the local error estimate
+        constexpr double e1{71.0 / 57600.0}, e3{-71.0 / 16695.0}, e4{71.0 / 1920.0}, e5{-17253.0 / 339200.0}, e6{22.0 / 525.0}, e7{-1.0 / 40.0};
+    }
+
+    struct FreeFallAdaptiveOptions
+    {
+        double initial_step;                 // (t) s first trial step
+        double abs_tolerance;                // absolute tolerance on position and velocity
+        double rel_tolerance;                // relative tolerance on position and velocity
+        double finish_time;                  // (t) s stop even if the ground was not reached
+        double min_step{1e-9};               // (t) s smallest step before the error test is skipped
+    };
+
+    struct FreeFallAdaptiveCounters
+    {
+        std::uint64_t steps_taken{0};
+        std::uint64_t steps_rejected{0};
+    };
+
+    // Integrates dx/dt = -v, dv/dt = acceleration(x, v) from (position, velocity) until the height
+    // drops below zero. Step size follows the standard I-controller on the scaled RMS error.
+    // A step which would end below ground is retried once with the secant estimate of the
+    // ground crossing, so the last step lands just under zero instead of overshooting by a
+    // full terminal-velocity step. on_step(time, position, velocity, acceleration) is called
+    // after every accepted step, position and velocity are updated in place.
+    template <typename Acceleration, typename OnStep>
+    FreeFallAdaptiveCounters integrate_dormand_prince45(double& position, double& velocity, Acceleration&& acceleration,
+        const FreeFallAdaptiveOptions& options, OnStep&& on_step)
+    {
+        using namespace DormandPrince45;
+        constexpr double kSafety{0.9};
+        constexpr double kMinScale{0.2};
+        constexpr double kMaxScale{5.0};
+        // ground retry aims slightly past the estimated crossing so the step ends below zero
+        constexpr double kGroundOvershoot{1.0 + 1e-6};
+
+        FreeFallAdaptiveCounters counters;
+        double time{0.0};
+        double step = options.initial_step;
+        double k1_v = acceleration(position, velocity);
+        bool ground_retry{false};
+
+        while (position >= 0.0 && time < options.finish_time)
+        {
+            step = std::min(step, options.finish_time - time);
+            // stages, the position derivative is -v so its slopes are the stage velocities
+            const double x1 = position, v1 = velocity;
+            const double k1_x = -v1;
+
+            const double x2 = x1 + step * (a21 * k1_x);
+            const double v2 = v1 + step * (a21 * k1_v);
+            const double k2_x = -v2, k2_v = acceleration(x2, v2);
+
+            const double x3 = x1 + step * (a31 * k1_x + a32 * k2_x);
+            const double v3 = v1 + step * (a31 * k1_v + a32 * k2_v);
+            const double k3_x = -v3, k3_v = acceleration(x3, v3);
+
+            const double x4 = x1 + step * (a41 * k1_x + a42 * k2_x + a43 * k3_x);
+            const double v4 = v1 + step * (a41 * k1_v + a42 * k2_v + a43 * k3_v);
+            const double k4_x = -v4, k4_v = acceleration(x4, v4);
+
+            const double x5 = x1 + step * (a51 * k1_x + a52 * k2_x + a53 * k3_x + a54 * k4_x);
+            const double v5 = v1 + step * (a51 * k1_v + a52 * k2_v + a53 * k3_v + a54 * k4_v);
+            const double k5_x = -v5, k5_v = acceleration(x5, v5);
+
+            const double x6 = x1 + step * (a61 * k1_x + a62 * k2_x + a63 * k3_x + a64 * k4_x + a65 * k5_x);
+            const double v6 = v1 + step * (a61 * k1_v + a62 * k2_v + a63 * k3_v + a64 * k4_v + a65 * k5_v);
+            const double k6_x = -v6, k6_v = acceleration(x6, v6);
+
+            const double new_position = x1 + step * (b1 * k1_x + b3 * k3_x + b4 * k4_x + b5 * k5_x + b6 * k6_x);
+            const double new_velocity = v1 + step * (b1 * k1_v + b3 * k3_v + b4 * k4_v + b5 * k5_v + b6 * k6_v);
+            const double k7_x = -new_velocity, k7_v = acceleration(new_position, new_velocity);
+
+            const double error_x = step * (e1 * k1_x + e3 * k3_x + e4 * k4_x + e5 * k5_x + e6 * k6_x + e7 * k7_x);
+            const double error_v = step * (e1 * k1_v + e3 * k3_v + e4 * k4_v + e5 * k5_v + e6 * k6_v + e7 * k7_v);
+            const double scale_x = options.abs_tolerance + options.rel_tolerance * std::max(std::abs(x1), std::abs(new_position));
+            const double scale_v = options.abs_tolerance + options.rel_tolerance * std::max(std::abs(v1), std::abs(new_velocity));
+            const double error_norm = std::sqrt(0.5 * ((error_x / scale_x) * (error_x / scale_x) + (error_v / scale_v) * (error_v / scale_v)));
+
+            if (error_norm > 1.0 && step > options.min_step)
+            {
+                ++counters.steps_rejected;
+                step *= std::max(kMinScale, kSafety * std::pow(error_norm, -0.2));
+                continue;
+            }
+            if (new_position < 0.0 && !ground_retry && x1 > 0.0)
+            {
+                ground_retry = true;
+                step *= std::min(1.0, kGroundOvershoot * x1 / (x1 - new_position));
+                continue;
+            }
+
+            ++counters.steps_taken;
+            ground_retry = false;
+            time += step;
+            position = new_position;
+            velocity = new_velocity;
+            k1_v = k7_v;
+            on_step(time, position, velocity, k7_v);
+
+            const double growth = error_norm > 0.0 ? kSafety * std::pow(error_norm, -0.2) : kMaxScale;
+            step *= std::clamp(growth, kMinScale, kMaxScale);
+        }
+        return counters;
+    }
+
+}
+
+#endif
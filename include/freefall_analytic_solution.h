@@ -0,0 +1,81 @@
+#ifndef FREEFALL_ANALYTIC_SOLUTION_H
+#define FREEFALL_ANALYTIC_SOLUTION_H
+#pragma once
+#include <optional>
+#include "freefall_dragforce_simulation.h"
+#include "freefall_trajectory_sink.h"
+
+namespace FreeFallSim
+{
+
+    // State of the object at a given time, velocity positive downward as in FreeFallSimulationProfile
+    struct FreeFallAnalyticState
+    {
+        double time;        // (t) s
+        double position;    // (x) m
+        double velocity;    // (v) m/s
+        double net_force;   // (F) N, positive downward
+    };
+
+    // Closed form solution of constant gravity with quadratic drag, dv/dt = g - k*v*|v| where
+    // k = Cd*rho*pi*r^2 / m. With terminal velocity vt = sqrt(g/k) and tau = vt/g
+    //   falling slower than vt:  v = vt*tanh(t/tau + phi),  fallen = vt^2/g * ln(cosh(t/tau + phi) / cosh(phi))
+    //   falling faster than vt:  v = vt*coth(t/tau + phi),  fallen = vt^2/g * ln(sinh(t/tau + phi) / sinh(phi))
+    //   thrown upward:           u = vt*tan(theta - t/tau), risen  = vt^2/g * ln(cos(theta - t/tau) / cos(theta))
+    // Every query is O(1), no integration is involved. The formulas keep going below the ground,
+    // callers interested in the drop only should stop at impact(). Requires g > 0.
+    class FreeFallConstGravityAnalytic
+    {
+        public:
+        explicit FreeFallConstGravityAnalytic(const FreeFallObjProfile& sim_obj_profile, const FreeFallSimulationProfile& sim_freefall_vars);
+
+        FreeFallAnalyticState state_at(double time) const;
+        // First time the object passes the given height, empty if it never gets there
+        std::optional<double> time_to_height(double height) const;
+        // State when the object reaches the ground (x = 0), the object starts above ground
+        FreeFallAnalyticState impact() const;
+        double terminal_velocity() const { return m_terminal_velocity; }
+
+        // Trajectory sampled at every height which is a multiple of sample_factor down to the ground,
+        // the sampling run_sim() approximates, evaluated straight from the formulas
+        FreeFallSimPlot sample_trajectory(int sample_factor) const;
+        // Same samples streamed into a sink, stopping after finish_time, returns the number written
+        std::size_t write_trajectory(int sample_factor, FreeFallTrajectorySink& sink,
+            double finish_time = std::numeric_limits<double>::infinity()) const;
+
+        private:
+        enum class DescentRegime { NoDrag, BelowTerminal, AboveTerminal, AtTerminal };
+
+        double descent_velocity(double descent_time) const;
+        double descent_distance(double descent_time) const;
+        double descent_time_for(double distance) const;
+        double net_force_at(double velocity) const;
+
+        double m_mass;
+        double m_gravity;              // (g) m/s^2
+        double m_drag_per_mass;        // (k) 1/m
+        double m_terminal_velocity;    // (vt) m/s, infinity without drag
+        double m_tau;                  // vt/g s
+        double m_length_scale;         // vt^2/g m
+        double m_initial_position;     // (x0) m
+        double m_initial_velocity;     // (v0) m/s
+        // ascending phase, zero length when v0 >= 0
+        double m_apex_time{0.0};
+        double m_apex_position;
+        double m_launch_angle{0.0};    // theta = atan(-v0/vt)
+        // descending phase starts at the apex with velocity m_descent_velocity
+        DescentRegime m_regime;
+        double m_descent_velocity;
+        double m_phase{0.0};           // phi
+        double m_log_phase_term{0.0};  // ln cosh(phi) or ln sinh(phi)
+    };
+
+    // Time until the object reaches the ground, capped at finish_time. Exact for constant gravity,
+    // the Newton model is estimated with the gravity at the drop height, the weakest along the way,
+    // which makes the result an upper bound. Used to size outputs before a run.
+    double estimate_impact_time(const FreeFallObjProfile& sim_obj_profile, const FreeFallSimulationProfile& sim_freefall_vars,
+        GravityProfile gravity_profile);
+
+}
+
+#endif
@@ -0,0 +1,200 @@
+#ifndef FREEFALL_ATMOSPHERE_H
+#define FREEFALL_ATMOSPHERE_H
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include "freefall_dragforce_simulation.h"
+
+// Altitude dependent air density and gravity for high drops. The direct models cost a pow/exp per
+// evaluation, the step loop reads them from precomputed uniform tables instead.
+
+namespace FreeFallSim
+{
+
+    // Radius the US Standard Atmosphere 1976 converts geometric to geopotential height with
+    constexpr double kStandardAtmosphereEarthRadius{6356766.0};
+
+    // Geopotential height in m of a geometric height, the height the standard atmosphere layers are defined on
+    inline double geopotential_height(double height)
+    {
+        return kStandardAtmosphereEarthRadius * height / (kStandardAtmosphereEarthRadius + height);
+    }
+
+    // Geopotential height in m up to which the density is modelled. The seven layers of the 1976 model end at
+    // 84852 m (86 km geometric), the top layer is extended from there so the table has no kink at the end.
+    constexpr double kStandardAtmosphereTop{88000.0};
+
+    // US Standard Atmosphere 1976 density in kg/m^3 at a geometric height in m, heights outside
+    // [0, kStandardAtmosphereTop] (geopotential) are clamped to the nearest end
+    double us_standard_atmosphere_density(double height);
+    // The same density at a geopotential height
+    double us_standard_atmosphere_density_geopotential(double geopotential);
+
+    // f sampled at equally spaced points over [lower, upper] and interpolated linearly in between.
+    // The lookup has no branches: the scaled position is clamped with min/max (outside the range the end
+    // values are returned) and the last value is stored twice so the top of the range stays in bounds.
+    // evaluate() applies it to a whole array in a loop the compiler can vectorize.
+    class FreeFallUniformTable
+    {
+        public:
+        FreeFallUniformTable(): m_values(3, 0.0) {}
+
+        template <typename Function>
+        FreeFallUniformTable(Function&& f, double lower, double upper, std::size_t intervals):
+            m_lower(lower), m_upper(upper), m_intervals(std::max<std::size_t>(intervals, 1))
+        {
+            const auto spacing = (upper - lower) / static_cast<double>(m_intervals);
+            m_inverse_spacing = spacing > 0.0 ? 1.0 / spacing : 0.0;
+            m_values.reserve(m_intervals + 2);
+            for (std::size_t point = 0; point < m_intervals; ++point)
+                m_values.push_back(f(lower + static_cast<double>(point) * spacing));
+            m_values.push_back(f(upper));
+            m_values.push_back(m_values.back());
+        }
+
+        // Fewest intervals (doubling from first_intervals) for which the interpolation stays within rel_tolerance
+        // of f at every interval midpoint, where the error of linear interpolation peaks. Kinks of f cost
+        // accuracy in proportion to the spacing, first_intervals can put them on the grid.
+        template <typename Function>
+        static FreeFallUniformTable fit(Function&& f, double lower, double upper, double rel_tolerance,
+            std::size_t first_intervals = 16, std::size_t max_intervals = kMaxIntervals)
+        {
+            for (auto intervals = std::max<std::size_t>(first_intervals, 1);; intervals *= 2)
+            {
+                FreeFallUniformTable table{f, lower, upper, intervals};
+                if (intervals >= max_intervals || table.max_midpoint_error(f) <= rel_tolerance)
+                    return table;
+            }
+        }
+
+        double operator()(double x) const
+        {
+            const auto position = std::min(std::max((x - m_lower) * m_inverse_spacing, 0.0), static_cast<double>(m_intervals));
+            const auto index = static_cast<std::size_t>(position);
+            const auto fraction = position - static_cast<double>(index);
+            return m_values[index] + fraction * (m_values[index + 1] - m_values[index]);
+        }
+
+        void evaluate(const double* x, double* values, std::size_t count) const
+        {
+            for (std::size_t i = 0; i < count; ++i)
+                values[i] = (*this)(x[i]);
+        }
+
+        // Largest relative deviation from f over the interval midpoints
+        template <typename Function>
+        double max_midpoint_error(Function&& f) const
+        {
+            const auto spacing = (m_upper - m_lower) / static_cast<double>(m_intervals);
+            double max_error{0.0};
+            for (std::size_t point = 0; point < m_intervals; ++point)
+            {
+                const auto x = m_lower + (static_cast<double>(point) + 0.5) * spacing;
+                const auto exact = f(x);
+                max_error = std::max(max_error, std::abs((*this)(x) - exact) / std::max(std::abs(exact), kTinyValue));
+            }
+            return max_error;
+        }
+
+        double lower() const { return m_lower; }
+        double upper() const { return m_upper; }
+        std::size_t intervals() const { return m_intervals; }
+        std::size_t size_bytes() const { return m_values.size() * sizeof(double); }
+
+        private:
+        static constexpr std::size_t kMaxIntervals{std::size_t{1} << 20};
+        static constexpr double kTinyValue{1e-300};
+
+        double m_lower{0.0};
+        double m_upper{0.0};
+        double m_inverse_spacing{0.0};
+        std::size_t m_intervals{1};
+        std::vector<double> m_values;
+    };
+
+    // Relative accuracy the stock tables are fitted to
+    constexpr double kDensityTableTolerance{1e-6};
+    constexpr double kGravityTableTolerance{1e-10};
+
+    // us_standard_atmosphere_density_geopotential() fitted to kDensityTableTolerance, built on first use and
+    // shared by all runs. The grid is uniform in geopotential height over [0, kStandardAtmosphereTop] with a
+    // spacing dividing 1 km, so the temperature kinks between layers fall on grid points. Look it up with
+    // geopotential_height(x).
+    const FreeFallUniformTable& standard_atmosphere_density_table();
+
+    // Density at a geometric height read from standard_atmosphere_density_table()
+    inline double tabulated_standard_atmosphere_density(double height)
+    {
+        return standard_atmosphere_density_table()(geopotential_height(height));
+    }
+
+    // GM / (R+x)^2 of sim_vars over [0, top_height]
+    FreeFallUniformTable make_newton_gravity_table(const FreeFallSimulationProfile& sim_vars, double top_height,
+        double rel_tolerance = kGravityTableTolerance);
+
+    // Fd = Cd*rho(x)*v^2*pi*r^2, drag_force with the standard atmosphere density at the current height
+    // in place of fluid_density_air
+    static auto standard_atmosphere_drag_force = [](const FreeFallObjProfile& sim_obj_profile, const FreeFallSimulationProfile& sim_vars)
+    {
+        return sim_obj_profile.kDragCoefficient * tabulated_standard_atmosphere_density(sim_vars.position) * sim_vars.velocity * sim_vars.velocity *
+            M_PI * sim_obj_profile.radius_of_object * sim_obj_profile.radius_of_object;
+    };
+
+    // a = g(x) read from a make_newton_gravity_table() covering the run, from the ground to the highest
+    // point a throw upward reaches in vacuum. Above that the top value is held. For the inverse square law
+    // itself the lookup is slower than the single division it replaces (BM_GravityTable), it pays off for
+    // gravity fields which are costlier to evaluate.
+    struct TabulatedNewtonGravityPolicy
+    {
+        static constexpr const char* kName{"TabulatedNewtonGravity"};  // part of the result cache key
+        static constexpr GravityProfile kGravityProfile{GravityProfile::NewtonGravitationModel};
+        struct Coefficients
+        {
+            FreeFallUniformTable gravity;   // (g(x)) m/s^2
+        };
+        static Coefficients prepare(const FreeFallObjProfile& sim_obj_profile, const FreeFallSimulationProfile& sim_vars);
+        static double acceleration(const Coefficients& coefficients, double position)
+        {
+            return coefficients.gravity(position);
+        }
+    };
+
+    // a = Fd/m = Cd*rho(x)*pi*r^2/m * v^2 with rho(x) from standard_atmosphere_density_table(),
+    // fluid_density_air is not used
+    struct StandardAtmosphereDragPolicy
+    {
+        static constexpr const char* kName{"StandardAtmosphereDrag"};  // part of the result cache key
+        struct Coefficients
+        {
+            double drag_area_per_mass;              // (Cd*pi*r^2/m) m^2/kg
+            const FreeFallUniformTable* density;    // (rho(h)) kg/m^3 over geopotential height
+        };
+        static Coefficients prepare(const FreeFallObjProfile& sim_obj_profile, const FreeFallSimulationProfile&)
+        {
+            return {sim_obj_profile.kDragCoefficient * M_PI * sim_obj_profile.radius_of_object * sim_obj_profile.radius_of_object /
+                sim_obj_profile.mass_of_object, &standard_atmosphere_density_table()};
+        }
+        static double acceleration(const Coefficients& coefficients, double position, double velocity)
+        {
+            return coefficients.drag_area_per_mass * (*coefficients.density)(geopotential_height(position)) * velocity * velocity;
+        }
+        // speed where drag balances the given gravity at this height
+        static double terminal_velocity(const Coefficients& coefficients, double position, double gravity)
+        {
+            const auto drag_per_mass = coefficients.drag_area_per_mass * (*coefficients.density)(geopotential_height(position));
+            return drag_per_mass > 0.0 ? std::sqrt(gravity / drag_per_mass) : std::numeric_limits<double>::infinity();
+        }
+    };
+
+    // Newton gravity through the standard atmosphere, direct and fully tabulated. The sampler's flight time
+    // estimate still assumes fluid_density_air, which only affects the MaxPoints spacing and the reserve.
+    using FreeFallNewtonAtmosphereSimlation = SimEngine<NewtonGravityPolicy, StandardAtmosphereDragPolicy, ProfileSelectedIntegrator, ProfileSelectedSampler>;
+    using FreeFallTabulatedAtmosphereSimlation = SimEngine<TabulatedNewtonGravityPolicy, StandardAtmosphereDragPolicy, ProfileSelectedIntegrator, ProfileSelectedSampler>;
+    extern template class SimEngine<NewtonGravityPolicy, StandardAtmosphereDragPolicy, ProfileSelectedIntegrator, ProfileSelectedSampler>;
+    extern template class SimEngine<TabulatedNewtonGravityPolicy, StandardAtmosphereDragPolicy, ProfileSelectedIntegrator, ProfileSelectedSampler>;
+
+}
+
+#endif
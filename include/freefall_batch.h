@@ -0,0 +1,170 @@
+#ifndef FREEFALL_BATCH_H
+#define FREEFALL_BATCH_H
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "freefall_convergence_study.h"
+#include "freefall_dragforce_simulation.h"
+#include "freefall_trajectory_sink.h"
+
+// Headless batch runs of scenario files, the engine behind the FreeFallBatch executable.
+//
+// A scenario file is CSV with a header row or JSON lines with one flat object per line, both use the
+// field names below. Fields left out keep the value of FreeFallBatchOptions::defaults.
+//   id             text copied to the output
+//   gravity        constant | newton
+//   drag_coefficient, mass, radius, fluid_density          FreeFallObjProfile
+//   position, velocity, time_step, sample_factor, finish_time, gravity_acceleration,
+//   sample_interval, max_points, abs_tolerance, rel_tolerance                FreeFallSimulationProfile
+//   integrator     fixed_step | dormand_prince45 | closed_form
+//   sampling       height_modulo | time_interval | max_points
+//   locate_impact, steady_state_fast_forward               true | false | 1 | 0
+// Empty lines and, in CSV, lines starting with # are skipped.
+
+namespace FreeFallSim
+{
+
+    enum class FreeFallScenarioFormat { Csv, JsonLines };
+
+    struct FreeFallScenario
+    {
+        std::uint64_t index{0};                       // position in the file, 0 based, the order of the output
+        std::string id;
+        GravityProfile gravity_profile{GravityProfile::ConstantGravity};
+        FreeFallObjProfile sim_obj_profile{};
+        FreeFallSimulationProfile sim_freefall_vars{};
+    };
+
+    // Read only mapping of a whole file. Pages are faulted in as the reader walks forward and handed
+    // back with release_before() once parsed, so the resident part stays small for a file of any size.
+    class FreeFallMappedFile
+    {
+        public:
+        // throws std::runtime_error when the file can not be opened or mapped
+        explicit FreeFallMappedFile(const std::string& path);
+        ~FreeFallMappedFile();
+
+        FreeFallMappedFile(const FreeFallMappedFile& src) = delete;
+        FreeFallMappedFile& operator=(const FreeFallMappedFile& src) = delete;
+
+        std::string_view text() const { return {static_cast<const char*>(m_mapping), m_size}; }
+        // Drops the whole pages before offset from memory, reading them again faults them back in
+        void release_before(std::size_t offset);
+
+        private:
+        void* m_mapping{nullptr};
+        std::size_t m_size{0};
+        std::size_t m_released{0};
+    };
+
+    // Csv unless the extension is .jsonl, .ndjson or .json
+    FreeFallScenarioFormat scenario_format_from_path(const std::string& path);
+
+    // Parses scenarios one line at a time out of text which outlives the reader. Every call to next()
+    // looks at the next record only, nothing is read ahead or kept.
+    class FreeFallScenarioReader
+    {
+        public:
+        // throws std::invalid_argument when the CSV header names an unknown field
+        FreeFallScenarioReader(std::string_view text, FreeFallScenarioFormat format, FreeFallScenario defaults = {});
+
+        // Fills scenario with the next record and returns false at the end of the text.
+        // throws std::invalid_argument naming the line on unknown fields, bad values and malformed records
+        bool next(FreeFallScenario& scenario);
+
+        std::uint64_t line_number() const { return m_line_number; }
+        // bytes of text consumed so far
+        std::size_t offset() const { return m_offset; }
+
+        private:
+        bool next_line(std::string_view& line);
+        void parse_csv(std::string_view line, FreeFallScenario& scenario) const;
+        void parse_json(std::string_view line, FreeFallScenario& scenario) const;
+
+        std::string_view m_text;
+        std::size_t m_offset{0};
+        FreeFallScenarioFormat m_format;
+        FreeFallScenario m_defaults;
+        std::vector<std::size_t> m_columns;           // field of every CSV column
+        std::uint64_t m_line_number{0};
+        std::uint64_t m_next_index{0};
+    };
+
+    // Outcome of one scenario, velocities in m/s positive downward as in the ensemble results
+    struct FreeFallScenarioSummary
+    {
+        std::uint64_t index{0};
+        std::string id;
+        bool landed{false};                           // the run reached the ground before finish_time
+        double impact_time{0.0};                      // (t) s of the last sample, the impact when landed
+        double impact_velocity{0.0};                  // (v) m/s at that sample
+        double max_speed{0.0};                        // (|v|) m/s over the samples
+        double final_position{0.0};                   // (x) m of the last sample
+        std::uint64_t samples{0};
+        std::uint64_t steps{0};                       // integration steps taken
+    };
+
+    // Runs one scenario, trajectory (when not null) receives every sample as well
+    FreeFallScenarioSummary simulate_scenario(const FreeFallScenario& scenario, FreeFallTrajectorySink* trajectory = nullptr);
+
+    // CSV lines of the two outputs, the header lines end in '\n'
+    extern const char* const kScenarioSummaryCsvHeader;
+    extern const char* const kTrajectoryCsvHeader;
+    void append_summary_csv(std::string& output, const FreeFallScenarioSummary& summary);
+    void append_summary_json(std::string& output, const FreeFallScenarioSummary& summary);
+
+    // Time step study rows: the recommended level with its estimated errors, the observed orders and the
+    // extrapolated values. JSON writes null (CSV nan) for an order which was not observed and for the
+    // terminal state of a drop which did not reach it. A result without levels (the study of a scenario
+    // which does not land) gives a landed 0 row of NaN values.
+    extern const char* const kConvergenceCsvHeader;
+    void append_convergence_csv(std::string& output, const FreeFallScenario& scenario, const FreeFallConvergenceResult& result);
+    void append_convergence_json(std::string& output, const FreeFallScenario& scenario, const FreeFallConvergenceResult& result);
+
+    struct FreeFallBatchOptions
+    {
+        FreeFallScenario defaults;                    // values of the fields a scenario leaves out
+        std::size_t worker_count{0};                  // simulation threads, 0 uses std::thread::hardware_concurrency()
+        std::size_t chunk_size{256};                  // scenarios per queue item
+        std::size_t queue_capacity{4};                // chunks per queue, with the workers this bounds the chunks in flight
+        bool json_summaries{false};                   // JSON lines instead of CSV for the summaries
+        bool time_step_study{false};                  // run_convergence_study() per scenario, its rows replace the summaries
+        FreeFallConvergenceProfile convergence;       // levels and tolerance of the study
+    };
+
+    struct FreeFallBatchReport
+    {
+        std::uint64_t scenarios{0};
+        std::uint64_t landed{0};
+        std::uint64_t trajectory_samples{0};
+        std::size_t max_chunks_in_flight{0};          // parsed but not yet written, at most chunks_in_flight_limit()
+        double wall_time_s{0.0};
+        double scenarios_per_second{0.0};
+    };
+
+    // Chunks parsed but not written yet that run_batch() allows at once
+    std::size_t chunks_in_flight_limit(const FreeFallBatchOptions& options);
+
+    // Three stage pipeline over the scenarios of text:
+    //   parser thread -> bounded queue -> worker threads -> bounded queue -> calling thread writing
+    // Summaries (and trajectory rows when trajectories is not null) are written in scenario order. The
+    // parser waits while chunks_in_flight_limit() chunks are between parsing and writing, so memory stays
+    // flat for any number of scenarios, each chunk holding chunk_size scenarios and their output text.
+    // The first parse or simulation error stops the pipeline and is rethrown here, the output then ends
+    // after the last complete chunk before it. A time step study writes no trajectories, asking for them
+    // throws std::invalid_argument. A scenario whose study has a level that does not reach the ground is
+    // not an error, its row has landed 0 and no levels.
+    FreeFallBatchReport run_batch(std::string_view text, FreeFallScenarioFormat format, const FreeFallBatchOptions& options,
+        std::ostream& summaries, std::ostream* trajectories = nullptr);
+
+    // Same over a mapped file, format from the extension. The parser releases the pages it is done with.
+    FreeFallBatchReport run_batch(const std::string& scenario_path, const FreeFallBatchOptions& options,
+        std::ostream& summaries, std::ostream* trajectories = nullptr);
+
+}
+
+#endif
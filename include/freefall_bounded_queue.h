@@ -0,0 +1,75 @@
+#ifndef FREEFALL_BOUNDED_QUEUE_H
+#define FREEFALL_BOUNDED_QUEUE_H
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+namespace FreeFallSim
+{
+
+    // Blocking multi producer, multi consumer queue holding at most capacity items. A full queue
+    // stalls the producers, which is what keeps the memory of a pipeline flat when one stage is slower.
+    // close() wakes everybody: push() then drops the item and returns false, pop() drains what is
+    // left and returns an empty optional once the queue is empty.
+    template <typename T>
+    class FreeFallBoundedQueue
+    {
+        public:
+        explicit FreeFallBoundedQueue(std::size_t capacity): m_capacity(capacity > 0 ? capacity : 1)
+        {}
+
+        FreeFallBoundedQueue(const FreeFallBoundedQueue& src) = delete;
+        FreeFallBoundedQueue& operator=(const FreeFallBoundedQueue& src) = delete;
+
+        bool push(T item)
+        {
+            std::unique_lock lock{m_mutex};
+            m_not_full.wait(lock, [this] { return m_closed || m_items.size() < m_capacity; });
+            if (m_closed)
+                return false;
+            m_items.push_back(std::move(item));
+            lock.unlock();
+            m_not_empty.notify_one();
+            return true;
+        }
+
+        std::optional<T> pop()
+        {
+            std::unique_lock lock{m_mutex};
+            m_not_empty.wait(lock, [this] { return m_closed || !m_items.empty(); });
+            if (m_items.empty())
+                return std::nullopt;
+            std::optional<T> item{std::move(m_items.front())};
+            m_items.pop_front();
+            lock.unlock();
+            m_not_full.notify_one();
+            return item;
+        }
+
+        void close()
+        {
+            {
+                std::lock_guard lock{m_mutex};
+                m_closed = true;
+            }
+            m_not_full.notify_all();
+            m_not_empty.notify_all();
+        }
+
+        std::size_t capacity() const { return m_capacity; }
+
+        private:
+        std::size_t m_capacity;
+        std::deque<T> m_items;
+        std::mutex m_mutex;
+        std::condition_variable m_not_full;
+        std::condition_variable m_not_empty;
+        bool m_closed{false};
+    };
+
+}
+
+#endif
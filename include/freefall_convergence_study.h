@@ -0,0 +1,87 @@
+#ifndef FREEFALL_CONVERGENCE_STUDY_H
+#define FREEFALL_CONVERGENCE_STUDY_H
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "freefall_dragforce_simulation.h"
+
+// Time step selection by a convergence study. One profile is run at time_step, time_step/2, time_step/4, ...
+// and three consecutive levels give the observed order of accuracy of a quantity,
+//   p = log2(|q(h) - q(h/2)| / |q(h/2) - q(h/4)|)
+// and its Richardson extrapolation to a zero step, q* = q(h/4) + (q(h/4) - q(h/2)) / (2^p - 1).
+// The error of every level is estimated as |q - q*|. The cheapest level whose impact time and impact
+// velocity meet the tolerance gives the time_step for production runs. The terminal state, the first
+// |net force| <= net_force_epsilon * weight (the NetForceZero event), adds its time and velocity to
+// the quantities when every level reaches it. A drop too short to get there is judged on the impact.
+// The FixedStep update is first order in the velocity, expect p close to 1 there.
+
+namespace FreeFallSim
+{
+
+    struct FreeFallConvergenceProfile
+    {
+        std::size_t min_levels{3};                    // runs before the tolerance is checked, at least 3 for an order
+        std::size_t max_levels{10};                   // the finest step is time_step / 2^(max_levels-1)
+        double abs_tolerance{0.0};                    // a level meets the tolerance when every quantity has
+        double rel_tolerance{1e-3};                   // error <= abs_tolerance + rel_tolerance * |extrapolated|
+        double net_force_epsilon{1e-3};               // terminal state threshold relative to the weight, 0 leaves it out
+    };
+
+    // One run of the study, velocities in m/s positive downward as in the batch summaries
+    struct FreeFallConvergenceLevel
+    {
+        float time_step{0.0f};                        // (t) s
+        std::uint64_t steps{0};                       // integration steps taken, the cost of the level
+        double wall_time_s{0.0};
+        double impact_time{0.0};                      // (t) s of the ground impact
+        double impact_velocity{0.0};                  // (v) m/s at the impact
+        double terminal_time{std::numeric_limits<double>::quiet_NaN()};     // (t) s of the NetForceZero event, NaN when the run did not reach it
+        double terminal_velocity{std::numeric_limits<double>::quiet_NaN()}; // (v) m/s at that event
+        double impact_time_error{0.0};                // estimated |value - extrapolated| of the quantities,
+        double impact_velocity_error{0.0};            // NaN for the terminal ones unless every level reached it
+        double terminal_time_error{std::numeric_limits<double>::quiet_NaN()};
+        double terminal_velocity_error{std::numeric_limits<double>::quiet_NaN()};
+        bool meets_tolerance{false};
+    };
+
+    // Observed behaviour of one quantity over the three finest levels
+    struct FreeFallConvergenceEstimate
+    {
+        double observed_order{std::numeric_limits<double>::quiet_NaN()}; // NaN unless the differences shrink, infinity once they vanish
+        double extrapolated{std::numeric_limits<double>::quiet_NaN()}; // Richardson value, the finest value when no order was observed
+    };
+
+    struct FreeFallConvergenceResult
+    {
+        std::vector<FreeFallConvergenceLevel> levels; // coarsest first
+        FreeFallConvergenceEstimate impact_time;
+        FreeFallConvergenceEstimate impact_velocity;
+        FreeFallConvergenceEstimate terminal_time;
+        FreeFallConvergenceEstimate terminal_velocity;
+        bool terminal_reached{false};                 // every level reported the NetForceZero event, the terminal quantities count
+        bool converged{false};                        // some level meets the tolerance
+        std::size_t recommended_level{0};             // cheapest level meeting the tolerance, the finest one otherwise
+        float recommended_time_step{0.0f};            // time_step of that level
+    };
+
+    // p from the values at h, h/2 and h/4 as above, NaN when the differences do not shrink and
+    // infinity when the finer one is exactly zero
+    double observed_order(double coarse, double medium, double fine);
+    // q* from the values at h/2 and h/4 and the order, fine itself for an order which is not finite and positive
+    double richardson_extrapolate(double medium, double fine, double order);
+
+    // Runs the levels until one meets the tolerance or max_levels ran, each with the whole profile of
+    // sim_freefall_vars (integrator, locate_impact, steady state fast forward) apart from the time step and
+    // the sampling and net_force_epsilon, the runs only keep their impact and their NetForceZero event.
+    // When no order is observed the finest level is compared with the one before instead and the study
+    // keeps halving, so a tolerance is only declared met inside the asymptotic range or after convergence.
+    // throws std::invalid_argument on time_step <= 0 or min_levels outside [3, max_levels], std::runtime_error
+    // when a run does not reach the ground before finish_time
+    FreeFallConvergenceResult run_convergence_study(GravityProfile gravity_profile, const FreeFallObjProfile& sim_obj_profile,
+        const FreeFallSimulationProfile& sim_freefall_vars, const FreeFallConvergenceProfile& convergence = {});
+
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef FREEFALL_DEMO_PROFILES_H
+#define FREEFALL_DEMO_PROFILES_H
+#pragma once
+#include <limits>
+#include "freefall_dragforce_simulation.h"
+
+// The ball of FreeFallUnderDragForceBall, shared by the tests, the benchmarks and the tools as their
+// starting point. Callers change the fields their case is about on the returned copies.
+
+namespace FreeFallSim
+{
+
+    // Tennis ball in sea level air
+    inline FreeFallObjProfile make_demo_ball_profile()
+    {
+        FreeFallObjProfile sim_obj_profile;
+        sim_obj_profile.fluid_density_air = 1.22;
+        sim_obj_profile.kDragCoefficient = 0.47;
+        sim_obj_profile.mass_of_object = 0.0577;
+        sim_obj_profile.radius_of_object = 0.06661/2;
+        return sim_obj_profile;
+    }
+
+    // Released at rest from 400 m, 10 ms steps, runs until impact
+    inline FreeFallSimulationProfile make_demo_sim_vars()
+    {
+        FreeFallSimulationProfile sim_freefall_vars;
+        sim_freefall_vars.velocity = 0.0;
+        sim_freefall_vars.position = 400;
+        sim_freefall_vars.gravity_acceleration = 9.81;
+        sim_freefall_vars.time_step = 0.01;
+        sim_freefall_vars.sample_factor = 10;
+        sim_freefall_vars.finish_time = std::numeric_limits<int>::max();
+        return sim_freefall_vars;
+    }
+
+}
+
+#endif
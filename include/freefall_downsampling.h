@@ -0,0 +1,29 @@
+#ifndef FREEFALL_DOWNSAMPLING_H
+#define FREEFALL_DOWNSAMPLING_H
+#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace FreeFallSim
+{
+
+    // Reduced series handed to the plotting calls
+    struct FreeFallDownsampled
+    {
+        std::vector<double> x;
+        std::vector<double> y;
+    };
+
+    // Largest-Triangle-Three-Buckets (Steinarsson 2013). Keeps the first and last point and from each of
+    // the threshold-2 buckets in between the point forming the largest triangle with the previously kept
+    // point and the average of the next bucket, so peaks and knees of the curve survive the reduction.
+    // Returns the kept indices in increasing order, all of them when threshold is 0 or not below the size.
+    // Thresholds below 3 keep the first, last and one middle point.
+    std::vector<std::size_t> lttb_indices(const std::vector<double>& x, const std::vector<double>& y, std::size_t threshold);
+
+    // x and y reduced to at most threshold points with lttb_indices()
+    FreeFallDownsampled lttb_downsample(const std::vector<double>& x, const std::vector<double>& y, std::size_t threshold);
+
+}
+
+#endif
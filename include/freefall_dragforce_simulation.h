@@ -1,19 +1,24 @@
 #ifndef FREEFALL_DRAGFROCE_SIMULATION_H
 #define FREEFALL_DRAGFROCE_SIMULATION_H
 #pragma once
+#include <cstdint>
 #include <iostream>
+#include <limits>
 #include <variant>
 #include <vector>
 #include <math.h>
 #include <cmath>
-#include <matplot/matplot.h>
-
-#define ENABLE_CONSOLE_PRINT 1
 
 namespace FreeFallSim
 {
 
     enum class GravityProfile { ConstantGravity, NewtonGravitationModel };
+    // FixedStep is the original time_step update, DormandPrince45 an adaptive embedded Runge-Kutta 5(4),
+    // ClosedForm evaluates the analytic constant gravity solution (Newton model and upward releases fall back to FixedStep)
+    enum class IntegratorProfile { FixedStep, DormandPrince45, ClosedForm };
+    // HeightModulo is the original rounded height % sample_factor rule, TimeInterval samples at exact
+    // multiples of sample_interval, MaxPoints spreads at most max_points samples over the flight time
+    enum class SamplingProfile { HeightModulo, TimeInterval, MaxPoints };
     
     // Struct representing ball characteristics used to approximate ball object dynamics
     // which is used in drag force and weight force equations. 
@@ -25,7 +30,8 @@ namespace FreeFallSim
         double fluid_density_air;        // (rho) 
     };
 
-    // Assuming Earth as Planet for default constants
+    // Assuming Earth as Planet for default constants. A field which changes the trajectory must also be
+    // hashed by hash_profiles() in freefall_result_cache.cpp.
     struct FreeFallSimulationProfile
     {
         double kUniversalGravitationConst{6.673e-11}; // (G)Nm/kg^2 Universal Gravitational Constant
@@ -37,43 +43,56 @@ namespace FreeFallSim
         float time_step;                              // (t) simulation update factor  
         int sample_factor;                            //  factor to increase or decrease output on plots and samples collected  
         int finish_time{std::numeric_limits<int>::max()}; // used to finish the simulation if it falls within the calculation bounds
+        IntegratorProfile integrator{IntegratorProfile::FixedStep}; // update scheme, adaptive schemes use time_step as first trial step
+        double abs_tolerance{1e-6};                   // absolute error tolerance per step for adaptive integrators
+        double rel_tolerance{1e-6};                   // relative error tolerance per step for adaptive integrators
+        bool console_output{false};                   // echo every sample on std::cout from run_sim()
+        SamplingProfile sampling{SamplingProfile::HeightModulo}; // which states run_sim() records
+        double sample_interval{0.1};                  // s between samples for TimeInterval sampling
+        std::size_t max_points{1000};                 // sample budget for MaxPoints sampling
+        bool locate_impact{true};                     // end the run at the located ground crossing instead of one step below it
+        std::vector<double> event_heights;            // m, report the first time each of these heights is crossed
+        double net_force_epsilon{0.0};                // > 0 reports the first time |net force| <= epsilon * weight
+        bool steady_state_fast_forward{false};        // jump to the ground once terminal velocity is reached (FixedStep)
+        double steady_state_tolerance{1e-9};          // terminal velocity is reached when |a - a_steady| <= tolerance * g
+    };
+
+    // Integration cost of a run so fixed and adaptive schemes can be compared
+    struct FreeFallIntegratorStats
+    {
+        std::uint64_t steps_taken{0};                 // accepted steps
+        std::uint64_t steps_rejected{0};              // steps repeated because the error estimate exceeded the tolerance
+        double wall_time_s{0.0};                      // wall time of run_sim
+        double fast_forward_time{0.0};                // (t) s of flight covered by the steady state jump instead of steps
+    };
+
+    enum class FreeFallEventKind { GroundImpact, HeightReached, NetForceZero };
+
+    // Event located inside the step which crossed it, velocity in the plot convention (negative while falling)
+    struct FreeFallEvent
+    {
+        FreeFallEventKind kind;
+        double time;                                  // (t) s
+        double position;                              // (x) m, the requested height for HeightReached
+        double velocity;                              // (v) m/s
+        double net_force;                             // (F) N
     };
 
     class FreeFallSimPlot
     {
-        // Data struct for matplot to plot the FreeFall 
+        // Data struct of a run, drawn by the FreeFallSimPlotting target (freefall_plot.h) or exported
+        // off-thread through freefall_figure_export.h
 
         public:
         std::vector<double> time_data;
         std::vector<double> velocity_data;
         std::vector<double> netforce_data;
         std::vector<double> position_data;
+        FreeFallIntegratorStats integrator_stats;
+        std::vector<FreeFallEvent> events;
 
-        void plot_time_vs_velocity()
-        {
-            matplot::plot(this->time_data, this->velocity_data);
-            matplot::title("Time(s) vs Velocity(m/s)");
-            matplot::xlabel("Time(s)");
-            matplot::ylabel("Velocity(m/s)");
-            matplot::show();
-        }
-        void plot_time_vs_position()
-        {
-            matplot::plot(this->time_data, this->position_data);
-            matplot::title("Time(s) vs Position(m)");
-            matplot::xlabel("Time(s)");
-            matplot::ylabel("Position(m)");
-            matplot::show();
-        }
-
-        void plot_time_vs_force()
-        {
-            matplot::plot(this->time_data, this->netforce_data);
-            matplot::title("Time(s) vs NetForce(N)");
-            matplot::xlabel("Time(s)");
-            matplot::ylabel("NetForce(N)");
-            matplot::show();
-        }
+        // Plots are reduced to this many points with LTTB, 0 plots every sample
+        static constexpr std::size_t kDefaultPlotPoints{2000};
     };
 
     //   Fd = Cd*rho*v^2*pi*r^2  
@@ -102,66 +121,156 @@ namespace FreeFallSim
         round_to(10.0078, 3) = 9
         round_to(10.0078, 4) = 12
     */
-    static auto round_to(double value, double precision = 1.0)
+    inline auto round_to(double value, double precision = 1.0)
     {
         return std::round(value / precision) * precision;
     }
 
     //NOTE: Based on given two gravity model classes were created deliberately separate
-    // this is to show the strength of modern C++ 17 standard provided features aka visit and variant 
+    // this is to show the strength of modern C++ 17 standard provided features aka visit and variant.
+    // Both models are now specializations of one SimEngine template, the class names are kept as aliases
+    // so each model is still its own type inside the variant.
 
+    // Gravity and drag policies of SimEngine. prepare() folds every per object invariant
+    // (G*M, Cd*rho*pi*r^2/m, ...) once per run, the step itself only evaluates accelerations.
 
-    // Simulator class to hold method for free fall simulation under the fluid drag
-    class FreeFallConstGravitySimlation
+    // a = Fw/m = g
+    struct ConstantGravityPolicy
     {
-        public:
-        // ctor init FreeFall simulation data structs
-        explicit FreeFallConstGravitySimlation(FreeFallObjProfile sim_obj_profile, FreeFallSimulationProfile sim_freefall_vars, 
-        FreeFallSimPlot sim_plot_vars): m_sim_obj_profile(std::move(sim_obj_profile)), 
-        m_freefall_sim_vars(std::move(sim_freefall_vars)), m_freefall_sim_plot_vars(std::move(sim_plot_vars))
-        {}
-        
-        FreeFallSimPlot run_sim();
-
-        FreeFallConstGravitySimlation(const FreeFallConstGravitySimlation& src) = default;
-        FreeFallConstGravitySimlation& operator=(const FreeFallConstGravitySimlation& src) = default;
-        FreeFallConstGravitySimlation(FreeFallConstGravitySimlation&& src) = default;
-        FreeFallConstGravitySimlation& operator=(FreeFallConstGravitySimlation&& src) = default;
-        ~FreeFallConstGravitySimlation() = default;
-
-        private:
-        FreeFallObjProfile m_sim_obj_profile;
-        FreeFallSimulationProfile m_freefall_sim_vars;
-        FreeFallSimPlot m_freefall_sim_plot_vars;
+        static constexpr const char* kName{"ConstantGravity"};  // part of the result cache key
+        static constexpr GravityProfile kGravityProfile{GravityProfile::ConstantGravity};
+        struct Coefficients
+        {
+            double gravity;                 // (g) m/s^2
+        };
+        static Coefficients prepare(const FreeFallObjProfile& sim_obj_profile, const FreeFallSimulationProfile& sim_vars)
+        {
+            return {const_weight_force(sim_obj_profile, sim_vars) / sim_obj_profile.mass_of_object};
+        }
+        static constexpr double acceleration(const Coefficients& coefficients, double)
+        {
+            return coefficients.gravity;
+        }
+    };
 
+    // a = Fw/m = GM / (R+x)^2
+    struct NewtonGravityPolicy
+    {
+        static constexpr const char* kName{"NewtonGravity"};  // part of the result cache key
+        static constexpr GravityProfile kGravityProfile{GravityProfile::NewtonGravitationModel};
+        struct Coefficients
+        {
+            double gravitational_parameter; // (G*M) m^3/s^2
+            double planet_radius;           // (R) m
+        };
+        static Coefficients prepare(const FreeFallObjProfile&, const FreeFallSimulationProfile& sim_vars)
+        {
+            return {sim_vars.kUniversalGravitationConst * sim_vars.kMassOfPlanet, sim_vars.kRadiusOfPlanet};
+        }
+        static double acceleration(const Coefficients& coefficients, double position)
+        {
+            const auto distance = coefficients.planet_radius + position;
+            return coefficients.gravitational_parameter / (distance * distance);
+        }
     };
 
-    class FreeFallNewtonGravitySimlation
+    // a = Fd/m = Cd*rho*pi*r^2/m * v^2, like drag_force it does not flip with the direction of motion
+    struct QuadraticDragPolicy
     {
+        static constexpr const char* kName{"QuadraticDrag"};  // part of the result cache key
+        struct Coefficients
+        {
+            double drag_per_mass;           // (Cd*rho*pi*r^2/m) 1/m
+        };
+        static Coefficients prepare(const FreeFallObjProfile& sim_obj_profile, const FreeFallSimulationProfile&)
+        {
+            return {sim_obj_profile.kDragCoefficient * sim_obj_profile.fluid_density_air * M_PI *
+                sim_obj_profile.radius_of_object * sim_obj_profile.radius_of_object / sim_obj_profile.mass_of_object};
+        }
+        static double acceleration(const Coefficients& coefficients, double, double velocity)
+        {
+            return coefficients.drag_per_mass * velocity * velocity;
+        }
+        // speed where drag balances the given gravity
+        static double terminal_velocity(const Coefficients& coefficients, double, double gravity)
+        {
+            return coefficients.drag_per_mass > 0.0 ? std::sqrt(gravity / coefficients.drag_per_mass) : std::numeric_limits<double>::infinity();
+        }
+    };
+
+    // Integrator and sampler policies, defined in freefall_sim_engine.h
+    struct FixedStepIntegrator;
+    struct DormandPrince45Integrator;
+    struct ClosedFormIntegrator;
+    struct ProfileSelectedIntegrator;
+    struct HeightModuloSampler;
+    struct TimeIntervalSampler;
+    struct MaxPointsSampler;
+    struct ProfileSelectedSampler;
 
+    class FreeFallTrajectorySink;
+    struct FreeFallRunStats;
+
+    // Simulator class to hold method for free fall simulation under the fluid drag.
+    // Every combination of policies compiles to its own specialized integration loop. The member
+    // definitions live in freefall_sim_engine.h, the two aliases below are instantiated in the library.
+    template <typename GravityPolicy, typename DragPolicy, typename Integrator, typename Sampler>
+    class SimEngine
+    {
         public:
+        static constexpr GravityProfile kGravityProfile{GravityPolicy::kGravityProfile};
+
         // ctor init FreeFall simulation data structs
-        explicit FreeFallNewtonGravitySimlation(FreeFallObjProfile sim_obj_profile, FreeFallSimulationProfile sim_freefall_vars, 
+        explicit SimEngine(FreeFallObjProfile sim_obj_profile, FreeFallSimulationProfile sim_freefall_vars, 
         FreeFallSimPlot sim_plot_vars): m_sim_obj_profile(std::move(sim_obj_profile)), 
         m_freefall_sim_vars(std::move(sim_freefall_vars)), m_freefall_sim_plot_vars(std::move(sim_plot_vars))
         {}
         
         FreeFallSimPlot run_sim();
+        // Streams the samples into sink instead of the plot data
+        FreeFallIntegratorStats run_sim(FreeFallTrajectorySink& sink);
+        // Same runs, additionally filling run_stats (see freefall_run_stats.h)
+        FreeFallSimPlot run_sim(FreeFallRunStats& run_stats);
+        FreeFallIntegratorStats run_sim(FreeFallTrajectorySink& sink, FreeFallRunStats& run_stats);
 
+        const FreeFallObjProfile& sim_obj_profile() const { return m_sim_obj_profile; }
+        const FreeFallSimulationProfile& sim_freefall_vars() const { return m_freefall_sim_vars; }
 
-        FreeFallNewtonGravitySimlation(const FreeFallNewtonGravitySimlation& src) = default;
-        FreeFallNewtonGravitySimlation& operator=(const FreeFallNewtonGravitySimlation& src) = default;
-        FreeFallNewtonGravitySimlation(FreeFallNewtonGravitySimlation&& src) = default;
-        FreeFallNewtonGravitySimlation& operator=(FreeFallNewtonGravitySimlation&& src) = default;
-        ~FreeFallNewtonGravitySimlation() = default;
+        SimEngine(const SimEngine& src) = default;
+        SimEngine& operator=(const SimEngine& src) = default;
+        SimEngine(SimEngine&& src) = default;
+        SimEngine& operator=(SimEngine&& src) = default;
+        ~SimEngine() = default;
 
         private:
+        FreeFallSimPlot run_sim_to_plot(FreeFallRunStats* run_stats);
+
         FreeFallObjProfile m_sim_obj_profile;
         FreeFallSimulationProfile m_freefall_sim_vars;
         FreeFallSimPlot m_freefall_sim_plot_vars;
 
     };
 
+    using FreeFallConstGravitySimlation = SimEngine<ConstantGravityPolicy, QuadraticDragPolicy, ProfileSelectedIntegrator, ProfileSelectedSampler>;
+    using FreeFallNewtonGravitySimlation = SimEngine<NewtonGravityPolicy, QuadraticDragPolicy, ProfileSelectedIntegrator, ProfileSelectedSampler>;
+    extern template class SimEngine<ConstantGravityPolicy, QuadraticDragPolicy, ProfileSelectedIntegrator, ProfileSelectedSampler>;
+    extern template class SimEngine<NewtonGravityPolicy, QuadraticDragPolicy, ProfileSelectedIntegrator, ProfileSelectedSampler>;
+
+    // Gravity models which can be run through a uniform std::visit call
+    using FreeFallSimModels = std::variant<FreeFallConstGravitySimlation, FreeFallNewtonGravitySimlation>;
+
+    struct Simulator
+    {
+        [[nodiscard]] FreeFallSimPlot operator() (FreeFallConstGravitySimlation& const_gravity_simulation)
+        {
+            return const_gravity_simulation.run_sim();
+        }
+        [[nodiscard]] FreeFallSimPlot operator() (FreeFallNewtonGravitySimlation& newton_gravity_simulation)
+        {
+            return newton_gravity_simulation.run_sim();
+        }
+    };
+
 }
 
 #endif
@@ -0,0 +1,121 @@
+#ifndef FREEFALL_ENSEMBLE_SIMULATION_H
+#define FREEFALL_ENSEMBLE_SIMULATION_H
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "freefall_dragforce_simulation.h"
+
+namespace FreeFallSim
+{
+
+    // Outcome of an ensemble run, every vector is indexed in the order objects were added
+    struct FreeFallEnsembleResult
+    {
+        std::vector<double> impact_time;          // (t) s step count * time_step of the step that crossed the ground
+        std::vector<double> impact_height;        // (x) m height after the last step, <= 0 unless finish_time stopped it
+        std::vector<double> impact_velocity;      // (v) m/s velocity after the last step, positive downward as in run_sim
+        std::vector<std::uint64_t> steps;         // integration steps taken by each object
+        std::uint64_t total_object_steps{0};      // sum of steps over all objects
+        double wall_time_s{0.0};                  // wall time spent in the integration kernel
+        double object_steps_per_second{0.0};      // total_object_steps / wall_time_s
+    };
+
+    // Structure-of-arrays engine which advances many drops of the same gravity model together.
+    // Per object coefficients are derived once from drag_force, const_weight_force and
+    // newton_gravitational_force, the kernel then integrates with the same update as run_sim()
+    // in AVX-512 or AVX2 registers depending on the compile target, 8 or 4 lanes of double,
+    // 16 or 8 lanes of float (one lane each without them, FREEFALL_ENABLE_NATIVE_ARCH turns them on). A lane is masked off as soon as its object reaches the ground and
+    // is refilled with the next pending object, so drops of very different length do not leave lanes idle.
+    //
+    // The double engine matches the scalar run_sim() with sample_factor 1 and locate_impact off
+    // (last sample == impact state) within kEnsembleRelativeTolerance, the difference comes from
+    // evaluating the forces through precomputed coefficients instead of the force lambdas on every step.
+    //
+    // The float engine keeps the state in single precision for twice the lanes. Time is never
+    // accumulated, it is the step count times time_step, and the count stays exact in float up to
+    // 2^24 steps, so max steps are capped there. Position is the accumulation that drifts: a long
+    // drop adds millions of decrements of a few mm to a height of km, each rounded to the float
+    // spacing of the height. With compensated on the position is summed with Kahan's compensation
+    // which carries the lost low bits to the next step, see measure_float_ensemble_error().
+    template <typename Scalar>
+    class FreeFallBasicEnsembleSimulation
+    {
+        static_assert(std::is_same_v<Scalar, double> || std::is_same_v<Scalar, float>, "ensemble state is double or float");
+
+        public:
+        using scalar_type = Scalar;
+        static constexpr double kEnsembleRelativeTolerance{1e-9};
+
+        // compensated defaults to on for float, the double path stays the plain update of run_sim()
+        explicit FreeFallBasicEnsembleSimulation(GravityProfile gravity_profile, bool compensated = std::is_same_v<Scalar, float>):
+            m_gravity_profile(gravity_profile), m_compensated(compensated)
+        {}
+
+        void add_object(const FreeFallObjProfile& sim_obj_profile, const FreeFallSimulationProfile& sim_freefall_vars);
+        void reserve(std::size_t count);
+        std::size_t size() const { return m_position.size(); }
+        GravityProfile gravity_profile() const { return m_gravity_profile; }
+        bool compensated() const { return m_compensated; }
+
+        FreeFallEnsembleResult run_sim() const;
+
+        // Name of the SIMD kernel selected at compile time ("avx512", "avx2" or "scalar")
+        static const char* simd_backend();
+        // Objects advanced per instruction by that kernel
+        static int simd_lanes();
+
+        private:
+        GravityProfile m_gravity_profile;
+        bool m_compensated;
+        std::vector<Scalar> m_position;         // (x) m initial height
+        std::vector<Scalar> m_velocity;         // (v) m/s initial velocity
+        std::vector<Scalar> m_drag_coeff;       // Cd*rho*pi*r^2 / m, drag acceleration per v^2
+        std::vector<Scalar> m_gravity_coeff;    // g for constant gravity, G*M for the Newton model
+        std::vector<Scalar> m_planet_radius;    // (R) m, only used by the Newton model
+        std::vector<Scalar> m_time_step;        // (t) s
+        std::vector<Scalar> m_max_steps;        // finish_time expressed in steps
+    };
+
+    extern template class FreeFallBasicEnsembleSimulation<double>;
+    extern template class FreeFallBasicEnsembleSimulation<float>;
+    using FreeFallEnsembleSimulation = FreeFallBasicEnsembleSimulation<double>;
+    using FreeFallFloatEnsembleSimulation = FreeFallBasicEnsembleSimulation<float>;
+
+    using FreeFallEnsembleProfiles = std::vector<std::pair<FreeFallObjProfile, FreeFallSimulationProfile>>;
+
+    // Error of a float ensemble against the double ensemble over the same objects, relative to the double result.
+    // Impact times are whole steps, a float run crossing the ground one step earlier or later is off by one
+    // time_step, max_impact_step_difference counts those steps.
+    struct FreeFallPrecisionError
+    {
+        double max_impact_time_error{0.0};
+        double mean_impact_time_error{0.0};
+        double max_impact_velocity_error{0.0};    // terminal velocity for the drops long enough to reach it
+        double mean_impact_velocity_error{0.0};
+        std::uint64_t max_impact_step_difference{0};
+        std::size_t worst_impact_time_object{0};
+        std::size_t worst_impact_velocity_object{0};
+        double double_object_steps_per_second{0.0};
+        double float_object_steps_per_second{0.0};
+    };
+
+    // Error budget of the compensated float ensemble over standard_precision_profiles(), checked by the tests.
+    // Uncompensated the float position drifts by up to 0.7% of the impact time (thousands of steps on
+    // the 10 km drops at 1 ms) and the velocity stalls ~1e-4 short of terminal.
+    constexpr std::uint64_t kFloatImpactStepBudget{1};
+    constexpr double kFloatImpactVelocityBudget{1e-6};
+
+    // The ball of the demo (0.0577 kg, 66.61 mm, Cd 0.47 in air of 1.22 kg/m^3) and a ten times heavier
+    // one, released from rest at 10 m to 10 km with time steps of 10 ms and 1 ms, sample_factor 1, locate_impact off
+    FreeFallEnsembleProfiles standard_precision_profiles();
+
+    // Runs the profiles through the double and the float ensemble and compares impact time and velocity
+    FreeFallPrecisionError measure_float_ensemble_error(GravityProfile gravity_profile, const FreeFallEnsembleProfiles& profiles,
+        bool compensated = true);
+
+}
+
+#endif
@@ -0,0 +1,227 @@
+#ifndef FREEFALL_EVENTS_H
+#define FREEFALL_EVENTS_H
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <vector>
+#include "freefall_dragforce_simulation.h"
+#include "freefall_trajectory_sink.h"
+
+// Event location and the steady state descent used by the integrators in freefall_sim_engine.h
+
+namespace FreeFallSim
+{
+
+    // Root of f in [lower, upper] given f(lower) and f(upper) of opposite sign (or zero). Illinois
+    // variant of regula falsi: converges superlinearly on the smooth step polynomials and can not
+    // leave the bracket, stops once the bracket is narrower than tolerance.
+    template <typename Function>
+    double locate_root(Function&& f, double lower, double upper, double f_lower, double f_upper, double tolerance)
+    {
+        if (f_lower == 0.0)
+            return lower;
+        if (f_upper == 0.0)
+            return upper;
+        int retained_side{0};
+        for (int iteration = 0; iteration < 100 && upper - lower > tolerance; ++iteration)
+        {
+            const auto point = (lower * f_upper - upper * f_lower) / (f_upper - f_lower);
+            const auto f_point = f(point);
+            if (f_point == 0.0)
+                return point;
+            if ((f_point < 0.0) == (f_lower < 0.0))
+            {
+                lower = point;
+                f_lower = f_point;
+                // the upper end survived twice in a row, halve its weight
+                if (retained_side == 1)
+                    f_upper *= 0.5;
+                retained_side = 1;
+            }
+            else
+            {
+                upper = point;
+                f_upper = f_point;
+                if (retained_side == -1)
+                    f_lower *= 0.5;
+                retained_side = -1;
+            }
+        }
+        return (lower * f_upper - upper * f_lower) / (f_upper - f_lower);
+    }
+
+    // State inside a step, velocity positive downward, acceleration of the force model at that state
+    struct FreeFallStepState
+    {
+        double position;
+        double velocity;
+        double acceleration;
+    };
+
+    // Height and net force events still pending in a run. The integrators hand every step to
+    // check_step() together with the dense output of the step, a state_at(tau) callable.
+    class FreeFallEventTracker
+    {
+        public:
+        // weight_acceleration is the gravity the net force threshold is relative to
+        FreeFallEventTracker(const FreeFallSimulationProfile& sim_vars, double weight_acceleration):
+            m_pending_heights(sim_vars.event_heights),
+            m_net_force_threshold(sim_vars.net_force_epsilon * weight_acceleration),
+            m_net_force_pending(sim_vars.net_force_epsilon > 0.0)
+        {}
+
+        // whether sim_vars asks for any height or net force event at all
+        static bool requested(const FreeFallSimulationProfile& sim_vars)
+        {
+            return sim_vars.net_force_epsilon > 0.0 || !sim_vars.event_heights.empty();
+        }
+
+        bool active() const { return m_net_force_pending || !m_pending_heights.empty(); }
+
+        template <typename StateAt>
+        void check_step(double step_start, double step, const FreeFallStepState& start, const FreeFallStepState& end,
+            StateAt&& state_at, double mass, FreeFallTrajectorySink& sink)
+        {
+            const auto tolerance = kTimeTolerance * std::max(1.0, step_start + step);
+            for (auto height = m_pending_heights.begin(); height != m_pending_heights.end();)
+            {
+                const auto f_start = start.position - *height;
+                const auto f_end = end.position - *height;
+                if ((f_start < 0.0) == (f_end < 0.0) && f_end != 0.0)
+                {
+                    ++height;
+                    continue;
+                }
+                const auto tau = locate_root([&](double t) { return state_at(t).position - *height; }, 0.0, step, f_start, f_end, tolerance);
+                const auto state = state_at(tau);
+                sink.event({FreeFallEventKind::HeightReached, step_start + tau, *height, -state.velocity, state.acceleration * mass});
+                height = m_pending_heights.erase(height);
+            }
+            if (m_net_force_pending)
+            {
+                auto excess = [&](const FreeFallStepState& state) { return std::abs(state.acceleration) - m_net_force_threshold; };
+                const auto f_start = excess(start);
+                const auto f_end = excess(end);
+                if (f_start <= 0.0 || f_end <= 0.0)
+                {
+                    const auto tau = f_start <= 0.0 ? 0.0 :
+                        locate_root([&](double t) { return excess(state_at(t)); }, 0.0, step, f_start, f_end, tolerance);
+                    const auto state = state_at(tau);
+                    sink.event({FreeFallEventKind::NetForceZero, step_start + tau, state.position, -state.velocity, state.acceleration * mass});
+                    m_net_force_pending = false;
+                }
+            }
+        }
+
+        // Ground crossing inside a step which ends below zero, returns the time into the step
+        template <typename StateAt>
+        static double locate_ground(double step_start, double step, const FreeFallStepState& start, const FreeFallStepState& end,
+            StateAt&& state_at)
+        {
+            const auto tolerance = kTimeTolerance * std::max(1.0, step_start + step);
+            return locate_root([&](double t) { return state_at(t).position; }, 0.0, step, start.position, end.position, tolerance);
+        }
+
+        // Heights below the start of a monotone descent, with time_at_height(h) giving the crossing time
+        template <typename TimeAtHeight, typename StateAtHeight>
+        void check_descent(double start_position, double finish_time, TimeAtHeight&& time_at_height, StateAtHeight&& state_at_height,
+            double mass, FreeFallTrajectorySink& sink)
+        {
+            for (auto height = m_pending_heights.begin(); height != m_pending_heights.end();)
+            {
+                const auto time = *height <= start_position && *height >= 0.0 ? time_at_height(*height) :
+                    std::numeric_limits<double>::infinity();
+                if (time > finish_time)
+                {
+                    ++height;
+                    continue;
+                }
+                const auto state = state_at_height(*height);
+                sink.event({FreeFallEventKind::HeightReached, time, *height, -state.velocity, state.acceleration * mass});
+                height = m_pending_heights.erase(height);
+            }
+        }
+
+        // A pending net force event is reported where the steady state jump starts, the net force
+        // has settled to within the steady state tolerance there
+        void check_steady_state(double time, const FreeFallStepState& state, double mass, FreeFallTrajectorySink& sink)
+        {
+            if (!m_net_force_pending)
+                return;
+            sink.event({FreeFallEventKind::NetForceZero, time, state.position, -state.velocity, state.acceleration * mass});
+            m_net_force_pending = false;
+        }
+
+        private:
+        // events are located to this fraction of the elapsed time
+        static constexpr double kTimeTolerance{1e-13};
+
+        std::vector<double> m_pending_heights;
+        double m_net_force_threshold;
+        bool m_net_force_pending;
+    };
+
+    // Descent from start_position to the ground at the settled velocity of the model, the local terminal
+    // velocity corrected for its drift with height (Model::steady_state_velocity). The flight time of
+    // kPanels equal height panels is integrated with Simpson's rule on 1/v(x), positions between panel
+    // ends are interpolated linearly in time. Exact when vt is constant (constant gravity, quadratic drag),
+    // quasi-steady to first order in the drift otherwise.
+    template <typename Model>
+    class FreeFallSteadyStateDescent
+    {
+        public:
+        static constexpr std::size_t kPanels{64};
+
+        FreeFallSteadyStateDescent(const Model& model, double start_time, double start_position): m_model(model)
+        {
+            const auto panel_height = start_position / kPanels;
+            m_heights[0] = start_position;
+            m_times[0] = start_time;
+            for (std::size_t panel = 1; panel <= kPanels; ++panel)
+            {
+                const auto top = m_heights[panel - 1];
+                const auto bottom = panel == kPanels ? 0.0 : start_position - panel * panel_height;
+                const auto middle = 0.5 * (top + bottom);
+                const auto panel_time = (top - bottom) / 6.0 * (1.0 / model.steady_state_velocity(top) +
+                    4.0 / model.steady_state_velocity(middle) + 1.0 / model.steady_state_velocity(bottom));
+                m_heights[panel] = bottom;
+                m_times[panel] = m_times[panel - 1] + panel_time;
+            }
+        }
+
+        double impact_time() const { return m_times[kPanels]; }
+
+        double time_at(double height) const
+        {
+            const auto upper = std::upper_bound(m_heights.begin(), m_heights.end(), height, std::greater<double>());
+            const auto panel = std::clamp<std::size_t>(upper - m_heights.begin(), 1, kPanels);
+            const auto fraction = (m_heights[panel - 1] - height) / (m_heights[panel - 1] - m_heights[panel]);
+            return m_times[panel - 1] + fraction * (m_times[panel] - m_times[panel - 1]);
+        }
+
+        double position_at(double time) const
+        {
+            const auto upper = std::upper_bound(m_times.begin(), m_times.end(), time);
+            const auto panel = std::clamp<std::size_t>(upper - m_times.begin(), 1, kPanels);
+            const auto fraction = (time - m_times[panel - 1]) / (m_times[panel] - m_times[panel - 1]);
+            return std::max(0.0, m_heights[panel - 1] - fraction * (m_heights[panel - 1] - m_heights[panel]));
+        }
+
+        FreeFallStepState state_at_height(double height) const
+        {
+            const auto velocity = m_model.steady_state_velocity(height);
+            return {height, velocity, m_model.acceleration(height, velocity)};
+        }
+
+        private:
+        const Model& m_model;
+        std::array<double, kPanels + 1> m_heights;
+        std::array<double, kPanels + 1> m_times;
+    };
+
+}
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef FREEFALL_FIGURE_EXPORT_H
+#define FREEFALL_FIGURE_EXPORT_H
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "freefall_bounded_queue.h"
+#include "freefall_dragforce_simulation.h"
+
+// Figures of saved trajectories, rendered off the simulation threads. The core library prepares the
+// data of a figure and runs the export pool, the drawing itself is a renderer callback, e.g.
+// save_figure() of the optional FreeFallSimPlotting target, so nothing here depends on matplot.
+
+namespace FreeFallSim
+{
+
+    enum class FreeFallPlotQuantity { Position, Velocity, NetForce };
+
+    // One line chart over time, ready to be drawn
+    struct FreeFallFigure
+    {
+        std::string title;
+        std::string xlabel;
+        std::string ylabel;
+        std::vector<double> x;
+        std::vector<double> y;
+    };
+
+    // The quantity over time reduced with LTTB to max_points, 0 keeps every sample
+    FreeFallFigure make_figure(const FreeFallSimPlot& sim_plot_vars, FreeFallPlotQuantity quantity,
+        std::size_t max_points = FreeFallSimPlot::kDefaultPlotPoints);
+
+    // One image to produce. The trajectory is either a file written by FreeFallBinaryFileSink, read on
+    // the worker, or plot data the caller already holds and shares with the pool.
+    struct FreeFallFigureJob
+    {
+        std::string trajectory_path;
+        std::shared_ptr<const FreeFallSimPlot> sim_plot_vars;
+        FreeFallPlotQuantity quantity{FreeFallPlotQuantity::Velocity};
+        std::string output_path;                      // the renderer picks the format from the extension (.png, .svg)
+        std::size_t max_points{FreeFallSimPlot::kDefaultPlotPoints};
+    };
+
+    struct FreeFallFigureExportReport
+    {
+        std::uint64_t rendered{0};
+        std::uint64_t failed{0};
+        std::vector<std::string> errors;              // output path and message of every failed job
+    };
+
+    // Background pool turning figure jobs into image files. submit() only queues the job, it blocks
+    // when queue_capacity jobs are already waiting, so a producer far ahead of the renderers is held
+    // back instead of piling up trajectories in memory. Every worker loads and downsamples its job on
+    // its own and then calls the renderer, which may be called from several threads at once. It has
+    // to be safe for that, save_figure() is by serializing the drawing on one shared figure.
+    class FreeFallFigureExportPool
+    {
+        public:
+        // renderer(figure, output_path) writes the image and throws on failure
+        using Renderer = std::function<void(const FreeFallFigure&, const std::string&)>;
+
+        // thread_count 0 uses std::thread::hardware_concurrency()
+        explicit FreeFallFigureExportPool(Renderer renderer, std::size_t thread_count = 0, std::size_t queue_capacity = 64);
+        // waits for the queued jobs
+        ~FreeFallFigureExportPool();
+
+        FreeFallFigureExportPool(const FreeFallFigureExportPool& src) = delete;
+        FreeFallFigureExportPool& operator=(const FreeFallFigureExportPool& src) = delete;
+
+        // false once the pool is shutting down
+        bool submit(FreeFallFigureJob job);
+        // Blocks until every job submitted so far is done, returns the tally since the last wait()
+        FreeFallFigureExportReport wait();
+
+        std::size_t thread_count() const { return m_threads.size(); }
+
+        private:
+        void worker_loop();
+
+        Renderer m_renderer;
+        FreeFallBoundedQueue<FreeFallFigureJob> m_jobs;
+        std::vector<std::thread> m_threads;
+        std::mutex m_mutex;
+        std::condition_variable m_idle;
+        std::uint64_t m_pending{0};
+        FreeFallFigureExportReport m_report;
+    };
+
+}
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef FREEFALL_MONTE_CARLO_H
+#define FREEFALL_MONTE_CARLO_H
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "freefall_dragforce_simulation.h"
+#include "freefall_parallel_sweep.h"
+#include "freefall_sim_engine.h"
+#include "freefall_streaming_stats.h"
+#include "freefall_trajectory_sink.h"
+
+// Monte Carlo propagation of uncertain object parameters to the impact time and speed. Runs stream
+// into per worker statistics, no FreeFallSimPlot is kept, memory is O(bins) whatever the sample count.
+
+namespace FreeFallSim
+{
+
+    // Philox4x32-10 counter based generator (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3").
+    // The output is a pure function of counter and key, sample i draws from counter i on any thread in
+    // any order, so a run gives the same samples for every thread count.
+    class FreeFallPhilox4x32
+    {
+        public:
+        using Counter = std::array<std::uint32_t, 4>;
+        using Key = std::array<std::uint32_t, 2>;
+
+        static Counter block(Counter counter, Key key)
+        {
+            for (int round = 0; round < 10; ++round)
+            {
+                if (round > 0)
+                {
+                    key[0] += kWeyl0;
+                    key[1] += kWeyl1;
+                }
+                const auto product0 = std::uint64_t{kMultiplier0} * counter[0];
+                const auto product1 = std::uint64_t{kMultiplier1} * counter[2];
+                counter = {static_cast<std::uint32_t>(product1 >> 32) ^ counter[1] ^ key[0], static_cast<std::uint32_t>(product1),
+                    static_cast<std::uint32_t>(product0 >> 32) ^ counter[3] ^ key[1], static_cast<std::uint32_t>(product0)};
+            }
+            return counter;
+        }
+
+        // uniform in the open interval (0, 1) from two words, the top 52 bits shifted by half a unit so
+        // neither end can come out
+        static double uniform(std::uint32_t high, std::uint32_t low)
+        {
+            const auto bits = ((std::uint64_t{high} << 32) | low) >> 12;
+            return (static_cast<double>(bits) + 0.5) * 0x1.0p-52;
+        }
+
+        private:
+        static constexpr std::uint32_t kMultiplier0{0xD2511F53};
+        static constexpr std::uint32_t kMultiplier1{0xCD9E8D57};
+        static constexpr std::uint32_t kWeyl0{0x9E3779B9};
+        static constexpr std::uint32_t kWeyl1{0xBB67AE85};
+    };
+
+    // Distribution of one uncertain parameter, Fixed keeps the value of the base profile.
+    // Normal may draw values <= 0 when the spread is wide, LogNormal is the safe choice for masses and sizes.
+    struct FreeFallUncertainty
+    {
+        enum class Kind { Fixed, Uniform, Normal, LogNormal };
+
+        Kind kind{Kind::Fixed};
+        double first{0.0};                            // Uniform lower bound, Normal mean, LogNormal median
+        double second{0.0};                           // Uniform upper bound, Normal standard deviation, LogNormal sigma of ln(x)
+
+        static FreeFallUncertainty uniform(double lower, double upper) { return {Kind::Uniform, lower, upper}; }
+        static FreeFallUncertainty normal(double mean, double stddev) { return {Kind::Normal, mean, stddev}; }
+        static FreeFallUncertainty log_normal(double median, double sigma) { return {Kind::LogNormal, median, sigma}; }
+
+        // value for a uniform draw u in (0, 1) and a standard normal draw z
+        double draw(double base_value, double uniform_draw, double normal_draw) const;
+    };
+
+    struct FreeFallMonteCarloProfile
+    {
+        std::uint64_t sample_count{10000};
+        std::uint64_t seed{0};
+        FreeFallUncertainty mass_of_object;           // (m) kg
+        FreeFallUncertainty radius_of_object;         // (r) m
+        FreeFallUncertainty drag_coefficient;         // (Cd)
+        FreeFallUncertainty fluid_density_air;        // (rho) kg/m^3
+        double envelope_bin_width{0.1};               // s per envelope bin, 0 skips the envelopes
+        double envelope_end_time{0.0};                // s covered by the envelopes, 0 is twice the estimated impact time of the base profile,
+                                                      // at most 65536 bins either way
+        double quantile_relative_accuracy{0.005};     // of the impact quantile sketches
+        std::size_t chunk_size{256};                  // samples per pool task
+    };
+
+    // Aggregate of a Monte Carlo run, or of the part one worker ran. Impact statistics cover the
+    // runs which reached the ground before finish_time.
+    struct FreeFallMonteCarloResult
+    {
+        explicit FreeFallMonteCarloResult(double quantile_relative_accuracy = 0.005, FreeFallTimeEnvelope envelope = {});
+
+        // adds the final state of one run, position <= 0 counts as landed
+        void add_run(double end_time, double end_position, double end_velocity);
+        void merge(const FreeFallMonteCarloResult& other);
+        std::size_t memory_bytes() const;
+
+        std::uint64_t sample_count{0};
+        std::uint64_t landed_count{0};
+        FreeFallWelford impact_time;                  // (t) s
+        FreeFallWelford impact_speed;                 // (|v|) m/s
+        FreeFallQuantileSketch impact_time_quantiles;
+        FreeFallQuantileSketch impact_speed_quantiles;
+        FreeFallTimeEnvelope envelope;
+    };
+
+    // Object profile of sample index, parameter p is drawn from Philox block {index, p} under the seed
+    FreeFallObjProfile draw_monte_carlo_profile(const FreeFallObjProfile& base_obj_profile, const FreeFallMonteCarloProfile& monte_carlo,
+        std::uint64_t index);
+
+    // Simulation profile of the runs: samples every envelope bin width plus the final state, nothing else
+    FreeFallSimulationProfile monte_carlo_sim_vars(const FreeFallSimulationProfile& base_sim_vars, const FreeFallMonteCarloProfile& monte_carlo);
+
+    // Empty result with the envelope bins of the run
+    FreeFallMonteCarloResult make_monte_carlo_result(const FreeFallObjProfile& base_obj_profile, const FreeFallSimulationProfile& sim_vars,
+        GravityProfile gravity_profile, const FreeFallMonteCarloProfile& monte_carlo);
+
+    // Feeds the samples of a run into an envelope and keeps its last state
+    class FreeFallMonteCarloSink : public FreeFallTrajectorySink
+    {
+        public:
+        explicit FreeFallMonteCarloSink(FreeFallTimeEnvelope& envelope): m_envelope(envelope)
+        {}
+
+        void begin(std::size_t) override { m_envelope.begin_run(); }
+        void write(double time, double position, double velocity, double) override
+        {
+            m_envelope.add(time, position, velocity);
+            m_last_time = time;
+            m_last_position = position;
+            m_last_velocity = velocity;
+        }
+
+        double last_time() const { return m_last_time; }
+        double last_position() const { return m_last_position; }
+        double last_velocity() const { return m_last_velocity; }
+
+        private:
+        FreeFallTimeEnvelope& m_envelope;
+        double m_last_time{0.0};
+        double m_last_position{0.0};
+        double m_last_velocity{0.0};
+    };
+
+    // Runs monte_carlo.sample_count simulations of the given SimEngine on the pool. Every worker
+    // aggregates into its own result, the partial results are merged in worker order at the end.
+    // The drawn samples, counts, min/max and quantile sketches do not depend on the thread count,
+    // means and variances only up to rounding of the merge order.
+    template <typename Simulation>
+    FreeFallMonteCarloResult run_monte_carlo(const FreeFallObjProfile& base_obj_profile, const FreeFallSimulationProfile& base_sim_vars,
+        const FreeFallMonteCarloProfile& monte_carlo, FreeFallWorkStealingPool& pool)
+    {
+        const auto sim_vars = monte_carlo_sim_vars(base_sim_vars, monte_carlo);
+        std::vector<FreeFallMonteCarloResult> partials(pool.thread_count(),
+            make_monte_carlo_result(base_obj_profile, sim_vars, Simulation::kGravityProfile, monte_carlo));
+        const auto chunk_size = std::max<std::size_t>(monte_carlo.chunk_size, 1);
+        const auto chunk_count = (monte_carlo.sample_count + chunk_size - 1) / chunk_size;
+        pool.parallel_for(chunk_count, [&](std::size_t chunk, std::size_t worker)
+        {
+            auto& partial = partials[worker];
+            FreeFallMonteCarloSink sink{partial.envelope};
+            const auto end = std::min<std::uint64_t>((chunk + 1) * chunk_size, monte_carlo.sample_count);
+            for (std::uint64_t index = chunk * chunk_size; index < end; ++index)
+            {
+                Simulation sim{draw_monte_carlo_profile(base_obj_profile, monte_carlo, index), sim_vars, FreeFallSimPlot{}};
+                sim.run_sim(sink);
+                partial.add_run(sink.last_time(), sink.last_position(), sink.last_velocity());
+            }
+        });
+
+        auto result = std::move(partials.front());
+        for (std::size_t worker = 1; worker < partials.size(); ++worker)
+            result.merge(partials[worker]);
+        return result;
+    }
+
+    // Same run for one of the stock gravity models
+    FreeFallMonteCarloResult run_monte_carlo(GravityProfile gravity_profile, const FreeFallObjProfile& base_obj_profile,
+        const FreeFallSimulationProfile& base_sim_vars, const FreeFallMonteCarloProfile& monte_carlo, FreeFallWorkStealingPool& pool);
+
+}
+
+#endif
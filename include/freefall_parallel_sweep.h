@@ -0,0 +1,110 @@
+#ifndef FREEFALL_PARALLEL_SWEEP_H
+#define FREEFALL_PARALLEL_SWEEP_H
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "freefall_dragforce_simulation.h"
+#include "freefall_result_cache.h"
+#include "freefall_run_stats.h"
+
+namespace FreeFallSim
+{
+
+    // Fixed size pool where every worker owns a deque of task indices. A worker pops from the
+    // front of its own deque and, once that is empty, steals from the back of the others, so
+    // a few very long runs (400 km drops) do not leave the remaining cores idle.
+    // The calling thread takes part as worker 0.
+    class FreeFallWorkStealingPool
+    {
+        public:
+        // task(index, worker) is called once for every index, worker is in [0, thread_count())
+        using Task = std::function<void(std::size_t, std::size_t)>;
+
+        // thread_count 0 uses std::thread::hardware_concurrency()
+        explicit FreeFallWorkStealingPool(std::size_t thread_count = 0);
+        ~FreeFallWorkStealingPool();
+
+        FreeFallWorkStealingPool(const FreeFallWorkStealingPool& src) = delete;
+        FreeFallWorkStealingPool& operator=(const FreeFallWorkStealingPool& src) = delete;
+
+        std::size_t thread_count() const { return m_queues.size(); }
+
+        // Runs task for every index in [0, count) and blocks until all of them finished.
+        // The first exception thrown by a task is rethrown here after the others completed.
+        void parallel_for(std::size_t count, const Task& task);
+
+        private:
+        struct WorkerQueue
+        {
+            std::mutex mutex;
+            std::deque<std::size_t> tasks;
+        };
+
+        void worker_loop(std::size_t worker);
+        void run_tasks(std::size_t worker, const Task& task);
+        bool pop_or_steal(std::size_t worker, std::size_t& index);
+
+        std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+        std::vector<std::thread> m_threads;
+        std::mutex m_mutex;
+        std::condition_variable m_work_ready;
+        std::condition_variable m_work_done;
+        const Task* m_task{nullptr};
+        std::size_t m_generation{0};
+        std::size_t m_active_workers{0};
+        std::size_t m_remaining{0};
+        std::exception_ptr m_error;
+        bool m_stop{false};
+    };
+
+    // Cartesian parameter grid over the base profiles, an empty axis keeps the base value
+    struct FreeFallSweepGrid
+    {
+        GravityProfile gravity_profile{GravityProfile::ConstantGravity};
+        FreeFallObjProfile base_obj_profile;
+        FreeFallSimulationProfile base_sim_profile;
+        std::vector<double> heights;                // (x) m
+        std::vector<double> masses;                 // (m) kg
+        std::vector<double> drag_coefficients;      // (Cd)
+        std::vector<float> time_steps;              // (t) s
+    };
+
+    // Timing of one sweep at a given thread count, speedup is relative to the first entry
+    struct FreeFallSweepScaling
+    {
+        std::size_t thread_count;
+        double wall_time_s;
+        double speedup;
+        double efficiency;
+    };
+
+    // Expands the grid into simulation models, heights vary slowest and time steps fastest
+    std::vector<FreeFallSimModels> expand_sweep_grid(const FreeFallSweepGrid& grid);
+
+    // Runs every model on the pool, results are returned in input order whatever the schedule.
+    // Each model is copied before running so the input vector can be swept again.
+    std::vector<FreeFallSimPlot> run_parallel_sweep(const std::vector<FreeFallSimModels>& sim_models, FreeFallWorkStealingPool& pool);
+    std::vector<FreeFallSimPlot> run_parallel_sweep(const std::vector<FreeFallSimModels>& sim_models, std::size_t thread_count = 0);
+    // Same sweep filling run_stats[i] for model i, named "sweep[i]" unless the entry already has a name.
+    // Pass the result to write_chrome_trace() to see the schedule of the workers in a trace viewer.
+    std::vector<FreeFallSimPlot> run_parallel_sweep(const std::vector<FreeFallSimModels>& sim_models, FreeFallWorkStealingPool& pool,
+        std::vector<FreeFallRunStats>& run_stats);
+    // Same sweep through the cache, only models whose cache_key() misses are run. Repeated models within
+    // one sweep may run more than once when they are in flight at the same time.
+    std::vector<FreeFallResultCache::Entry> run_parallel_sweep(const std::vector<FreeFallSimModels>& sim_models, FreeFallWorkStealingPool& pool,
+        FreeFallResultCache& cache);
+
+    // Sweeps the models once per thread count and reports wall time, speedup and efficiency
+    std::vector<FreeFallSweepScaling> measure_sweep_scaling(const std::vector<FreeFallSimModels>& sim_models,
+        const std::vector<std::size_t>& thread_counts);
+
+}
+
+#endif
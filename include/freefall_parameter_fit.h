@@ -0,0 +1,94 @@
+#ifndef FREEFALL_PARAMETER_FIT_H
+#define FREEFALL_PARAMETER_FIT_H
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "freefall_dragforce_simulation.h"
+#include "freefall_parallel_sweep.h"
+
+// Levenberg-Marquardt fit of the drag coefficient, and optionally mass and radius, to measured drops.
+// The model is the drop of run_sim(), dv/dt = g(x) - k*v^2 with k = Cd*rho*pi*r^2/m as in
+// QuadraticDragPolicy, integrated with RK4 together with its forward sensitivities
+//   d(dx/dk)/dt = -dv/dk,   d(dv/dk)/dt = g'(x)*dx/dk - v^2 - 2*k*v*dv/dk
+// so one pass gives the heights at the measured times and their derivatives for the Jacobian.
+// The engine's drag only opposes the motion while the object falls (v >= 0, positive downward), a
+// release moving upward is rejected rather than fitted with a drag that pushes it further up.
+// The drop only depends on the parameters through k, Cd alone is well determined. Freeing mass or
+// radius as well leaves a valley of equal k, the damping keeps the steps finite and the fit ends
+// with the right k near the starting split, their standard deviations come out huge.
+
+namespace FreeFallSim
+{
+
+    enum FreeFallFitParameter : unsigned
+    {
+        kFitDragCoefficient = 1u << 0,
+        kFitMass = 1u << 1,
+        kFitRadius = 1u << 2,
+    };
+
+    struct FreeFallFitProfile
+    {
+        unsigned parameters{kFitDragCoefficient};         // FreeFallFitParameter flags
+        GravityProfile gravity_profile{GravityProfile::ConstantGravity};
+        std::size_t max_iterations{50};
+        double initial_damping{1e-3};                     // (lambda) of the Marquardt scaled normal equations
+        double cost_tolerance{1e-12};                     // converged once an accepted step lowers the cost by less than this fraction
+        double step_tolerance{1e-10};                     // converged once the largest relative parameter step is below this
+    };
+
+    // One logged drop. Times are in s from the release, ascending, positions in m. The release state is
+    // position and velocity of sim_vars, time_step its RK4 step, initial_guess the start of the fit and
+    // the source of the parameters which are not fitted.
+    struct FreeFallMeasuredDrop
+    {
+        FreeFallObjProfile initial_guess;
+        FreeFallSimulationProfile sim_vars;
+        std::vector<double> time_data;
+        std::vector<double> position_data;
+    };
+
+    struct FreeFallFitResult
+    {
+        FreeFallObjProfile fitted;
+        double drag_coefficient_stddev{0.0};              // from the covariance at the optimum, 0 when not fitted
+        double mass_stddev{0.0};                          // (m) kg
+        double radius_stddev{0.0};                        // (r) m
+        double rms_residual{0.0};                         // (x) m
+        std::size_t iterations{0};
+        std::size_t evaluations{0};                       // model integrations
+        bool converged{false};
+    };
+
+    // Residual and Jacobian buffers of a fit, sized by the first drop and reused afterwards, so fits of
+    // drops up to that many samples allocate nothing, neither per iteration nor per fit
+    class FreeFallFitWorkspace
+    {
+        public:
+        void reserve(std::size_t sample_count);
+        // times the buffers had to grow, stays at 1 while the drops do not get longer
+        std::size_t grow_count() const { return m_grow_count; }
+
+        private:
+        friend class FreeFallFitSolver;
+
+        std::vector<double> m_residuals;
+        std::vector<double> m_jacobian;                   // sample major, 3 columns in log parameter space
+        std::vector<double> m_trial_residuals;
+        std::vector<double> m_trial_jacobian;
+        std::size_t m_grow_count{0};
+    };
+
+    // throws std::invalid_argument when the series are empty, differ in length or are not ascending in time,
+    // or when the release velocity is upward
+    FreeFallFitResult fit_drop(const FreeFallMeasuredDrop& drop, const FreeFallFitProfile& fit_profile, FreeFallFitWorkspace& workspace);
+    FreeFallFitResult fit_drop(const FreeFallMeasuredDrop& drop, const FreeFallFitProfile& fit_profile);
+
+    // Independent fits on the pool with one workspace per worker, results in input order
+    std::vector<FreeFallFitResult> fit_drops(const std::vector<FreeFallMeasuredDrop>& drops, const FreeFallFitProfile& fit_profile,
+        FreeFallWorkStealingPool& pool);
+
+}
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef FREEFALL_PLOT_H
+#define FREEFALL_PLOT_H
+#pragma once
+#include <cstddef>
+#include <string>
+#include "freefall_dragforce_simulation.h"
+#include "freefall_figure_export.h"
+
+// Matplot++ drawing of simulation results, part of the optional FreeFallSimPlotting target.
+// The FreeFallSim core library does not include or link matplot.
+
+namespace FreeFallSim
+{
+
+    // Interactive windows, each call blocks in matplot::show() until the window is closed
+    void plot_time_vs_velocity(const FreeFallSimPlot& sim_plot_vars, std::size_t max_points = FreeFallSimPlot::kDefaultPlotPoints);
+    void plot_time_vs_position(const FreeFallSimPlot& sim_plot_vars, std::size_t max_points = FreeFallSimPlot::kDefaultPlotPoints);
+    void plot_time_vs_force(const FreeFallSimPlot& sim_plot_vars, std::size_t max_points = FreeFallSimPlot::kDefaultPlotPoints);
+
+    // Rendering into output_path through gnuplot without a window, the format follows the extension
+    // (.png, .svg, ...). Calls are serialized on one quiet figure, so it can be the renderer of
+    // FreeFallFigureExportPool, whose workers still load and downsample in parallel.
+    // throws std::runtime_error when gnuplot fails to write the file
+    void save_figure(const FreeFallFigure& figure, const std::string& output_path);
+
+}
+
+#endif
@@ -0,0 +1,180 @@
+#ifndef FREEFALL_RESULT_CACHE_H
+#define FREEFALL_RESULT_CACHE_H
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "freefall_dragforce_simulation.h"
+#include "freefall_sim_engine.h"
+
+// Content addressed cache of run_sim() results for sweeps which run the same profiles again and again
+
+namespace FreeFallSim
+{
+
+    // FNV-1a 64 of every profile field which changes the trajectory (console_output does not) and of the
+    // model name. Floating point fields are hashed by value (-0.0 as 0.0), not by struct bytes, so padding
+    // does not leak in and the key is the same in every process on the host.
+    std::uint64_t hash_profiles(const FreeFallObjProfile& sim_obj_profile, const FreeFallSimulationProfile& sim_vars,
+        std::string_view model_name);
+
+    // Name of the gravity and drag policy pair of a SimEngine, e.g. "ConstantGravity+QuadraticDrag". Only
+    // engines which take integrator and sampling from the profile are named, a fixed Integrator or Sampler
+    // would make the hashed profile fields lie about how the trajectory was computed.
+    template <typename Simulation>
+    struct FreeFallModelName;
+
+    template <typename GravityPolicy, typename DragPolicy>
+    struct FreeFallModelName<SimEngine<GravityPolicy, DragPolicy, ProfileSelectedIntegrator, ProfileSelectedSampler>>
+    {
+        static std::string value() { return std::string{GravityPolicy::kName} + "+" + DragPolicy::kName; }
+    };
+
+    // Cache key of a simulation in the state it would start run_sim() from
+    template <typename Simulation>
+    std::uint64_t cache_key(const Simulation& sim)
+    {
+        return hash_profiles(sim.sim_obj_profile(), sim.sim_freefall_vars(), FreeFallModelName<Simulation>::value());
+    }
+
+    // Immutable result held by the cache, either the plot data of a fresh run (moved in, not copied) or a
+    // read only memory mapping of a cache file. The columns point straight into that storage.
+    class FreeFallCachedTrajectory
+    {
+        public:
+        explicit FreeFallCachedTrajectory(FreeFallSimPlot sim_plot);
+        // Maps a file written by write_file(), throws std::runtime_error when it is missing, truncated or
+        // belongs to another key
+        FreeFallCachedTrajectory(const std::string& path, std::uint64_t key);
+        ~FreeFallCachedTrajectory();
+
+        FreeFallCachedTrajectory(const FreeFallCachedTrajectory& src) = delete;
+        FreeFallCachedTrajectory& operator=(const FreeFallCachedTrajectory& src) = delete;
+
+        std::size_t size() const { return m_size; }
+        const double* time_data() const { return m_time; }
+        const double* position_data() const { return m_position; }
+        const double* velocity_data() const { return m_velocity; }
+        const double* netforce_data() const { return m_net_force; }
+        std::size_t event_count() const { return m_event_count; }
+        const FreeFallEvent* events() const { return m_events; }
+        const FreeFallIntegratorStats& integrator_stats() const { return m_integrator_stats; }
+        // bytes of sample and event data, what the size caps account
+        std::size_t size_bytes() const;
+        bool mapped() const { return m_mapping != nullptr; }
+
+        // Copy into plot data, for the plotting calls and code which wants to own the vectors
+        FreeFallSimPlot to_plot() const;
+
+        // Cache file, little endian as written by the host:
+        //   header: char magic[8] "FFCACHE1", uint32 version, uint32 reserved, uint64 key, uint64 sample_count,
+        //           uint64 event_count, uint64 steps_taken, uint64 steps_rejected, double wall_time_s, double fast_forward_time
+        //   columns: sample_count doubles each of time, position, velocity and net force
+        //   events: event_count FreeFallEvent records as laid out in memory
+        // Written to a unique temporary file next to path and renamed, so readers never map a partial file.
+        // Losing the rename to another writer of the same key is not an error.
+        void write_file(const std::string& path, std::uint64_t key) const;
+
+        private:
+        void point_into_plot();
+
+        FreeFallSimPlot m_sim_plot;
+        void* m_mapping{nullptr};
+        std::size_t m_mapping_bytes{0};
+        std::size_t m_size{0};
+        std::size_t m_event_count{0};
+        const double* m_time{nullptr};
+        const double* m_position{nullptr};
+        const double* m_velocity{nullptr};
+        const double* m_net_force{nullptr};
+        const FreeFallEvent* m_events{nullptr};
+        FreeFallIntegratorStats m_integrator_stats;
+    };
+
+    struct FreeFallCacheOptions
+    {
+        std::size_t memory_capacity_bytes{std::size_t{256} << 20};  // in-memory tier cap, 0 disables the tier
+        std::string directory;                                      // on-disk tier, empty disables it
+        std::uint64_t disk_capacity_bytes{std::uint64_t{4} << 30};  // on-disk tier cap
+    };
+
+    struct FreeFallCacheStats
+    {
+        std::uint64_t memory_hits{0};
+        std::uint64_t disk_hits{0};                   // memory misses served by a cache file
+        std::uint64_t misses{0};                      // lookups which had to run the simulation
+        std::uint64_t insertions{0};
+        std::uint64_t memory_evictions{0};
+        std::uint64_t disk_evictions{0};              // cache files deleted for the size cap
+        std::uint64_t disk_write_failures{0};         // insertions kept in memory only, their file could not be written
+        std::size_t memory_bytes{0};
+        std::uint64_t disk_bytes{0};
+        std::size_t memory_entries{0};
+        std::size_t disk_entries{0};
+    };
+
+    // Two tier LRU cache of trajectories keyed by cache_key(). A disk hit maps the file and promotes it into
+    // the memory tier, both tiers evict least recently used entries once their cap is exceeded. An entry
+    // larger than a cap is not kept in that tier. Existing cache files in the directory are adopted on
+    // construction, oldest modification time first in line for eviction. Safe to share between threads.
+    class FreeFallResultCache
+    {
+        public:
+        using Entry = std::shared_ptr<const FreeFallCachedTrajectory>;
+
+        explicit FreeFallResultCache(FreeFallCacheOptions options = {});
+
+        // nullptr when neither tier holds the key, counts a miss
+        Entry find(std::uint64_t key);
+        Entry insert(std::uint64_t key, FreeFallSimPlot sim_plot);
+
+        // Cached result of sim.run_sim(), on a miss a copy of sim runs so sim itself is left in its start
+        // state either way. Two threads missing the same key both run it, the later insert replaces the
+        // earlier one. A cache file which can not be written is counted in the stats, the result is still
+        // returned and kept in memory.
+        template <typename Simulation>
+        Entry run_sim(const Simulation& sim)
+        {
+            const auto key = cache_key(sim);
+            if (auto entry = find(key))
+                return entry;
+            auto run = sim;
+            return insert(key, run.run_sim());
+        }
+
+        FreeFallCacheStats stats() const;
+        // Drops the memory tier, the cache files stay
+        void clear_memory();
+
+        private:
+        struct DiskFile
+        {
+            std::uint64_t key;
+            std::uint64_t bytes;
+        };
+
+        std::string file_path(std::uint64_t key) const;
+        void adopt_directory();
+        void insert_memory(std::uint64_t key, const Entry& entry);
+        void touch_disk(std::uint64_t key);
+        void insert_disk(std::uint64_t key, std::uint64_t bytes);
+        void erase_disk(std::uint64_t key);
+
+        FreeFallCacheOptions m_options;
+        mutable std::mutex m_mutex;
+        FreeFallCacheStats m_stats;
+        // most recently used at the front
+        std::list<std::pair<std::uint64_t, Entry>> m_memory_lru;
+        std::unordered_map<std::uint64_t, std::list<std::pair<std::uint64_t, Entry>>::iterator> m_memory_index;
+        std::list<DiskFile> m_disk_lru;
+        std::unordered_map<std::uint64_t, std::list<DiskFile>::iterator> m_disk_index;
+    };
+
+}
+
+#endif
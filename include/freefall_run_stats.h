@@ -0,0 +1,89 @@
+#ifndef FREEFALL_RUN_STATS_H
+#define FREEFALL_RUN_STATS_H
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "freefall_trajectory_sink.h"
+
+namespace FreeFallSim
+{
+
+    // Instrumentation of one run, filled by the run_sim() overloads taking a FreeFallRunStats.
+    // The plain overloads do not touch it, so runs without stats pay nothing per step.
+    struct FreeFallRunStats
+    {
+        std::string name;                             // event name in traces, the gravity model when left empty
+        std::uint64_t steps{0};                       // accepted integration steps
+        std::uint64_t steps_rejected{0};              // adaptive steps repeated
+        std::uint64_t samples{0};                     // samples written to the sink
+        double start_us{0.0};                         // start on trace_clock_us()
+        double wall_time_s{0.0};                      // whole run
+        double integration_time_s{0.0};               // wall time minus the output path
+        double output_time_s{0.0};                    // inside sink begin/write/end
+        std::size_t peak_trajectory_bytes{0};         // largest buffered_bytes() of the sink during the run
+        std::uint64_t reallocations{0};               // times the sink buffer grew after begin()
+        std::size_t thread_index{0};                  // trace_thread_index() of the running thread
+    };
+
+    // Microseconds on the steady clock since the first call in the process, shared by all threads
+    double trace_clock_us();
+    // Small sequential id of the calling thread, stable for its lifetime, used as the trace tid
+    std::size_t trace_thread_index();
+
+    // Forwards to another sink, timing the output path and watching the memory the sink holds
+    class FreeFallInstrumentedSink : public FreeFallTrajectorySink
+    {
+        public:
+        FreeFallInstrumentedSink(FreeFallTrajectorySink& sink, FreeFallRunStats& run_stats): m_sink(sink), m_run_stats(run_stats)
+        {}
+
+        void begin(std::size_t expected_samples) override
+        {
+            const auto start = std::chrono::steady_clock::now();
+            m_sink.begin(expected_samples);
+            // growth during begin() is the up-front reservation, not a reallocation
+            m_buffered_bytes = m_sink.buffered_bytes();
+            m_run_stats.peak_trajectory_bytes = std::max(m_run_stats.peak_trajectory_bytes, m_buffered_bytes);
+            m_run_stats.output_time_s += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        void write(double time, double position, double velocity, double net_force) override
+        {
+            const auto start = std::chrono::steady_clock::now();
+            m_sink.write(time, position, velocity, net_force);
+            const auto buffered_bytes = m_sink.buffered_bytes();
+            if (buffered_bytes > m_buffered_bytes)
+            {
+                ++m_run_stats.reallocations;
+                m_run_stats.peak_trajectory_bytes = std::max(m_run_stats.peak_trajectory_bytes, buffered_bytes);
+            }
+            m_buffered_bytes = buffered_bytes;
+            ++m_run_stats.samples;
+            m_run_stats.output_time_s += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        void end() override
+        {
+            const auto start = std::chrono::steady_clock::now();
+            m_sink.end();
+            m_run_stats.output_time_s += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        void event(const FreeFallEvent& event) override { m_sink.event(event); }
+        std::size_t buffered_bytes() const override { return m_sink.buffered_bytes(); }
+
+        private:
+        FreeFallTrajectorySink& m_sink;
+        FreeFallRunStats& m_run_stats;
+        std::size_t m_buffered_bytes{0};
+    };
+
+    // Chrome trace-event JSON (chrome://tracing, Perfetto), one complete event per run on the
+    // thread that ran it, the counters are attached as args
+    void write_chrome_trace(std::ostream& output, const std::vector<FreeFallRunStats>& run_stats);
+    // throws std::runtime_error when the file can not be written
+    void write_chrome_trace(const std::string& path, const std::vector<FreeFallRunStats>& run_stats);
+
+}
+
+#endif
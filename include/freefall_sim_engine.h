@@ -0,0 +1,621 @@
+#ifndef FREEFALL_SIM_ENGINE_H
+#define FREEFALL_SIM_ENGINE_H
+#pragma once
+#include <chrono>
+#include <limits>
+#include <type_traits>
+#include "freefall_dragforce_simulation.h"
+#include "freefall_adaptive_integrator.h"
+#include "freefall_analytic_solution.h"
+#include "freefall_events.h"
+#include "freefall_trajectory_sink.h"
+#include "freefall_run_stats.h"
+
+// Member definitions of SimEngine and its integrator/sampler policies. Include this header to
+// instantiate SimEngine with a custom policy combination, the stock aliases are prebuilt in the library.
+
+namespace FreeFallSim
+{
+
+    // Per run coefficients of a gravity and a drag policy, prepared once before the loop
+    template <typename GravityPolicy, typename DragPolicy>
+    struct FreeFallForceModel
+    {
+        // only constant gravity with quadratic drag has the closed form solution
+        static constexpr bool kHasClosedForm = std::is_same_v<GravityPolicy, ConstantGravityPolicy> &&
+            std::is_same_v<DragPolicy, QuadraticDragPolicy>;
+
+        FreeFallForceModel(const FreeFallObjProfile& sim_obj_profile, const FreeFallSimulationProfile& sim_vars):
+            gravity(GravityPolicy::prepare(sim_obj_profile, sim_vars)), drag(DragPolicy::prepare(sim_obj_profile, sim_vars)),
+            mass(sim_obj_profile.mass_of_object)
+        {}
+
+        // net downward acceleration, net force is this times mass
+        double acceleration(double position, double velocity) const
+        {
+            return GravityPolicy::acceleration(gravity, position) - DragPolicy::acceleration(drag, position, velocity);
+        }
+        double gravity_acceleration(double position) const
+        {
+            return GravityPolicy::acceleration(gravity, position);
+        }
+        double terminal_velocity(double position) const
+        {
+            return DragPolicy::terminal_velocity(drag, position, GravityPolicy::acceleration(gravity, position));
+        }
+        // acceleration of an object riding the local terminal velocity down, -vt * dvt/dx,
+        // zero for constant gravity and small where vt drifts with height
+        double steady_state_acceleration(double position) const
+        {
+            constexpr double kDifferenceStep{1.0};
+            return terminal_velocity(position) * (terminal_velocity(position - kDifferenceStep) -
+                terminal_velocity(position + kDifferenceStep)) / (2.0 * kDifferenceStep);
+        }
+        // velocity of the settled descent: the object trails a drifting vt by the speed at which the
+        // drag deficit supplies the steady state acceleration, v = vt + a_steady / (da/dv)
+        double steady_state_velocity(double position) const
+        {
+            const auto velocity = terminal_velocity(position);
+            const auto difference_step = 1e-6 * velocity;
+            const auto slope = (acceleration(position, velocity + difference_step) - acceleration(position, velocity - difference_step)) /
+                (2.0 * difference_step);
+            return slope < 0.0 ? velocity + steady_state_acceleration(position) / slope : velocity;
+        }
+
+        typename GravityPolicy::Coefficients gravity;
+        typename DragPolicy::Coefficients drag;
+        double mass;
+    };
+
+    // Samplers decide which states reach the sink. A step based sampler looks at the state after every
+    // step, a time based sampler hands out exact sample times which the integrator evaluates inside the
+    // step covering them. Samplers are built with the estimated impact time to pre-size the output.
+
+    // Samples whenever the rounded height is a multiple of sample_factor, the original run_sim() behaviour.
+    // Kept for compatibility, it follows height rather than time and emits bursts near each multiple.
+    struct HeightModuloSampler
+    {
+        HeightModuloSampler(const FreeFallSimulationProfile& sim_vars, double estimated_impact_time):
+            sample_factor(std::max(sim_vars.sample_factor, 1)),
+            estimated_steps(estimated_impact_time / sim_vars.time_step)
+        {}
+
+        static constexpr bool time_based() { return false; }
+        // roughly one step in sample_factor lands on a multiple, with headroom for the bursts
+        std::size_t expected_samples() const { return static_cast<std::size_t>(estimated_steps / sample_factor * 1.125) + 8; }
+        bool sample_position(double position) const
+        {
+            return static_cast<int>(round_to(position, 1)) % sample_factor == 0;
+        }
+        double height_spacing() const { return sample_factor; }
+        double next_time() const { return std::numeric_limits<double>::infinity(); }
+        void advance() {}
+        bool sample_final(double) const { return false; }
+
+        int sample_factor;
+        double estimated_steps;
+    };
+
+    // Samples at exactly t = 0, interval, 2*interval, ... plus the final state, optionally capped in count.
+    // With reserve_final the interval samples stop one short of the cap, so the final state always fits.
+    struct TimeIntervalSampler
+    {
+        TimeIntervalSampler(double interval, double estimated_impact_time, std::size_t max_samples = 0, bool reserve_final = false):
+            interval(interval > 0.0 ? interval : std::numeric_limits<double>::infinity()),
+            estimated_impact_time(estimated_impact_time),
+            max_samples(max_samples == 0 ? std::numeric_limits<std::size_t>::max() : max_samples),
+            max_interval_samples(reserve_final && max_samples > 0 ? max_samples - 1 : this->max_samples)
+        {}
+        TimeIntervalSampler(const FreeFallSimulationProfile& sim_vars, double estimated_impact_time):
+            TimeIntervalSampler(sim_vars.sample_interval, estimated_impact_time)
+        {}
+
+        static constexpr bool time_based() { return true; }
+        std::size_t expected_samples() const
+        {
+            const auto estimate = std::isfinite(interval) ? estimated_impact_time / interval + 2.0 : 2.0;
+            return static_cast<std::size_t>(std::min(estimate, static_cast<double>(max_samples)));
+        }
+        bool sample_position(double) const { return false; }
+        double height_spacing() const { return 0.0; }
+        // time is index*interval, not accumulated, so late samples do not drift
+        double next_time() const
+        {
+            return emitted < max_interval_samples ? static_cast<double>(emitted) * interval : std::numeric_limits<double>::infinity();
+        }
+        void advance()
+        {
+            last_time = next_time();
+            ++emitted;
+        }
+        // the final state is added unless it was just sampled or the cap is reached
+        bool sample_final(double end_time)
+        {
+            if (emitted >= max_samples || (emitted > 0 && last_time >= end_time))
+                return false;
+            last_time = end_time;
+            ++emitted;
+            return true;
+        }
+
+        double interval;
+        double estimated_impact_time;
+        std::size_t max_samples;
+        std::size_t max_interval_samples;
+        std::size_t emitted{0};
+        double last_time{0.0};
+    };
+
+    // At most max_points samples spread evenly over the estimated flight time, the last one of the budget
+    // kept for the final state. The estimate is not a bound for every run (a release above terminal
+    // velocity lands later than it), the impact is recorded even when the interval samples run out early.
+    struct MaxPointsSampler : TimeIntervalSampler
+    {
+        MaxPointsSampler(const FreeFallSimulationProfile& sim_vars, double estimated_impact_time):
+            TimeIntervalSampler(sim_vars.max_points > 1 ? estimated_impact_time / (sim_vars.max_points - 1) : estimated_impact_time,
+                estimated_impact_time, std::max<std::size_t>(sim_vars.max_points, 1), true)
+        {}
+    };
+
+    // Picks the sampler from FreeFallSimulationProfile::sampling once per run
+    struct ProfileSelectedSampler
+    {
+        ProfileSelectedSampler(const FreeFallSimulationProfile& sim_vars, double estimated_impact_time):
+            mode(sim_vars.sampling), height_sampler(sim_vars, estimated_impact_time),
+            time_sampler(sim_vars.sampling == SamplingProfile::MaxPoints ?
+                MaxPointsSampler(sim_vars, estimated_impact_time) : TimeIntervalSampler(sim_vars, estimated_impact_time))
+        {}
+
+        bool time_based() const { return mode != SamplingProfile::HeightModulo; }
+        std::size_t expected_samples() const
+        {
+            return time_based() ? time_sampler.expected_samples() : height_sampler.expected_samples();
+        }
+        bool sample_position(double position) const { return !time_based() && height_sampler.sample_position(position); }
+        double height_spacing() const { return time_based() ? 0.0 : height_sampler.height_spacing(); }
+        double next_time() const { return time_based() ? time_sampler.next_time() : height_sampler.next_time(); }
+        void advance() { time_sampler.advance(); }
+        bool sample_final(double end_time) { return time_based() && time_sampler.sample_final(end_time); }
+
+        SamplingProfile mode;
+        HeightModuloSampler height_sampler;
+        TimeIntervalSampler time_sampler;
+    };
+
+    // The original update with constant acceleration over a time_step
+    //   v' = v + a*dt,  x' = x - v*dt - 0.5*a*dt^2
+    // dt and 0.5*dt^2 are converted from the float time_step once per run. Inside a step the
+    // state follows the same polynomial, which is how time based samples and events are placed exactly.
+    struct FixedStepIntegrator
+    {
+        template <typename Model, typename Sampler>
+        static FreeFallIntegratorStats integrate(const Model& model, const FreeFallObjProfile&, FreeFallSimulationProfile& sim_vars,
+            Sampler& sampler, FreeFallTrajectorySink& sink)
+        {
+            // event tracking and the steady state test are compiled out of the step loop unless requested,
+            // the plain loop does not even construct the tracker (a live tracker costs ~30% per step)
+            if (!sim_vars.steady_state_fast_forward && !FreeFallEventTracker::requested(sim_vars))
+                return run_steps<false, false>(model, sim_vars, sampler, nullptr, sink);
+            FreeFallEventTracker events{sim_vars, model.gravity_acceleration(sim_vars.position)};
+            if (sim_vars.steady_state_fast_forward)
+            {
+                return events.active() ? run_steps<true, true>(model, sim_vars, sampler, &events, sink) :
+                    run_steps<false, true>(model, sim_vars, sampler, &events, sink);
+            }
+            return run_steps<true, false>(model, sim_vars, sampler, &events, sink);
+        }
+
+        private:
+        template <bool kTrackEvents, bool kFastForward, typename Model, typename Sampler>
+        static FreeFallIntegratorStats run_steps(const Model& model, FreeFallSimulationProfile& sim_vars, Sampler& sampler,
+            FreeFallEventTracker* events, FreeFallTrajectorySink& sink)
+        {
+            const double time_step = sim_vars.time_step;
+            const double half_time_step_sq = 0.5 * time_step * time_step;
+            const double finish_time = sim_vars.finish_time;
+            const bool locate_impact = sim_vars.locate_impact;
+            const double steady_state_tolerance = sim_vars.steady_state_tolerance;
+            auto current_height = sim_vars.position;
+            auto velocity = sim_vars.velocity;
+            auto step_acceleration = model.acceleration(current_height, velocity);
+            double sim_time{0.0};
+            std::uint64_t steps{0};
+            FreeFallIntegratorStats stats;
+
+            // state at the start of the current step and the state tau into it, with the acceleration of the model there
+            double step_start{0.0};
+            FreeFallStepState start{current_height, velocity, step_acceleration};
+            auto state_at = [&model, &start](double tau)
+            {
+                const auto position = start.position - start.velocity * tau - 0.5 * start.acceleration * tau * tau;
+                const auto state_velocity = start.velocity + start.acceleration * tau;
+                return FreeFallStepState{position, state_velocity, model.acceleration(position, state_velocity)};
+            };
+
+            sink.begin(sampler.expected_samples());
+            while (current_height >= 0 && sim_time < finish_time)
+            {
+                step_acceleration = model.acceleration(current_height, velocity);
+                step_start = sim_time;
+                start = {current_height, velocity, step_acceleration};
+                ++steps;
+                sim_time = steps * time_step;
+
+                if (sampler.time_based())
+                {
+                    for (auto sample_time = sampler.next_time(); sample_time <= sim_time; sample_time = sampler.next_time())
+                    {
+                        const auto tau = sample_time - step_start;
+                        const auto position = current_height - velocity * tau - 0.5 * step_acceleration * tau * tau;
+                        if (position < 0.0 && locate_impact)
+                            break;
+                        sink.write(sample_time, position, -(velocity + step_acceleration * tau), step_acceleration * model.mass);
+                        sampler.advance();
+                    }
+                }
+                current_height = current_height - velocity * time_step - step_acceleration * half_time_step_sq;
+                velocity = velocity + step_acceleration * time_step;
+
+                // only events and the steady state test look at the acceleration at the end of the step,
+                // the plain loop evaluates it once at the top of the next step
+                if constexpr (kTrackEvents || kFastForward)
+                {
+                    const FreeFallStepState end{current_height, velocity, model.acceleration(current_height, velocity)};
+                    if constexpr (kTrackEvents)
+                    {
+                        if (events->active())
+                            events->check_step(step_start, time_step, start, end, state_at, model.mass, sink);
+                    }
+                    if constexpr (kFastForward)
+                    {
+                        if (current_height > 0.0 && sim_time < finish_time &&
+                            std::abs(end.acceleration - model.steady_state_acceleration(current_height)) <=
+                                steady_state_tolerance * model.gravity_acceleration(current_height))
+                        {
+                            if (sampler.sample_position(current_height))
+                                sink.write(sim_time, current_height, -velocity, step_acceleration * model.mass);
+                            const auto fast_forward_start = sim_time;
+                            fast_forward(model, sim_vars, sampler, *events, sink, sim_time, current_height, velocity, step_acceleration);
+                            stats.fast_forward_time = sim_time - fast_forward_start;
+                            break;
+                        }
+                    }
+                }
+
+                if (sampler.sample_position(current_height) && (current_height >= 0.0 || !locate_impact))
+                    sink.write(sim_time, current_height, -velocity, step_acceleration * model.mass);
+            }
+            if (current_height < 0.0 && locate_impact)
+            {
+                // end the run on the ground instead of a step below it, kept out of the loop which only
+                // leaves below ground once
+                const auto tau = FreeFallEventTracker::locate_ground(step_start, time_step, start,
+                    {current_height, velocity, step_acceleration}, state_at);
+                sim_time = step_start + tau;
+                current_height = 0.0;
+                velocity = start.velocity + start.acceleration * tau;
+                sink.event({FreeFallEventKind::GroundImpact, sim_time, 0.0, -velocity, step_acceleration * model.mass});
+                if (sampler.sample_position(current_height))
+                    sink.write(sim_time, current_height, -velocity, step_acceleration * model.mass);
+            }
+            if (sampler.sample_final(sim_time))
+                sink.write(sim_time, current_height, -velocity, step_acceleration * model.mass);
+            sink.end();
+            sim_vars.position = current_height;
+            sim_vars.velocity = velocity;
+
+            stats.steps_taken = steps;
+            return stats;
+        }
+
+        // Terminal velocity reached: the rest of the flight comes from FreeFallSteadyStateDescent instead
+        // of steps. Samples and events along the way are evaluated on the descent, time, height and
+        // velocity are left at the ground (or at finish_time when that comes first).
+        template <typename Model, typename Sampler>
+        static void fast_forward(const Model& model, const FreeFallSimulationProfile& sim_vars, Sampler& sampler,
+            FreeFallEventTracker& events, FreeFallTrajectorySink& sink, double& sim_time, double& current_height,
+            double& velocity, double& net_acceleration)
+        {
+            const double finish_time = sim_vars.finish_time;
+            const FreeFallSteadyStateDescent<Model> descent{model, sim_time, current_height};
+            const auto end_time = std::min(descent.impact_time(), finish_time);
+            const auto start_height = current_height;
+
+            events.check_steady_state(sim_time, {current_height, velocity, net_acceleration}, model.mass, sink);
+            events.check_descent(start_height, finish_time, [&descent](double height) { return descent.time_at(height); },
+                [&descent](double height) { return descent.state_at_height(height); }, model.mass, sink);
+
+            if (sampler.time_based())
+            {
+                for (auto sample_time = sampler.next_time(); sample_time <= end_time; sample_time = sampler.next_time())
+                {
+                    const auto state = descent.state_at_height(descent.position_at(sample_time));
+                    sink.write(sample_time, state.position, -state.velocity, state.acceleration * model.mass);
+                    sampler.advance();
+                }
+            }
+            else if (sampler.height_spacing() > 0.0)
+            {
+                // one sample per multiple of the spacing, where stepping would emit a burst around each
+                const auto spacing = sampler.height_spacing();
+                for (auto level = std::floor(start_height / spacing); level >= 0.0; level -= 1.0)
+                {
+                    const auto height = level * spacing;
+                    const auto time = descent.time_at(height);
+                    if (time > end_time || height >= start_height)
+                        continue;
+                    const auto state = descent.state_at_height(height);
+                    sink.write(time, state.position, -state.velocity, state.acceleration * model.mass);
+                }
+            }
+
+            const auto final_state = descent.state_at_height(end_time < descent.impact_time() ? descent.position_at(end_time) : 0.0);
+            sim_time = end_time;
+            current_height = final_state.position;
+            velocity = final_state.velocity;
+            net_acceleration = final_state.acceleration;
+            if (current_height <= 0.0)
+                sink.event({FreeFallEventKind::GroundImpact, sim_time, 0.0, -velocity, net_acceleration * model.mass});
+        }
+    };
+
+    // Adaptive Dormand-Prince 5(4). Time based samples and events are placed with cubic Hermite interpolation
+    // of each accepted step, otherwise every accepted step is sampled since the steps are already sparse.
+    struct DormandPrince45Integrator
+    {
+        template <typename Model, typename Sampler>
+        static FreeFallIntegratorStats integrate(const Model& model, const FreeFallObjProfile&, FreeFallSimulationProfile& sim_vars,
+            Sampler& sampler, FreeFallTrajectorySink& sink)
+        {
+            const FreeFallAdaptiveOptions options{sim_vars.time_step, sim_vars.abs_tolerance, sim_vars.rel_tolerance,
+                static_cast<double>(sim_vars.finish_time)};
+            auto acceleration = [&model](double position, double velocity) { return model.acceleration(position, velocity); };
+            FreeFallEventTracker events{sim_vars, model.gravity_acceleration(sim_vars.position)};
+
+            // state at the start of the current step
+            double step_time{0.0};
+            FreeFallStepState start{sim_vars.position, sim_vars.velocity, model.acceleration(sim_vars.position, sim_vars.velocity)};
+            double end_time{0.0};
+            FreeFallStepState end = start;
+            bool landed{false};
+
+            sink.begin(sampler.expected_samples());
+            const auto counters = integrate_dormand_prince45(sim_vars.position, sim_vars.velocity, acceleration, options,
+                [&](double sim_time, double current_height, double current_velocity, double current_acceleration)
+                {
+                    const auto step = sim_time - step_time;
+                    end = {current_height, current_velocity, current_acceleration};
+                    end_time = sim_time;
+                    // Hermite basis on s in [0, 1], dx/dt = -v and dv/dt = a at both ends
+                    auto state_at = [&model, step, start, step_end = end](double tau)
+                    {
+                        const auto s = step > 0.0 ? tau / step : 0.0;
+                        const auto h00 = (1.0 + 2.0 * s) * (1.0 - s) * (1.0 - s);
+                        const auto h10 = s * (1.0 - s) * (1.0 - s);
+                        const auto h01 = s * s * (3.0 - 2.0 * s);
+                        const auto h11 = s * s * (s - 1.0);
+                        const auto position = h00 * start.position + h10 * step * -start.velocity + h01 * step_end.position + h11 * step * -step_end.velocity;
+                        const auto velocity = h00 * start.velocity + h10 * step * start.acceleration + h01 * step_end.velocity + h11 * step * step_end.acceleration;
+                        return FreeFallStepState{position, velocity, model.acceleration(position, velocity)};
+                    };
+
+                    if (events.active())
+                        events.check_step(step_time, step, start, end, state_at, model.mass, sink);
+                    if (current_height < 0.0 && sim_vars.locate_impact)
+                    {
+                        const auto tau = FreeFallEventTracker::locate_ground(step_time, step, start, end, state_at);
+                        end = state_at(tau);
+                        end.position = 0.0;
+                        end_time = step_time + tau;
+                        landed = true;
+                        sink.event({FreeFallEventKind::GroundImpact, end_time, 0.0, -end.velocity, end.acceleration * model.mass});
+                    }
+
+                    if (sampler.time_based())
+                    {
+                        for (auto sample_time = sampler.next_time(); sample_time <= end_time; sample_time = sampler.next_time())
+                        {
+                            const auto state = state_at(sample_time - step_time);
+                            sink.write(sample_time, state.position, -state.velocity, state.acceleration * model.mass);
+                            sampler.advance();
+                        }
+                    }
+                    else
+                    {
+                        sink.write(end_time, end.position, -end.velocity, end.acceleration * model.mass);
+                    }
+                    step_time = sim_time;
+                    start = end;
+                });
+            if (landed)
+            {
+                sim_vars.position = end.position;
+                sim_vars.velocity = end.velocity;
+            }
+            if (sampler.sample_final(end_time))
+                sink.write(end_time, sim_vars.position, -sim_vars.velocity, end.acceleration * model.mass);
+            sink.end();
+
+            FreeFallIntegratorStats stats;
+            stats.steps_taken = counters.steps_taken;
+            stats.steps_rejected = counters.steps_rejected;
+            return stats;
+        }
+    };
+
+    // Constant gravity trajectory straight from the closed form solution, no steps are taken. The formulas
+    // turn the drag with the motion (k*v*|v|), QuadraticDragPolicy does not (k*v^2), the two only agree
+    // while the object falls. An upward release is integrated by FixedStep like the other models see it.
+    struct ClosedFormIntegrator
+    {
+        template <typename Model, typename Sampler>
+        static FreeFallIntegratorStats integrate(const Model& model, const FreeFallObjProfile& sim_obj_profile, FreeFallSimulationProfile& sim_vars,
+            Sampler& sampler, FreeFallTrajectorySink& sink)
+        {
+            static_assert(Model::kHasClosedForm, "ClosedFormIntegrator needs constant gravity with quadratic drag");
+            if (sim_vars.velocity < 0.0)
+                return FixedStepIntegrator::integrate(model, sim_obj_profile, sim_vars, sampler, sink);
+            const FreeFallConstGravityAnalytic analytic{sim_obj_profile, sim_vars};
+            const double finish_time = sim_vars.finish_time;
+            const auto impact = analytic.impact();
+            const auto end_time = std::min(impact.time, finish_time);
+            const auto mass = sim_obj_profile.mass_of_object;
+
+            // events straight from the formulas, the whole flight is one step for the tracker
+            auto write_events = [&]()
+            {
+                FreeFallEventTracker events{sim_vars, const_weight_force(sim_obj_profile, sim_vars) / mass};
+                auto state_at = [&analytic, mass](double time)
+                {
+                    const auto state = analytic.state_at(time);
+                    return FreeFallStepState{state.position, state.velocity, state.net_force / mass};
+                };
+                events.check_descent(std::numeric_limits<double>::infinity(), end_time,
+                    [&analytic](double height) { return analytic.time_to_height(height).value_or(std::numeric_limits<double>::infinity()); },
+                    [&](double height) { auto state = state_at(*analytic.time_to_height(height)); state.position = height; return state; },
+                    mass, sink);
+                if (events.active())
+                    events.check_step(0.0, end_time, state_at(0.0), state_at(end_time), state_at, mass, sink);
+                if (impact.time <= finish_time)
+                    sink.event({FreeFallEventKind::GroundImpact, impact.time, 0.0, -impact.velocity, impact.net_force});
+            };
+
+            if (sampler.time_based())
+            {
+                sink.begin(sampler.expected_samples());
+                for (auto sample_time = sampler.next_time(); sample_time <= end_time; sample_time = sampler.next_time())
+                {
+                    const auto state = analytic.state_at(sample_time);
+                    sink.write(sample_time, state.position, -state.velocity, state.net_force);
+                    sampler.advance();
+                }
+                if (sampler.sample_final(end_time))
+                {
+                    const auto state = end_time < impact.time ? analytic.state_at(end_time) : impact;
+                    sink.write(end_time, state.position, -state.velocity, state.net_force);
+                }
+                write_events();
+                sink.end();
+            }
+            else
+            {
+                // write_trajectory() opens and closes the sink itself, the events go in right before end()
+                class EventsBeforeEndSink : public FreeFallTrajectorySink
+                {
+                    public:
+                    EventsBeforeEndSink(FreeFallTrajectorySink& sink, decltype(write_events)& write_events):
+                        m_sink(sink), m_write_events(write_events)
+                    {}
+                    void begin(std::size_t expected_samples) override { m_sink.begin(expected_samples); }
+                    void write(double time, double position, double velocity, double net_force) override
+                    {
+                        m_sink.write(time, position, velocity, net_force);
+                    }
+                    void end() override
+                    {
+                        m_write_events();
+                        m_sink.end();
+                    }
+                    std::size_t buffered_bytes() const override { return m_sink.buffered_bytes(); }
+
+                    private:
+                    FreeFallTrajectorySink& m_sink;
+                    decltype(write_events)& m_write_events;
+                };
+                EventsBeforeEndSink events_sink{sink, write_events};
+                analytic.write_trajectory(sim_vars.sample_factor, events_sink, finish_time);
+            }
+
+            const auto final_state = impact.time <= finish_time ? impact : analytic.state_at(finish_time);
+            sim_vars.position = final_state.position;
+            sim_vars.velocity = final_state.velocity;
+            return FreeFallIntegratorStats{};
+        }
+    };
+
+    // Picks the integrator from FreeFallSimulationProfile::integrator once per run,
+    // ClosedForm falls back to FixedStep for models without a closed form solution
+    struct ProfileSelectedIntegrator
+    {
+        template <typename Model, typename Sampler>
+        static FreeFallIntegratorStats integrate(const Model& model, const FreeFallObjProfile& sim_obj_profile, FreeFallSimulationProfile& sim_vars,
+            Sampler& sampler, FreeFallTrajectorySink& sink)
+        {
+            switch (sim_vars.integrator)
+            {
+                case IntegratorProfile::DormandPrince45:
+                    return DormandPrince45Integrator::integrate(model, sim_obj_profile, sim_vars, sampler, sink);
+                case IntegratorProfile::ClosedForm:
+                    if constexpr (Model::kHasClosedForm)
+                        return ClosedFormIntegrator::integrate(model, sim_obj_profile, sim_vars, sampler, sink);
+                    break;
+                case IntegratorProfile::FixedStep:
+                    break;
+            }
+            return FixedStepIntegrator::integrate(model, sim_obj_profile, sim_vars, sampler, sink);
+        }
+    };
+
+    template <typename GravityPolicy, typename DragPolicy, typename Integrator, typename Sampler>
+    FreeFallIntegratorStats SimEngine<GravityPolicy, DragPolicy, Integrator, Sampler>::run_sim(FreeFallTrajectorySink& sink)
+    {
+        const auto run_start = std::chrono::steady_clock::now();
+        const FreeFallForceModel<GravityPolicy, DragPolicy> model{m_sim_obj_profile, m_freefall_sim_vars};
+        Sampler sampler{m_freefall_sim_vars, estimate_impact_time(m_sim_obj_profile, m_freefall_sim_vars, kGravityProfile)};
+        auto stats = Integrator::integrate(model, m_sim_obj_profile, m_freefall_sim_vars, sampler, sink);
+        stats.wall_time_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - run_start).count();
+        return stats;
+    }
+
+    template <typename GravityPolicy, typename DragPolicy, typename Integrator, typename Sampler>
+    FreeFallIntegratorStats SimEngine<GravityPolicy, DragPolicy, Integrator, Sampler>::run_sim(FreeFallTrajectorySink& sink,
+        FreeFallRunStats& run_stats)
+    {
+        // the instrumentation wraps the sink, the integration loop itself is the uninstrumented one
+        run_stats.start_us = trace_clock_us();
+        run_stats.thread_index = trace_thread_index();
+        if (run_stats.name.empty())
+            run_stats.name = kGravityProfile == GravityProfile::ConstantGravity ? "ConstantGravity" : "NewtonGravitationModel";
+        FreeFallInstrumentedSink instrumented_sink{sink, run_stats};
+        const auto stats = run_sim(instrumented_sink);
+        run_stats.steps = stats.steps_taken;
+        run_stats.steps_rejected = stats.steps_rejected;
+        run_stats.wall_time_s = stats.wall_time_s;
+        run_stats.integration_time_s = std::max(0.0, stats.wall_time_s - run_stats.output_time_s);
+        return stats;
+    }
+
+    template <typename GravityPolicy, typename DragPolicy, typename Integrator, typename Sampler>
+    FreeFallSimPlot SimEngine<GravityPolicy, DragPolicy, Integrator, Sampler>::run_sim_to_plot(FreeFallRunStats* run_stats)
+    {
+        // Collects the samples into the plot data, echoing them on the console when requested
+        auto run = [this, run_stats](FreeFallTrajectorySink& sink) { return run_stats ? run_sim(sink, *run_stats) : run_sim(sink); };
+        FreeFallColumnarSink columnar_sink{m_freefall_sim_plot_vars};
+        if (m_freefall_sim_vars.console_output)
+        {
+            FreeFallConsoleSink console_sink;
+            FreeFallTeeSink tee_sink{&columnar_sink, &console_sink};
+            m_freefall_sim_plot_vars.integrator_stats = run(tee_sink);
+        }
+        else
+        {
+            m_freefall_sim_plot_vars.integrator_stats = run(columnar_sink);
+        }
+        return std::move(m_freefall_sim_plot_vars);
+    }
+
+    template <typename GravityPolicy, typename DragPolicy, typename Integrator, typename Sampler>
+    FreeFallSimPlot SimEngine<GravityPolicy, DragPolicy, Integrator, Sampler>::run_sim()
+    {
+        return run_sim_to_plot(nullptr);
+    }
+
+    template <typename GravityPolicy, typename DragPolicy, typename Integrator, typename Sampler>
+    FreeFallSimPlot SimEngine<GravityPolicy, DragPolicy, Integrator, Sampler>::run_sim(FreeFallRunStats& run_stats)
+    {
+        return run_sim_to_plot(&run_stats);
+    }
+
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef FREEFALL_STREAMING_STATS_H
+#define FREEFALL_STREAMING_STATS_H
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Single pass, mergeable statistics. Each accumulator takes one value at a time in O(1) memory
+// (O(bins) for the sketch and the envelope), and partial accumulators of disjoint inputs merge into
+// the accumulator of the whole input, so workers aggregate on their own and combine at the end.
+
+namespace FreeFallSim
+{
+
+    // Count, mean, variance, min and max by Welford's update, merged with Chan et al.'s pairwise formula
+    class FreeFallWelford
+    {
+        public:
+        void add(double value)
+        {
+            ++m_count;
+            const auto delta = value - m_mean;
+            m_mean += delta / static_cast<double>(m_count);
+            m_m2 += delta * (value - m_mean);
+            m_min = value < m_min ? value : m_min;
+            m_max = value > m_max ? value : m_max;
+        }
+        void merge(const FreeFallWelford& other);
+
+        std::uint64_t count() const { return m_count; }
+        double mean() const { return m_mean; }
+        // sample variance (n - 1), 0 below two values
+        double variance() const { return m_count > 1 ? m_m2 / static_cast<double>(m_count - 1) : 0.0; }
+        double stddev() const;
+        double min() const { return m_min; }
+        double max() const { return m_max; }
+
+        private:
+        std::uint64_t m_count{0};
+        double m_mean{0.0};
+        double m_m2{0.0};                             // sum of squared deviations from the mean
+        double m_min{std::numeric_limits<double>::infinity()};
+        double m_max{-std::numeric_limits<double>::infinity()};
+    };
+
+    // DDSketch quantile sketch: value x > 0 is counted in bucket ceil(log_gamma(x)) with
+    // gamma = (1 + a) / (1 - a), so every quantile comes back within relative error a of a value of
+    // the input at that rank. Values up to kMinValue, zero and negative ones included, share a zero
+    // bucket. Buckets are plain counts, merging adds them and, until buckets are folded, gives the same
+    // sketch whatever the split of the input. Past max_buckets the lowest buckets are folded together,
+    // which only costs accuracy in the low quantiles.
+    class FreeFallQuantileSketch
+    {
+        public:
+        static constexpr double kMinValue{1e-9};
+
+        explicit FreeFallQuantileSketch(double relative_accuracy = 0.005, std::size_t max_buckets = 2048);
+
+        void add(double value);
+        // throws std::invalid_argument when the sketches differ in relative accuracy
+        void merge(const FreeFallQuantileSketch& other);
+
+        // q in [0, 1], 0 for an empty sketch
+        double quantile(double q) const;
+        std::uint64_t count() const { return m_count; }
+        double relative_accuracy() const { return m_relative_accuracy; }
+        std::size_t bucket_count() const { return m_buckets.size(); }
+        std::size_t memory_bytes() const { return m_buckets.capacity() * sizeof(std::uint64_t); }
+
+        private:
+        int bucket_index(double value) const;
+        void add_to_bucket(int index, std::uint64_t count);
+        void fold_lowest_buckets();
+
+        double m_relative_accuracy;
+        double m_gamma;
+        double m_inverse_log_gamma;
+        std::size_t m_max_buckets;
+        std::vector<std::uint64_t> m_buckets;         // counts of buckets m_first_index, m_first_index + 1, ...
+        int m_first_index{0};
+        std::uint64_t m_zero_count{0};
+        std::uint64_t m_count{0};
+    };
+
+    // Position and velocity statistics per time bin over many runs, the envelope of an ensemble of
+    // trajectories. Bin i is centred on t = i*bin_width, so runs sampled every bin_width put each sample
+    // in the middle of a bin whatever the rounding of the sample times. Each run adds at most one state
+    // per bin (see begin_run()), so every run counts once and count() of a bin is the number of runs
+    // still in the air at its time.
+    class FreeFallTimeEnvelope
+    {
+        public:
+        struct Bin
+        {
+            FreeFallWelford position;                 // (x) m
+            FreeFallWelford velocity;                 // (v) m/s, negative while falling
+        };
+
+        FreeFallTimeEnvelope() = default;
+        // bins up to the one of end_time, bin_width <= 0 gives an empty envelope
+        FreeFallTimeEnvelope(double bin_width, double end_time);
+
+        // Starts the next run, its first state in each bin is kept and later ones in the same bin skipped
+        void begin_run() { m_last_bin = std::numeric_limits<std::size_t>::max(); }
+        void add(double time, double position, double velocity)
+        {
+            const auto scaled_time = time * m_inverse_bin_width + 0.5;
+            if (!(scaled_time >= 0.0 && scaled_time < static_cast<double>(m_bins.size())))
+                return;
+            const auto bin = static_cast<std::size_t>(scaled_time);
+            if (bin == m_last_bin)
+                return;
+            m_last_bin = bin;
+            m_bins[bin].position.add(position);
+            m_bins[bin].velocity.add(velocity);
+        }
+        // throws std::invalid_argument when the bin layouts differ
+        void merge(const FreeFallTimeEnvelope& other);
+
+        double bin_width() const { return m_bin_width; }
+        std::size_t size() const { return m_bins.size(); }
+        const Bin& operator[](std::size_t bin) const { return m_bins[bin]; }
+        double bin_time(std::size_t bin) const { return m_bin_width * static_cast<double>(bin); }
+        std::size_t memory_bytes() const { return m_bins.capacity() * sizeof(Bin); }
+
+        private:
+        double m_bin_width{0.0};
+        double m_inverse_bin_width{0.0};
+        std::vector<Bin> m_bins;
+        std::size_t m_last_bin{std::numeric_limits<std::size_t>::max()};
+    };
+
+}
+
+#endif
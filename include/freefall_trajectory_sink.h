@@ -0,0 +1,239 @@
+#ifndef FREEFALL_TRAJECTORY_SINK_H
+#define FREEFALL_TRAJECTORY_SINK_H
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <initializer_list>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include "freefall_dragforce_simulation.h"
+
+namespace FreeFallSim
+{
+
+    // Destination of the samples produced by run_sim(). A sample carries the same four columns
+    // as FreeFallSimPlot, velocity is stored as in the plot data (negative while falling).
+    class FreeFallTrajectorySink
+    {
+        public:
+        virtual ~FreeFallTrajectorySink() = default;
+
+        // expected_samples is a sizing hint, 0 when the engine can not estimate it
+        virtual void begin(std::size_t expected_samples) { (void)expected_samples; }
+        virtual void write(double time, double position, double velocity, double net_force) = 0;
+        virtual void end() {}
+        // located events, reported between begin() and end() but not necessarily in time order with the samples
+        virtual void event(const FreeFallEvent& event) { (void)event; }
+        // trajectory memory the sink currently holds, reported in run statistics
+        virtual std::size_t buffered_bytes() const { return 0; }
+    };
+
+    // In-memory columnar buffer, appends to the vectors of a FreeFallSimPlot
+    class FreeFallColumnarSink : public FreeFallTrajectorySink
+    {
+        public:
+        explicit FreeFallColumnarSink(FreeFallSimPlot& sim_plot_vars): m_sim_plot_vars(sim_plot_vars)
+        {}
+
+        void begin(std::size_t expected_samples) override;
+        std::size_t buffered_bytes() const override;
+        void event(const FreeFallEvent& event) override { m_sim_plot_vars.events.push_back(event); }
+        void write(double time, double position, double velocity, double net_force) override
+        {
+            m_sim_plot_vars.time_data.emplace_back(time);
+            m_sim_plot_vars.position_data.emplace_back(position);
+            m_sim_plot_vars.velocity_data.emplace_back(velocity);
+            m_sim_plot_vars.netforce_data.emplace_back(net_force);
+        }
+
+        private:
+        FreeFallSimPlot& m_sim_plot_vars;
+    };
+
+    // Keeps only summary values, for runs where the trajectory itself is not needed
+    class FreeFallStatsSink : public FreeFallTrajectorySink
+    {
+        public:
+        void write(double time, double position, double velocity, double net_force) override
+        {
+            if (m_sample_count == 0)
+            {
+                m_first_time = time;
+                m_first_position = position;
+            }
+            ++m_sample_count;
+            m_last_time = time;
+            m_last_position = position;
+            m_last_velocity = velocity;
+            m_last_net_force = net_force;
+            m_max_speed = std::max(m_max_speed, std::abs(velocity));
+            m_min_abs_net_force = std::min(m_min_abs_net_force, std::abs(net_force));
+        }
+
+        std::uint64_t sample_count() const { return m_sample_count; }
+        double first_time() const { return m_first_time; }
+        double first_position() const { return m_first_position; }
+        double last_time() const { return m_last_time; }
+        double last_position() const { return m_last_position; }
+        double last_velocity() const { return m_last_velocity; }
+        double last_net_force() const { return m_last_net_force; }
+        double max_speed() const { return m_max_speed; }
+        double min_abs_net_force() const { return m_min_abs_net_force; }
+
+        private:
+        std::uint64_t m_sample_count{0};
+        double m_first_time{0.0};
+        double m_first_position{0.0};
+        double m_last_time{0.0};
+        double m_last_position{0.0};
+        double m_last_velocity{0.0};
+        double m_last_net_force{0.0};
+        double m_max_speed{0.0};
+        double m_min_abs_net_force{std::numeric_limits<double>::infinity()};
+    };
+
+    // Bounded columnar buffer holding the most recent capacity samples, older ones are overwritten
+    class FreeFallRingBufferSink : public FreeFallTrajectorySink
+    {
+        public:
+        explicit FreeFallRingBufferSink(std::size_t capacity);
+
+        void write(double time, double position, double velocity, double net_force) override
+        {
+            m_time[m_next] = time;
+            m_position[m_next] = position;
+            m_velocity[m_next] = velocity;
+            m_net_force[m_next] = net_force;
+            m_next = m_next + 1 == m_time.size() ? 0 : m_next + 1;
+            ++m_total_samples;
+        }
+
+        std::size_t buffered_bytes() const override { return 4 * m_time.size() * sizeof(double); }
+        std::size_t capacity() const { return m_time.size(); }
+        std::size_t size() const;
+        std::uint64_t total_samples() const { return m_total_samples; }
+        // Retained samples, oldest first
+        FreeFallSimPlot to_plot() const;
+
+        private:
+        std::vector<double> m_time;
+        std::vector<double> m_position;
+        std::vector<double> m_velocity;
+        std::vector<double> m_net_force;
+        std::size_t m_next{0};
+        std::uint64_t m_total_samples{0};
+    };
+
+    // Runtime selectable replacement of the former ENABLE_CONSOLE_PRINT output
+    class FreeFallConsoleSink : public FreeFallTrajectorySink
+    {
+        public:
+        explicit FreeFallConsoleSink(std::ostream& output = std::cout): m_output(output)
+        {}
+
+        void write(double time, double position, double velocity, double net_force) override;
+        void event(const FreeFallEvent& event) override;
+
+        private:
+        std::ostream& m_output;
+    };
+
+    // Forwards every sample to several sinks
+    class FreeFallTeeSink : public FreeFallTrajectorySink
+    {
+        public:
+        FreeFallTeeSink(std::initializer_list<FreeFallTrajectorySink*> sinks): m_sinks(sinks)
+        {}
+
+        void begin(std::size_t expected_samples) override
+        {
+            for (auto* sink : m_sinks)
+                sink->begin(expected_samples);
+        }
+        void write(double time, double position, double velocity, double net_force) override
+        {
+            for (auto* sink : m_sinks)
+                sink->write(time, position, velocity, net_force);
+        }
+        void end() override
+        {
+            for (auto* sink : m_sinks)
+                sink->end();
+        }
+        void event(const FreeFallEvent& event) override
+        {
+            for (auto* sink : m_sinks)
+                sink->event(event);
+        }
+        std::size_t buffered_bytes() const override
+        {
+            std::size_t bytes{0};
+            for (const auto* sink : m_sinks)
+                bytes += sink->buffered_bytes();
+            return bytes;
+        }
+
+        private:
+        std::vector<FreeFallTrajectorySink*> m_sinks;
+    };
+
+    // Binary columnar trajectory file written through a large stdio buffer.
+    // Layout, little endian as written by the host:
+    //   header: char magic[8] "FFTRAJ01", uint32 version, uint32 block_capacity, uint64 sample_count, uint64 reserved
+    //   blocks: uint64 count, then count doubles of time, position, velocity and net force
+    // Samples are staged per column in memory and flushed one block at a time, so memory stays
+    // bounded by block_capacity whatever the length of the run. sample_count is patched on end().
+    class FreeFallBinaryFileSink : public FreeFallTrajectorySink
+    {
+        public:
+        static constexpr char kMagic[8] = {'F', 'F', 'T', 'R', 'A', 'J', '0', '1'};
+        static constexpr std::uint32_t kVersion{1};
+
+        // throws std::runtime_error when the file can not be created. block_capacity is clamped to
+        // [1, 2^32-1], the range of its header field.
+        explicit FreeFallBinaryFileSink(const std::string& path, std::size_t block_capacity = 64 * 1024);
+        ~FreeFallBinaryFileSink() override;
+
+        FreeFallBinaryFileSink(const FreeFallBinaryFileSink& src) = delete;
+        FreeFallBinaryFileSink& operator=(const FreeFallBinaryFileSink& src) = delete;
+
+        void write(double time, double position, double velocity, double net_force) override
+        {
+            m_time.push_back(time);
+            m_position.push_back(position);
+            m_velocity.push_back(velocity);
+            m_net_force.push_back(net_force);
+            if (m_time.size() == m_block_capacity)
+                flush_block();
+        }
+        void end() override;
+        std::size_t buffered_bytes() const override;
+
+        std::uint64_t sample_count() const { return m_sample_count; }
+
+        private:
+        void flush_block();
+        void write_header();
+
+        std::FILE* m_file{nullptr};
+        std::vector<char> m_io_buffer;
+        std::size_t m_block_capacity;
+        std::vector<double> m_time;
+        std::vector<double> m_position;
+        std::vector<double> m_velocity;
+        std::vector<double> m_net_force;
+        std::uint64_t m_sample_count{0};
+        bool m_finished{false};
+    };
+
+    // Reads a file written by FreeFallBinaryFileSink back into plot data,
+    // throws std::runtime_error on a missing or malformed file
+    FreeFallSimPlot read_binary_trajectory(const std::string& path);
+
+}
+
+#endif
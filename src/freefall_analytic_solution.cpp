@@ -0,0 +1,277 @@
+
+#include "freefall_analytic_solution.h"
+#include <algorithm>
+#include <limits>
+
+namespace FreeFallSim
+{
+    namespace
+    {
+        // ln(cosh(y)) and ln(sinh(y)) without overflow for large arguments
+        double log_cosh(double y)
+        {
+            const auto abs_y = std::abs(y);
+            return abs_y + std::log1p(std::exp(-2.0 * abs_y)) - M_LN2;
+        }
+
+        double log_sinh(double y)
+        {
+            return y + std::log1p(-std::exp(-2.0 * y)) - M_LN2;
+        }
+
+        // acosh(exp(z)) for z >= 0 and asinh(exp(z)), both stay finite when exp(z) would overflow
+        double acosh_exp(double z)
+        {
+            return z + std::log1p(std::sqrt(-std::expm1(-2.0 * z)));
+        }
+
+        double asinh_exp(double z)
+        {
+            if (z < 0.0)
+                return std::asinh(std::exp(z));
+            return z + std::log1p(std::sqrt(1.0 + std::exp(-2.0 * z)));
+        }
+    }
+
+        FreeFallConstGravityAnalytic::FreeFallConstGravityAnalytic(const FreeFallObjProfile& sim_obj_profile,
+            const FreeFallSimulationProfile& sim_freefall_vars)
+        {
+            // coefficients come from the same force lambdas run_sim() uses
+            auto unit_state = sim_freefall_vars;
+            unit_state.velocity = 1.0;
+            m_mass = sim_obj_profile.mass_of_object;
+            m_gravity = const_weight_force(sim_obj_profile, unit_state) / m_mass;
+            m_drag_per_mass = drag_force(sim_obj_profile, unit_state) / m_mass;
+            m_initial_position = sim_freefall_vars.position;
+            m_initial_velocity = sim_freefall_vars.velocity;
+
+            if (m_drag_per_mass > 0.0)
+            {
+                m_terminal_velocity = std::sqrt(m_gravity / m_drag_per_mass);
+                m_tau = m_terminal_velocity / m_gravity;
+                m_length_scale = m_terminal_velocity * m_terminal_velocity / m_gravity;
+            }
+            else
+            {
+                m_terminal_velocity = std::numeric_limits<double>::infinity();
+                m_tau = std::numeric_limits<double>::infinity();
+                m_length_scale = std::numeric_limits<double>::infinity();
+            }
+
+            // thrown upward, climb to the apex first and fall from rest afterwards
+            m_apex_position = m_initial_position;
+            m_descent_velocity = m_initial_velocity;
+            if (m_initial_velocity < 0.0)
+            {
+                const auto upward_speed = -m_initial_velocity;
+                if (m_drag_per_mass > 0.0)
+                {
+                    m_launch_angle = std::atan(upward_speed / m_terminal_velocity);
+                    m_apex_time = m_tau * m_launch_angle;
+                    m_apex_position = m_initial_position - m_length_scale * std::log(std::cos(m_launch_angle));
+                }
+                else
+                {
+                    m_apex_time = upward_speed / m_gravity;
+                    m_apex_position = m_initial_position + upward_speed * upward_speed / (2.0 * m_gravity);
+                }
+                m_descent_velocity = 0.0;
+            }
+
+            if (m_drag_per_mass <= 0.0)
+            {
+                m_regime = DescentRegime::NoDrag;
+            }
+            else if (m_descent_velocity < m_terminal_velocity)
+            {
+                m_regime = DescentRegime::BelowTerminal;
+                m_phase = std::atanh(m_descent_velocity / m_terminal_velocity);
+                m_log_phase_term = log_cosh(m_phase);
+            }
+            else if (m_descent_velocity > m_terminal_velocity)
+            {
+                m_regime = DescentRegime::AboveTerminal;
+                m_phase = std::atanh(m_terminal_velocity / m_descent_velocity);
+                m_log_phase_term = log_sinh(m_phase);
+            }
+            else
+            {
+                m_regime = DescentRegime::AtTerminal;
+            }
+        }
+
+        double FreeFallConstGravityAnalytic::descent_velocity(double descent_time) const
+        {
+            switch (m_regime)
+            {
+                case DescentRegime::NoDrag:
+                    return m_descent_velocity + m_gravity * descent_time;
+                case DescentRegime::BelowTerminal:
+                    return m_terminal_velocity * std::tanh(descent_time / m_tau + m_phase);
+                case DescentRegime::AboveTerminal:
+                    return m_terminal_velocity / std::tanh(descent_time / m_tau + m_phase);
+                case DescentRegime::AtTerminal:
+                    break;
+            }
+            return m_terminal_velocity;
+        }
+
+        double FreeFallConstGravityAnalytic::descent_distance(double descent_time) const
+        {
+            switch (m_regime)
+            {
+                case DescentRegime::NoDrag:
+                    return m_descent_velocity * descent_time + 0.5 * m_gravity * descent_time * descent_time;
+                case DescentRegime::BelowTerminal:
+                    return m_length_scale * (log_cosh(descent_time / m_tau + m_phase) - m_log_phase_term);
+                case DescentRegime::AboveTerminal:
+                    return m_length_scale * (log_sinh(descent_time / m_tau + m_phase) - m_log_phase_term);
+                case DescentRegime::AtTerminal:
+                    break;
+            }
+            return m_terminal_velocity * descent_time;
+        }
+
+        double FreeFallConstGravityAnalytic::descent_time_for(double distance) const
+        {
+            switch (m_regime)
+            {
+                case DescentRegime::NoDrag:
+                    // rationalized root of 0.5*g*t^2 + v*t - d = 0, no cancellation for large v
+                    return 2.0 * distance / (m_descent_velocity + std::sqrt(m_descent_velocity * m_descent_velocity + 2.0 * m_gravity * distance));
+                case DescentRegime::BelowTerminal:
+                    return m_tau * (acosh_exp(distance / m_length_scale + m_log_phase_term) - m_phase);
+                case DescentRegime::AboveTerminal:
+                    return m_tau * (asinh_exp(distance / m_length_scale + m_log_phase_term) - m_phase);
+                case DescentRegime::AtTerminal:
+                    break;
+            }
+            return distance / m_terminal_velocity;
+        }
+
+        double FreeFallConstGravityAnalytic::net_force_at(double velocity) const
+        {
+            // drag opposes the motion, also on the way up, unlike QuadraticDragPolicy of the engine
+            return m_mass * (m_gravity - m_drag_per_mass * velocity * std::abs(velocity));
+        }
+
+        FreeFallAnalyticState FreeFallConstGravityAnalytic::state_at(double time) const
+        {
+            FreeFallAnalyticState state{time, 0.0, 0.0, 0.0};
+            if (time < m_apex_time)
+            {
+                if (m_regime == DescentRegime::NoDrag)
+                {
+                    state.velocity = m_initial_velocity + m_gravity * time;
+                    state.position = m_initial_position - m_initial_velocity * time - 0.5 * m_gravity * time * time;
+                }
+                else
+                {
+                    const auto angle = m_launch_angle - time / m_tau;
+                    state.velocity = -m_terminal_velocity * std::tan(angle);
+                    state.position = m_initial_position + m_length_scale * std::log(std::cos(angle) / std::cos(m_launch_angle));
+                }
+            }
+            else
+            {
+                const auto descent_time = time - m_apex_time;
+                state.velocity = descent_velocity(descent_time);
+                state.position = m_apex_position - descent_distance(descent_time);
+            }
+            state.net_force = net_force_at(state.velocity);
+            return state;
+        }
+
+        std::optional<double> FreeFallConstGravityAnalytic::time_to_height(double height) const
+        {
+            if (height > m_apex_position)
+                return std::nullopt;
+            if (height >= m_initial_position)
+            {
+                // only reachable on the way up (or at t = 0)
+                if (m_initial_velocity >= 0.0)
+                    return 0.0;
+                const auto rise = height - m_initial_position;
+                if (m_regime == DescentRegime::NoDrag)
+                {
+                    const auto discriminant = std::max(0.0, m_initial_velocity * m_initial_velocity - 2.0 * m_gravity * rise);
+                    return (-m_initial_velocity - std::sqrt(discriminant)) / m_gravity;
+                }
+                const auto cos_angle = std::min(1.0, std::cos(m_launch_angle) * std::exp(rise / m_length_scale));
+                return m_tau * (m_launch_angle - std::acos(cos_angle));
+            }
+            return m_apex_time + descent_time_for(m_apex_position - height);
+        }
+
+        FreeFallAnalyticState FreeFallConstGravityAnalytic::impact() const
+        {
+            const auto impact_time = time_to_height(0.0);
+            if (!impact_time)
+                return state_at(0.0);
+            auto state = state_at(*impact_time);
+            state.position = 0.0;
+            return state;
+        }
+
+        std::size_t FreeFallConstGravityAnalytic::write_trajectory(int sample_factor, FreeFallTrajectorySink& sink, double finish_time) const
+        {
+            const double spacing = std::max(sample_factor, 1);
+            if (m_initial_position < 0.0)
+                return 0;
+
+            std::size_t written{0};
+            auto emit = [&](double height, double time)
+            {
+                if (time > finish_time)
+                    return false;
+                const auto state = state_at(time);
+                sink.write(time, height, -state.velocity, state.net_force);
+                ++written;
+                return true;
+            };
+
+            // multiples of the spacing passed on the way up, then every multiple on the way down to the ground
+            const auto first_up = std::ceil(m_initial_position / spacing);
+            const auto apex_level = std::floor(m_apex_position / spacing);
+            const auto ascent_samples = m_apex_time > 0.0 ? std::max(0.0, apex_level - first_up + 1.0) : 0.0;
+            const auto descent_samples = apex_level + 1.0;
+            sink.begin(static_cast<std::size_t>(ascent_samples + descent_samples));
+
+            bool running{true};
+            if (m_apex_time > 0.0)
+            {
+                for (auto level = first_up; running && level <= apex_level; level += 1.0)
+                    running = emit(level * spacing, *time_to_height(level * spacing));
+            }
+            for (auto level = apex_level; running && level >= 0.0; level -= 1.0)
+            {
+                const auto height = level * spacing;
+                running = emit(height, m_apex_time + descent_time_for(m_apex_position - height));
+            }
+            sink.end();
+            return written;
+        }
+
+        FreeFallSimPlot FreeFallConstGravityAnalytic::sample_trajectory(int sample_factor) const
+        {
+            FreeFallSimPlot sim_plot_vars;
+            FreeFallColumnarSink columnar_sink{sim_plot_vars};
+            write_trajectory(sample_factor, columnar_sink);
+            return sim_plot_vars;
+        }
+
+        double estimate_impact_time(const FreeFallObjProfile& sim_obj_profile, const FreeFallSimulationProfile& sim_freefall_vars,
+            GravityProfile gravity_profile)
+        {
+            const double finish_time = sim_freefall_vars.finish_time;
+            if (sim_freefall_vars.position < 0.0)
+                return 0.0;
+            auto sim_vars = sim_freefall_vars;
+            if (gravity_profile == GravityProfile::NewtonGravitationModel)
+                sim_vars.gravity_acceleration = newton_gravitational_force(sim_obj_profile, sim_vars) / sim_obj_profile.mass_of_object;
+            if (!(sim_vars.gravity_acceleration > 0.0))
+                return finish_time;
+            const FreeFallConstGravityAnalytic analytic{sim_obj_profile, sim_vars};
+            return std::min(analytic.impact().time, finish_time);
+        }
+}
@@ -0,0 +1,86 @@
+#include "freefall_atmosphere.h"
+#include "freefall_sim_engine.h"
+#include <array>
+
+namespace FreeFallSim
+{
+    namespace
+    {
+        // US Standard Atmosphere 1976 base of each layer, geopotential height
+        struct AtmosphereLayer
+        {
+            double base_height;     // (Hb) m
+            double temperature;     // (Tb) K
+            double lapse_rate;      // (Lb) K/m
+            double pressure;        // (Pb) Pa
+        };
+
+        constexpr std::array<AtmosphereLayer, 7> kAtmosphereLayers{{
+            {0.0, 288.15, -0.0065, 101325.0},
+            {11000.0, 216.65, 0.0, 22632.06},
+            {20000.0, 216.65, 0.001, 5474.889},
+            {32000.0, 228.65, 0.0028, 868.0187},
+            {47000.0, 270.65, 0.0, 110.9063},
+            {51000.0, 270.65, -0.0028, 66.93887},
+            {71000.0, 214.65, -0.002, 3.956420},
+        }};
+
+        constexpr double kStandardGravity{9.80665};         // (g0) m/s^2
+        constexpr double kMolarMassAir{0.0289644};          // (M0) kg/mol
+        constexpr double kGasConstant{8.31432};             // (R*) J/(mol K), the 1976 value
+        // 1 km intervals before the first refinement of the density table
+        constexpr std::size_t kDensityTableFirstIntervals{static_cast<std::size_t>(kStandardAtmosphereTop / 1000.0)};
+    }
+
+        double us_standard_atmosphere_density_geopotential(double geopotential)
+        {
+            const auto height = std::clamp(geopotential, 0.0, kStandardAtmosphereTop);
+            auto layer = kAtmosphereLayers.begin();
+            while (std::next(layer) != kAtmosphereLayers.end() && height >= std::next(layer)->base_height)
+                ++layer;
+
+            const auto rise = height - layer->base_height;
+            const auto temperature = layer->temperature + layer->lapse_rate * rise;
+            const auto pressure = layer->lapse_rate != 0.0 ?
+                layer->pressure * std::pow(layer->temperature / temperature, kStandardGravity * kMolarMassAir / (kGasConstant * layer->lapse_rate)) :
+                layer->pressure * std::exp(-kStandardGravity * kMolarMassAir * rise / (kGasConstant * layer->temperature));
+            return pressure * kMolarMassAir / (kGasConstant * temperature);
+        }
+
+        double us_standard_atmosphere_density(double height)
+        {
+            return us_standard_atmosphere_density_geopotential(geopotential_height(std::max(height, 0.0)));
+        }
+
+        const FreeFallUniformTable& standard_atmosphere_density_table()
+        {
+            static const auto table = FreeFallUniformTable::fit(us_standard_atmosphere_density_geopotential, 0.0, kStandardAtmosphereTop,
+                kDensityTableTolerance, kDensityTableFirstIntervals);
+            return table;
+        }
+
+        FreeFallUniformTable make_newton_gravity_table(const FreeFallSimulationProfile& sim_vars, double top_height, double rel_tolerance)
+        {
+            const auto gravitational_parameter = sim_vars.kUniversalGravitationConst * sim_vars.kMassOfPlanet;
+            const auto planet_radius = sim_vars.kRadiusOfPlanet;
+            auto gravity = [gravitational_parameter, planet_radius](double position)
+            {
+                const auto distance = planet_radius + position;
+                return gravitational_parameter / (distance * distance);
+            };
+            return FreeFallUniformTable::fit(gravity, 0.0, std::max(top_height, 1.0), rel_tolerance);
+        }
+
+        TabulatedNewtonGravityPolicy::Coefficients TabulatedNewtonGravityPolicy::prepare(const FreeFallObjProfile& sim_obj_profile,
+            const FreeFallSimulationProfile& sim_vars)
+        {
+            // a throw upward climbs at most v^2/(2g) above the start, drag only lowers the apex
+            const auto start_gravity = newton_gravitational_force(sim_obj_profile, sim_vars) / sim_obj_profile.mass_of_object;
+            const auto climb = sim_vars.velocity < 0.0 ? sim_vars.velocity * sim_vars.velocity / (2.0 * start_gravity) : 0.0;
+            return {make_newton_gravity_table(sim_vars, sim_vars.position + climb)};
+        }
+
+        // The standard atmosphere models, prebuilt like the stock aliases
+        template class SimEngine<NewtonGravityPolicy, StandardAtmosphereDragPolicy, ProfileSelectedIntegrator, ProfileSelectedSampler>;
+        template class SimEngine<TabulatedNewtonGravityPolicy, StandardAtmosphereDragPolicy, ProfileSelectedIntegrator, ProfileSelectedSampler>;
+}
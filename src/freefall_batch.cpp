@@ -0,0 +1,933 @@
+#include "freefall_batch.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "freefall_bounded_queue.h"
+
+namespace FreeFallSim
+{
+    namespace
+    {
+        std::invalid_argument bad_value(std::string_view field, std::string_view value)
+        {
+            return std::invalid_argument("bad value '" + std::string(value) + "' for " + std::string(field));
+        }
+
+        double parse_real(std::string_view field, std::string_view value)
+        {
+            double result{0.0};
+            const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+            if (error != std::errc{} || end != value.data() + value.size())
+                throw bad_value(field, value);
+            return result;
+        }
+
+        template <typename Integer>
+        Integer parse_integer(std::string_view field, std::string_view value)
+        {
+            Integer result{0};
+            const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+            if (error != std::errc{} || end != value.data() + value.size())
+                throw bad_value(field, value);
+            return result;
+        }
+
+        bool parse_bool(std::string_view field, std::string_view value)
+        {
+            if (value == "true" || value == "1")
+                return true;
+            if (value == "false" || value == "0")
+                return false;
+            throw bad_value(field, value);
+        }
+
+        struct ScenarioField
+        {
+            std::string_view name;
+            void (*set)(FreeFallScenario& scenario, std::string_view name, std::string_view value);
+        };
+
+        const ScenarioField kScenarioFields[] = {
+            {"id", [](FreeFallScenario& s, std::string_view, std::string_view v) { s.id.assign(v); }},
+            {"gravity", [](FreeFallScenario& s, std::string_view n, std::string_view v)
+            {
+                if (v == "constant")
+                    s.gravity_profile = GravityProfile::ConstantGravity;
+                else if (v == "newton")
+                    s.gravity_profile = GravityProfile::NewtonGravitationModel;
+                else
+                    throw bad_value(n, v);
+            }},
+            {"drag_coefficient", [](FreeFallScenario& s, std::string_view n, std::string_view v) { s.sim_obj_profile.kDragCoefficient = parse_real(n, v); }},
+            {"mass", [](FreeFallScenario& s, std::string_view n, std::string_view v) { s.sim_obj_profile.mass_of_object = parse_real(n, v); }},
+            {"radius", [](FreeFallScenario& s, std::string_view n, std::string_view v) { s.sim_obj_profile.radius_of_object = parse_real(n, v); }},
+            {"fluid_density", [](FreeFallScenario& s, std::string_view n, std::string_view v) { s.sim_obj_profile.fluid_density_air = parse_real(n, v); }},
+            {"position", [](FreeFallScenario& s, std::string_view n, std::string_view v) { s.sim_freefall_vars.position = parse_real(n, v); }},
+            {"velocity", [](FreeFallScenario& s, std::string_view n, std::string_view v) { s.sim_freefall_vars.velocity = parse_real(n, v); }},
+            {"time_step", [](FreeFallScenario& s, std::string_view n, std::string_view v) { s.sim_freefall_vars.time_step = static_cast<float>(parse_real(n, v)); }},
+            {"sample_factor", [](FreeFallScenario& s, std::string_view n, std::string_view v) { s.sim_freefall_vars.sample_factor = parse_integer<int>(n, v); }},
+            {"finish_time", [](FreeFallScenario& s, std::string_view n, std::string_view v) { s.sim_freefall_vars.finish_time = parse_integer<int>(n, v); }},
+            {"gravity_acceleration", [](FreeFallScenario& s, std::string_view n, std::string_view v) { s.sim_freefall_vars.gravity_acceleration = parse_real(n, v); }},
+            {"sample_interval", [](FreeFallScenario& s, std::string_view n, std::string_view v) { s.sim_freefall_vars.sample_interval = parse_real(n, v); }},
+            {"max_points", [](FreeFallScenario& s, std::string_view n, std::string_view v) { s.sim_freefall_vars.max_points = parse_integer<std::size_t>(n, v); }},
+            {"abs_tolerance", [](FreeFallScenario& s, std::string_view n, std::string_view v) { s.sim_freefall_vars.abs_tolerance = parse_real(n, v); }},
+            {"rel_tolerance", [](FreeFallScenario& s, std::string_view n, std::string_view v) { s.sim_freefall_vars.rel_tolerance = parse_real(n, v); }},
+            {"integrator", [](FreeFallScenario& s, std::string_view n, std::string_view v)
+            {
+                if (v == "fixed_step")
+                    s.sim_freefall_vars.integrator = IntegratorProfile::FixedStep;
+                else if (v == "dormand_prince45")
+                    s.sim_freefall_vars.integrator = IntegratorProfile::DormandPrince45;
+                else if (v == "closed_form")
+                    s.sim_freefall_vars.integrator = IntegratorProfile::ClosedForm;
+                else
+                    throw bad_value(n, v);
+            }},
+            {"sampling", [](FreeFallScenario& s, std::string_view n, std::string_view v)
+            {
+                if (v == "height_modulo")
+                    s.sim_freefall_vars.sampling = SamplingProfile::HeightModulo;
+                else if (v == "time_interval")
+                    s.sim_freefall_vars.sampling = SamplingProfile::TimeInterval;
+                else if (v == "max_points")
+                    s.sim_freefall_vars.sampling = SamplingProfile::MaxPoints;
+                else
+                    throw bad_value(n, v);
+            }},
+            {"locate_impact", [](FreeFallScenario& s, std::string_view n, std::string_view v) { s.sim_freefall_vars.locate_impact = parse_bool(n, v); }},
+            {"steady_state_fast_forward", [](FreeFallScenario& s, std::string_view n, std::string_view v) { s.sim_freefall_vars.steady_state_fast_forward = parse_bool(n, v); }},
+        };
+
+        std::size_t find_field(std::string_view name)
+        {
+            for (std::size_t i = 0; i < std::size(kScenarioFields); ++i)
+                if (kScenarioFields[i].name == name)
+                    return i;
+            throw std::invalid_argument("unknown scenario field '" + std::string(name) + "'");
+        }
+
+        void set_field(FreeFallScenario& scenario, std::size_t field, std::string_view value)
+        {
+            kScenarioFields[field].set(scenario, kScenarioFields[field].name, value);
+        }
+
+        std::string_view trim(std::string_view text)
+        {
+            const auto first = text.find_first_not_of(" \t\r");
+            if (first == std::string_view::npos)
+                return {};
+            const auto last = text.find_last_not_of(" \t\r");
+            return text.substr(first, last - first + 1);
+        }
+
+        // Next CSV cell of line from offset, a quoted cell is unescaped into buffer. offset ends past the comma.
+        std::string_view next_csv_cell(std::string_view line, std::size_t& offset, std::string& buffer)
+        {
+            auto rest = line.substr(offset);
+            const auto first = rest.find_first_not_of(" \t");
+            if (first != std::string_view::npos && rest[first] == '"')
+            {
+                buffer.clear();
+                auto position = offset + first + 1;
+                while (true)
+                {
+                    if (position >= line.size())
+                        throw std::invalid_argument("unterminated quoted field");
+                    if (line[position] == '"')
+                    {
+                        if (position + 1 < line.size() && line[position + 1] == '"')
+                        {
+                            buffer.push_back('"');
+                            position += 2;
+                            continue;
+                        }
+                        ++position;
+                        break;
+                    }
+                    buffer.push_back(line[position++]);
+                }
+                const auto comma = line.find(',', position);
+                if (!trim(line.substr(position, comma == std::string_view::npos ? std::string_view::npos : comma - position)).empty())
+                    throw std::invalid_argument("text after a quoted field");
+                offset = comma == std::string_view::npos ? line.size() + 1 : comma + 1;
+                return buffer;
+            }
+            const auto comma = rest.find(',');
+            offset = comma == std::string_view::npos ? line.size() + 1 : offset + comma + 1;
+            return trim(rest.substr(0, comma));
+        }
+
+        // Minimal reader of one flat JSON object, values are strings, numbers, true, false or null
+        class JsonObjectParser
+        {
+            public:
+            explicit JsonObjectParser(std::string_view text): m_text(text)
+            {}
+
+            void expect(char c)
+            {
+                skip_space();
+                if (m_offset >= m_text.size() || m_text[m_offset] != c)
+                    throw std::invalid_argument(std::string("expected '") + c + "' in JSON object");
+                ++m_offset;
+            }
+
+            bool consume(char c)
+            {
+                skip_space();
+                if (m_offset < m_text.size() && m_text[m_offset] == c)
+                {
+                    ++m_offset;
+                    return true;
+                }
+                return false;
+            }
+
+            bool at_end()
+            {
+                skip_space();
+                return m_offset == m_text.size();
+            }
+
+            std::string_view string(std::string& buffer)
+            {
+                expect('"');
+                buffer.clear();
+                while (m_offset < m_text.size())
+                {
+                    const char c = m_text[m_offset++];
+                    if (c == '"')
+                        return buffer;
+                    if (c != '\\')
+                    {
+                        buffer.push_back(c);
+                        continue;
+                    }
+                    if (m_offset >= m_text.size())
+                        break;
+                    const char escaped = m_text[m_offset++];
+                    switch (escaped)
+                    {
+                        case '"': case '\\': case '/': buffer.push_back(escaped); break;
+                        case 'n': buffer.push_back('\n'); break;
+                        case 't': buffer.push_back('\t'); break;
+                        case 'r': buffer.push_back('\r'); break;
+                        case 'b': buffer.push_back('\b'); break;
+                        case 'f': buffer.push_back('\f'); break;
+                        default: throw std::invalid_argument("unsupported escape in JSON string");
+                    }
+                }
+                throw std::invalid_argument("unterminated JSON string");
+            }
+
+            // a string, or the raw text of a number or literal; null gives an empty optional
+            std::optional<std::string_view> value(std::string& buffer)
+            {
+                skip_space();
+                if (m_offset < m_text.size() && m_text[m_offset] == '"')
+                    return string(buffer);
+                const auto end = m_text.find_first_of(",} \t\r", m_offset);
+                const auto raw = m_text.substr(m_offset, end == std::string_view::npos ? std::string_view::npos : end - m_offset);
+                if (raw.empty())
+                    throw std::invalid_argument("missing JSON value");
+                m_offset += raw.size();
+                if (raw == "null")
+                    return std::nullopt;
+                return raw;
+            }
+
+            private:
+            void skip_space()
+            {
+                while (m_offset < m_text.size() && (m_text[m_offset] == ' ' || m_text[m_offset] == '\t' || m_text[m_offset] == '\r'))
+                    ++m_offset;
+            }
+
+            std::string_view m_text;
+            std::size_t m_offset{0};
+        };
+
+        void append_real(std::string& output, double value)
+        {
+            char buffer[32];
+            const auto [end, error] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            output.append(buffer, error == std::errc{} ? end : buffer);
+        }
+
+        // shortest text of the float itself, 0.01f is written as 0.01 and not as its widened double
+        void append_real(std::string& output, float value)
+        {
+            char buffer[32];
+            const auto [end, error] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            output.append(buffer, error == std::errc{} ? end : buffer);
+        }
+
+        // JSON has no NaN or infinity
+        void append_json_real(std::string& output, double value)
+        {
+            if (std::isfinite(value))
+                append_real(output, value);
+            else
+                output.append("null");
+        }
+
+        void append_unsigned(std::string& output, std::uint64_t value)
+        {
+            char buffer[24];
+            const auto [end, error] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            output.append(buffer, error == std::errc{} ? end : buffer);
+        }
+
+        void append_csv_text(std::string& output, std::string_view text)
+        {
+            if (text.find_first_of(",\"\n\r") == std::string_view::npos)
+            {
+                output.append(text);
+                return;
+            }
+            output.push_back('"');
+            for (const char c : text)
+            {
+                if (c == '"')
+                    output.push_back('"');
+                output.push_back(c);
+            }
+            output.push_back('"');
+        }
+
+        void append_json_text(std::string& output, std::string_view text)
+        {
+            output.push_back('"');
+            for (const char c : text)
+            {
+                switch (c)
+                {
+                    case '"': output.append("\\\""); break;
+                    case '\\': output.append("\\\\"); break;
+                    case '\n': output.append("\\n"); break;
+                    case '\t': output.append("\\t"); break;
+                    case '\r': output.append("\\r"); break;
+                    default: output.push_back(c);
+                }
+            }
+            output.push_back('"');
+        }
+
+        // Trajectory rows of one scenario as CSV text
+        class CsvTrajectorySink : public FreeFallTrajectorySink
+        {
+            public:
+            CsvTrajectorySink(std::string& output, std::uint64_t index): m_output(output), m_index(index)
+            {}
+
+            void write(double time, double position, double velocity, double net_force) override
+            {
+                append_unsigned(m_output, m_index);
+                m_output.push_back(',');
+                append_real(m_output, time);
+                m_output.push_back(',');
+                append_real(m_output, position);
+                m_output.push_back(',');
+                append_real(m_output, velocity);
+                m_output.push_back(',');
+                append_real(m_output, net_force);
+                m_output.push_back('\n');
+            }
+
+            private:
+            std::string& m_output;
+            std::uint64_t m_index;
+        };
+
+        struct BatchChunk
+        {
+            std::uint64_t sequence{0};
+            std::vector<FreeFallScenario> scenarios;
+            std::string summaries;
+            std::string trajectories;
+            std::uint64_t scenario_count{0};
+            std::uint64_t landed{0};
+            std::uint64_t trajectory_samples{0};
+        };
+
+        // Counts the chunks between parser and writer, the parser blocks at the limit
+        class ChunkWindow
+        {
+            public:
+            explicit ChunkWindow(std::size_t limit): m_limit(limit)
+            {}
+
+            bool acquire()
+            {
+                std::unique_lock lock{m_mutex};
+                m_released.wait(lock, [this] { return m_stopped || m_in_flight < m_limit; });
+                if (m_stopped)
+                    return false;
+                ++m_in_flight;
+                m_max_in_flight = std::max(m_max_in_flight, m_in_flight);
+                return true;
+            }
+
+            void release()
+            {
+                {
+                    std::lock_guard lock{m_mutex};
+                    --m_in_flight;
+                }
+                m_released.notify_one();
+            }
+
+            void stop()
+            {
+                {
+                    std::lock_guard lock{m_mutex};
+                    m_stopped = true;
+                }
+                m_released.notify_all();
+            }
+
+            std::size_t max_in_flight()
+            {
+                std::lock_guard lock{m_mutex};
+                return m_max_in_flight;
+            }
+
+            private:
+            std::size_t m_limit;
+            std::size_t m_in_flight{0};
+            std::size_t m_max_in_flight{0};
+            std::mutex m_mutex;
+            std::condition_variable m_released;
+            bool m_stopped{false};
+        };
+    }
+
+        FreeFallMappedFile::FreeFallMappedFile(const std::string& path)
+        {
+            const auto descriptor = ::open(path.c_str(), O_RDONLY);
+            if (descriptor < 0)
+                throw std::runtime_error("FreeFallMappedFile: can not open " + path);
+            struct stat file_status{};
+            if (::fstat(descriptor, &file_status) != 0)
+            {
+                ::close(descriptor);
+                throw std::runtime_error("FreeFallMappedFile: can not stat " + path);
+            }
+            m_size = static_cast<std::size_t>(file_status.st_size);
+            if (m_size > 0)
+            {
+                auto* mapping = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+                if (mapping == MAP_FAILED)
+                {
+                    ::close(descriptor);
+                    throw std::runtime_error("FreeFallMappedFile: can not map " + path);
+                }
+                m_mapping = mapping;
+                ::madvise(m_mapping, m_size, MADV_SEQUENTIAL);
+            }
+            ::close(descriptor);
+        }
+
+        void FreeFallMappedFile::release_before(std::size_t offset)
+        {
+            static const auto page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+            const auto end = std::min(offset, m_size) / page_size * page_size;
+            if (m_mapping == nullptr || end <= m_released)
+                return;
+            ::madvise(static_cast<char*>(m_mapping) + m_released, end - m_released, MADV_DONTNEED);
+            m_released = end;
+        }
+
+        FreeFallMappedFile::~FreeFallMappedFile()
+        {
+            if (m_mapping != nullptr)
+                ::munmap(m_mapping, m_size);
+        }
+
+        FreeFallScenarioFormat scenario_format_from_path(const std::string& path)
+        {
+            const auto dot = path.find_last_of('.');
+            const auto extension = dot == std::string::npos ? std::string{} : path.substr(dot);
+            if (extension == ".jsonl" || extension == ".ndjson" || extension == ".json")
+                return FreeFallScenarioFormat::JsonLines;
+            return FreeFallScenarioFormat::Csv;
+        }
+
+        FreeFallScenarioReader::FreeFallScenarioReader(std::string_view text, FreeFallScenarioFormat format, FreeFallScenario defaults):
+            m_text(text),
+            m_format(format),
+            m_defaults(std::move(defaults))
+        {
+            if (m_format != FreeFallScenarioFormat::Csv)
+                return;
+            std::string_view header;
+            if (!next_line(header))
+                return;
+            std::string buffer;
+            try
+            {
+                for (std::size_t offset = 0; offset <= header.size();)
+                    m_columns.push_back(find_field(next_csv_cell(header, offset, buffer)));
+            }
+            catch (const std::invalid_argument& error)
+            {
+                throw std::invalid_argument("line " + std::to_string(m_line_number) + ": " + error.what());
+            }
+        }
+
+        bool FreeFallScenarioReader::next_line(std::string_view& line)
+        {
+            while (m_offset < m_text.size())
+            {
+                const auto end = m_text.find('\n', m_offset);
+                line = m_text.substr(m_offset, end == std::string_view::npos ? std::string_view::npos : end - m_offset);
+                m_offset = end == std::string_view::npos ? m_text.size() : end + 1;
+                ++m_line_number;
+                line = trim(line);
+                if (line.empty() || (m_format == FreeFallScenarioFormat::Csv && line.front() == '#'))
+                    continue;
+                return true;
+            }
+            return false;
+        }
+
+        bool FreeFallScenarioReader::next(FreeFallScenario& scenario)
+        {
+            std::string_view line;
+            if (!next_line(line))
+                return false;
+            scenario = m_defaults;
+            scenario.index = m_next_index++;
+            try
+            {
+                if (m_format == FreeFallScenarioFormat::Csv)
+                    parse_csv(line, scenario);
+                else
+                    parse_json(line, scenario);
+            }
+            catch (const std::invalid_argument& error)
+            {
+                throw std::invalid_argument("line " + std::to_string(m_line_number) + ": " + error.what());
+            }
+            return true;
+        }
+
+        void FreeFallScenarioReader::parse_csv(std::string_view line, FreeFallScenario& scenario) const
+        {
+            std::string buffer;
+            std::size_t offset{0};
+            for (const auto field : m_columns)
+            {
+                if (offset > line.size())
+                    throw std::invalid_argument("fewer cells than header columns");
+                const auto cell = next_csv_cell(line, offset, buffer);
+                // an empty cell keeps the default
+                if (!cell.empty())
+                    set_field(scenario, field, cell);
+            }
+            if (offset <= line.size())
+                throw std::invalid_argument("more cells than header columns");
+        }
+
+        void FreeFallScenarioReader::parse_json(std::string_view line, FreeFallScenario& scenario) const
+        {
+            JsonObjectParser parser{line};
+            std::string key_buffer;
+            std::string value_buffer;
+            parser.expect('{');
+            if (!parser.consume('}'))
+            {
+                do
+                {
+                    const auto field = find_field(parser.string(key_buffer));
+                    parser.expect(':');
+                    const auto value = parser.value(value_buffer);
+                    if (value)
+                        set_field(scenario, field, *value);
+                } while (parser.consume(','));
+                parser.expect('}');
+            }
+            if (!parser.at_end())
+                throw std::invalid_argument("text after the JSON object");
+        }
+
+        FreeFallScenarioSummary simulate_scenario(const FreeFallScenario& scenario, FreeFallTrajectorySink* trajectory)
+        {
+            FreeFallStatsSink stats_sink;
+            FreeFallTeeSink tee_sink{&stats_sink, trajectory};
+            FreeFallTrajectorySink& sink = trajectory ? static_cast<FreeFallTrajectorySink&>(tee_sink) : stats_sink;
+            FreeFallIntegratorStats integrator_stats;
+            if (scenario.gravity_profile == GravityProfile::NewtonGravitationModel)
+            {
+                FreeFallNewtonGravitySimlation sim{scenario.sim_obj_profile, scenario.sim_freefall_vars, FreeFallSimPlot{}};
+                integrator_stats = sim.run_sim(sink);
+            }
+            else
+            {
+                FreeFallConstGravitySimlation sim{scenario.sim_obj_profile, scenario.sim_freefall_vars, FreeFallSimPlot{}};
+                integrator_stats = sim.run_sim(sink);
+            }
+
+            FreeFallScenarioSummary summary;
+            summary.index = scenario.index;
+            summary.id = scenario.id;
+            summary.samples = stats_sink.sample_count();
+            summary.steps = integrator_stats.steps_taken;
+            if (summary.samples > 0)
+            {
+                summary.landed = stats_sink.last_position() <= 0.0;
+                summary.impact_time = stats_sink.last_time();
+                summary.impact_velocity = -stats_sink.last_velocity();
+                summary.max_speed = stats_sink.max_speed();
+                summary.final_position = stats_sink.last_position();
+            }
+            return summary;
+        }
+
+        const char* const kScenarioSummaryCsvHeader{"index,id,landed,impact_time,impact_velocity,max_speed,final_position,samples,steps\n"};
+        const char* const kTrajectoryCsvHeader{"index,time,position,velocity,net_force\n"};
+
+        void append_summary_csv(std::string& output, const FreeFallScenarioSummary& summary)
+        {
+            append_unsigned(output, summary.index);
+            output.push_back(',');
+            append_csv_text(output, summary.id);
+            output.append(summary.landed ? ",1," : ",0,");
+            append_real(output, summary.impact_time);
+            output.push_back(',');
+            append_real(output, summary.impact_velocity);
+            output.push_back(',');
+            append_real(output, summary.max_speed);
+            output.push_back(',');
+            append_real(output, summary.final_position);
+            output.push_back(',');
+            append_unsigned(output, summary.samples);
+            output.push_back(',');
+            append_unsigned(output, summary.steps);
+            output.push_back('\n');
+        }
+
+        void append_summary_json(std::string& output, const FreeFallScenarioSummary& summary)
+        {
+            output.append("{\"index\":");
+            append_unsigned(output, summary.index);
+            output.append(",\"id\":");
+            append_json_text(output, summary.id);
+            output.append(summary.landed ? ",\"landed\":true" : ",\"landed\":false");
+            output.append(",\"impact_time\":");
+            append_real(output, summary.impact_time);
+            output.append(",\"impact_velocity\":");
+            append_real(output, summary.impact_velocity);
+            output.append(",\"max_speed\":");
+            append_real(output, summary.max_speed);
+            output.append(",\"final_position\":");
+            append_real(output, summary.final_position);
+            output.append(",\"samples\":");
+            append_unsigned(output, summary.samples);
+            output.append(",\"steps\":");
+            append_unsigned(output, summary.steps);
+            output.append("}\n");
+        }
+
+        const char* const kConvergenceCsvHeader{"index,id,converged,landed,recommended_time_step,levels,steps,"
+            "impact_time,impact_time_error,impact_time_order,impact_time_extrapolated,"
+            "impact_velocity,impact_velocity_error,impact_velocity_order,impact_velocity_extrapolated,"
+            "terminal_time,terminal_time_error,terminal_time_order,terminal_time_extrapolated,"
+            "terminal_velocity,terminal_velocity_error,terminal_velocity_order,terminal_velocity_extrapolated\n"};
+
+    namespace
+    {
+        // The recommended level of a study, or one of NaN values for a study without levels
+        FreeFallConvergenceLevel recommended_level(const FreeFallConvergenceResult& result)
+        {
+            if (!result.levels.empty())
+                return result.levels.at(result.recommended_level);
+            FreeFallConvergenceLevel level;
+            level.time_step = std::numeric_limits<float>::quiet_NaN();
+            level.impact_time = level.impact_velocity = std::numeric_limits<double>::quiet_NaN();
+            level.impact_time_error = level.impact_velocity_error = std::numeric_limits<double>::quiet_NaN();
+            return level;
+        }
+    }
+
+        void append_convergence_csv(std::string& output, const FreeFallScenario& scenario, const FreeFallConvergenceResult& result)
+        {
+            const auto level = recommended_level(result);
+            append_unsigned(output, scenario.index);
+            output.push_back(',');
+            append_csv_text(output, scenario.id);
+            output.append(result.converged ? ",1" : ",0");
+            output.append(result.levels.empty() ? ",0," : ",1,");
+            append_real(output, level.time_step);
+            output.push_back(',');
+            append_unsigned(output, result.levels.size());
+            output.push_back(',');
+            append_unsigned(output, level.steps);
+            const std::pair<double, double> values[] = {{level.impact_time, level.impact_time_error},
+                {level.impact_velocity, level.impact_velocity_error}, {level.terminal_time, level.terminal_time_error},
+                {level.terminal_velocity, level.terminal_velocity_error}};
+            const FreeFallConvergenceEstimate* estimates[] = {&result.impact_time, &result.impact_velocity, &result.terminal_time,
+                &result.terminal_velocity};
+            for (std::size_t i = 0; i < std::size(values); ++i)
+            {
+                output.push_back(',');
+                append_real(output, values[i].first);
+                output.push_back(',');
+                append_real(output, values[i].second);
+                output.push_back(',');
+                append_real(output, estimates[i]->observed_order);
+                output.push_back(',');
+                append_real(output, estimates[i]->extrapolated);
+            }
+            output.push_back('\n');
+        }
+
+        void append_convergence_json(std::string& output, const FreeFallScenario& scenario, const FreeFallConvergenceResult& result)
+        {
+            const auto level = recommended_level(result);
+            output.append("{\"index\":");
+            append_unsigned(output, scenario.index);
+            output.append(",\"id\":");
+            append_json_text(output, scenario.id);
+            output.append(result.converged ? ",\"converged\":true" : ",\"converged\":false");
+            output.append(result.levels.empty() ? ",\"landed\":false" : ",\"landed\":true");
+            output.append(",\"recommended_time_step\":");
+            if (std::isfinite(level.time_step))
+                append_real(output, level.time_step);
+            else
+                output.append("null");
+            output.append(",\"levels\":");
+            append_unsigned(output, result.levels.size());
+            output.append(",\"steps\":");
+            append_unsigned(output, level.steps);
+            const std::pair<const char*, double> fields[] = {
+                {"impact_time", level.impact_time}, {"impact_time_error", level.impact_time_error},
+                {"impact_time_order", result.impact_time.observed_order}, {"impact_time_extrapolated", result.impact_time.extrapolated},
+                {"impact_velocity", level.impact_velocity}, {"impact_velocity_error", level.impact_velocity_error},
+                {"impact_velocity_order", result.impact_velocity.observed_order}, {"impact_velocity_extrapolated", result.impact_velocity.extrapolated},
+                {"terminal_time", level.terminal_time}, {"terminal_time_error", level.terminal_time_error},
+                {"terminal_time_order", result.terminal_time.observed_order}, {"terminal_time_extrapolated", result.terminal_time.extrapolated},
+                {"terminal_velocity", level.terminal_velocity}, {"terminal_velocity_error", level.terminal_velocity_error},
+                {"terminal_velocity_order", result.terminal_velocity.observed_order}, {"terminal_velocity_extrapolated", result.terminal_velocity.extrapolated}};
+            for (const auto& [name, value] : fields)
+            {
+                output.append(",\"").append(name).append("\":");
+                append_json_real(output, value);
+            }
+            output.append("}\n");
+        }
+
+        std::size_t chunks_in_flight_limit(const FreeFallBatchOptions& options)
+        {
+            const auto worker_count = options.worker_count > 0 ? options.worker_count : std::max(1u, std::thread::hardware_concurrency());
+            return 2 * std::max<std::size_t>(options.queue_capacity, 1) + worker_count + 1;
+        }
+
+    namespace
+    {
+        FreeFallBatchReport run_batch_pipeline(std::string_view text, FreeFallScenarioFormat format, const FreeFallBatchOptions& options,
+            std::ostream& summaries, std::ostream* trajectories, FreeFallMappedFile* scenario_file)
+        {
+            if (options.time_step_study && trajectories)
+                throw std::invalid_argument("run_batch: a time step study writes no trajectories");
+            const auto start = std::chrono::steady_clock::now();
+            const auto worker_count = options.worker_count > 0 ? options.worker_count : std::max(1u, std::thread::hardware_concurrency());
+            const auto chunk_size = std::max<std::size_t>(options.chunk_size, 1);
+            const auto window_limit = chunks_in_flight_limit(options);
+
+            FreeFallBoundedQueue<BatchChunk> parsed{options.queue_capacity};
+            FreeFallBoundedQueue<BatchChunk> simulated{options.queue_capacity};
+            ChunkWindow window{window_limit};
+            std::mutex error_mutex;
+            std::exception_ptr error;
+            auto fail = [&](std::exception_ptr failure)
+            {
+                {
+                    std::lock_guard lock{error_mutex};
+                    if (!error)
+                        error = failure;
+                }
+                window.stop();
+                parsed.close();
+                simulated.close();
+            };
+
+            // the reader parses the header in its constructor, a bad header throws before any thread starts
+            FreeFallScenarioReader reader{text, format, options.defaults};
+            std::thread parser_thread{[&]()
+            {
+                try
+                {
+                    std::uint64_t sequence{0};
+                    bool more{true};
+                    while (more)
+                    {
+                        BatchChunk chunk;
+                        chunk.sequence = sequence;
+                        chunk.scenarios.reserve(chunk_size);
+                        FreeFallScenario scenario;
+                        while (chunk.scenarios.size() < chunk_size && (more = reader.next(scenario)))
+                            chunk.scenarios.push_back(std::move(scenario));
+                        if (chunk.scenarios.empty())
+                            break;
+                        if (!window.acquire() || !parsed.push(std::move(chunk)))
+                            return;
+                        ++sequence;
+                        if (scenario_file)
+                            scenario_file->release_before(reader.offset());
+                    }
+                    parsed.close();
+                }
+                catch (...)
+                {
+                    fail(std::current_exception());
+                }
+            }};
+
+            std::atomic<std::size_t> running_workers{worker_count};
+            std::vector<std::thread> worker_threads;
+            worker_threads.reserve(worker_count);
+            for (std::size_t worker = 0; worker < worker_count; ++worker)
+            {
+                worker_threads.emplace_back([&]()
+                {
+                    try
+                    {
+                        while (auto chunk = parsed.pop())
+                        {
+                            for (const auto& scenario : chunk->scenarios)
+                            {
+                                if (options.time_step_study)
+                                {
+                                    // a level which does not reach the ground ends the study of this scenario only,
+                                    // it gets a row without levels, landed 0
+                                    FreeFallConvergenceResult result;
+                                    try
+                                    {
+                                        result = run_convergence_study(scenario.gravity_profile, scenario.sim_obj_profile,
+                                            scenario.sim_freefall_vars, options.convergence);
+                                    }
+                                    catch (const std::runtime_error&)
+                                    {
+                                    }
+                                    chunk->landed += result.levels.empty() ? 0 : 1;
+                                    if (options.json_summaries)
+                                        append_convergence_json(chunk->summaries, scenario, result);
+                                    else
+                                        append_convergence_csv(chunk->summaries, scenario, result);
+                                    continue;
+                                }
+                                FreeFallScenarioSummary summary;
+                                if (trajectories)
+                                {
+                                    CsvTrajectorySink trajectory_sink{chunk->trajectories, scenario.index};
+                                    summary = simulate_scenario(scenario, &trajectory_sink);
+                                    chunk->trajectory_samples += summary.samples;
+                                }
+                                else
+                                {
+                                    summary = simulate_scenario(scenario);
+                                }
+                                chunk->landed += summary.landed ? 1 : 0;
+                                if (options.json_summaries)
+                                    append_summary_json(chunk->summaries, summary);
+                                else
+                                    append_summary_csv(chunk->summaries, summary);
+                            }
+                            // the scenarios are done with, only the text travels on
+                            chunk->scenario_count = chunk->scenarios.size();
+                            chunk->scenarios = {};
+                            if (!simulated.push(std::move(*chunk)))
+                                break;
+                        }
+                    }
+                    catch (...)
+                    {
+                        fail(std::current_exception());
+                    }
+                    if (--running_workers == 0)
+                        simulated.close();
+                });
+            }
+
+            // Writer on the calling thread, chunks finishing out of order wait in a slot of their
+            // sequence modulo the window, at most window_limit of them exist at a time
+            FreeFallBatchReport report;
+            std::vector<std::optional<BatchChunk>> pending(window_limit);
+            std::uint64_t next_sequence{0};
+            if (!options.json_summaries)
+                summaries << (options.time_step_study ? kConvergenceCsvHeader : kScenarioSummaryCsvHeader);
+            if (trajectories)
+                *trajectories << kTrajectoryCsvHeader;
+            try
+            {
+                while (auto chunk = simulated.pop())
+                {
+                    pending[chunk->sequence % window_limit] = std::move(*chunk);
+                    while (auto& slot = pending[next_sequence % window_limit])
+                    {
+                        if (slot->sequence != next_sequence)
+                            break;
+                        summaries.write(slot->summaries.data(), static_cast<std::streamsize>(slot->summaries.size()));
+                        if (trajectories)
+                            trajectories->write(slot->trajectories.data(), static_cast<std::streamsize>(slot->trajectories.size()));
+                        if (!summaries || (trajectories && !*trajectories))
+                            throw std::runtime_error("run_batch: writing the output failed");
+                        report.scenarios += slot->scenario_count;
+                        report.landed += slot->landed;
+                        report.trajectory_samples += slot->trajectory_samples;
+                        slot.reset();
+                        ++next_sequence;
+                        window.release();
+                    }
+                }
+            }
+            catch (...)
+            {
+                fail(std::current_exception());
+            }
+
+            parser_thread.join();
+            for (auto& worker_thread : worker_threads)
+                worker_thread.join();
+            if (error)
+                std::rethrow_exception(error);
+
+            report.max_chunks_in_flight = window.max_in_flight();
+            report.wall_time_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (report.wall_time_s > 0.0)
+                report.scenarios_per_second = static_cast<double>(report.scenarios) / report.wall_time_s;
+            return report;
+        }
+    }
+
+        FreeFallBatchReport run_batch(std::string_view text, FreeFallScenarioFormat format, const FreeFallBatchOptions& options,
+            std::ostream& summaries, std::ostream* trajectories)
+        {
+            return run_batch_pipeline(text, format, options, summaries, trajectories, nullptr);
+        }
+
+        FreeFallBatchReport run_batch(const std::string& scenario_path, const FreeFallBatchOptions& options,
+            std::ostream& summaries, std::ostream* trajectories)
+        {
+            FreeFallMappedFile scenario_file{scenario_path};
+            return run_batch_pipeline(scenario_file.text(), scenario_format_from_path(scenario_path), options, summaries, trajectories,
+                &scenario_file);
+        }
+}
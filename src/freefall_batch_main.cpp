@@ -0,0 +1,145 @@
+#include "freefall_batch.h"
+#include "freefall_demo_profiles.h"
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    void print_usage(std::ostream& output)
+    {
+        output << "usage: FreeFallBatch <scenarios.csv|scenarios.jsonl> [options]\n"
+                  "  --summaries <path>     per scenario summaries, default standard output\n"
+                  "  --trajectories <path>  every sample of every scenario as CSV, off by default\n"
+                  "  --json                 summaries as JSON lines instead of CSV\n"
+                  "  --threads <n>          simulation threads, default one per core\n"
+                  "  --chunk <n>            scenarios per pipeline chunk, default 256\n"
+                  "  --queue <n>            chunks per pipeline queue, default 4\n"
+                  "  --time-step-study <rel_tolerance>\n"
+                  "                         instead of the summaries run every scenario at halved time steps and report\n"
+                  "                         the largest time_step whose impact and terminal state errors meet the tolerance\n"
+                  "  --max-levels <n>       time step halvings of the study, default 10\n"
+                  "Scenario fields not given in the file take the demo ball of FreeFallUnderDragForceBall.\n";
+    }
+
+    // The ball of main.cpp, headless
+    FreeFallSim::FreeFallScenario make_default_scenario()
+    {
+        FreeFallSim::FreeFallScenario scenario;
+        scenario.sim_obj_profile = FreeFallSim::make_demo_ball_profile();
+        scenario.sim_freefall_vars = FreeFallSim::make_demo_sim_vars();
+        return scenario;
+    }
+
+    // from_chars takes no sign for unsigned types and no leading blanks, so "-1" fails instead of wrapping,
+    // and every failure names the option
+    double parse_tolerance(const std::string& option, const std::string& value)
+    {
+        double tolerance{0.0};
+        const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), tolerance);
+        if (error != std::errc{} || end != value.data() + value.size() || !(tolerance > 0.0) || !std::isfinite(tolerance))
+            throw std::invalid_argument(option + " expects a positive tolerance, got " + value);
+        return tolerance;
+    }
+
+    std::size_t parse_count(const std::string& option, const std::string& value)
+    {
+        std::size_t count{0};
+        const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), count);
+        if (error != std::errc{} || end != value.data() + value.size() || count == 0)
+            throw std::invalid_argument(option + " expects a positive count, got " + value);
+        return count;
+    }
+
+    // Output file with a 1 MiB buffer, the writer stage hands it whole chunks of text
+    std::unique_ptr<std::ofstream> open_output(const std::string& path, std::vector<char>& buffer)
+    {
+        auto output = std::make_unique<std::ofstream>();
+        buffer.resize(1 << 20);
+        output->rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        output->open(path, std::ios::binary | std::ios::trunc);
+        if (!*output)
+            throw std::runtime_error("can not create " + path);
+        return output;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::ios::sync_with_stdio(false);
+    std::vector<std::string> args(argv + 1, argv + argc);
+    if (args.empty() || args.front() == "--help" || args.front() == "-h")
+    {
+        print_usage(args.empty() ? std::cerr : std::cout);
+        return args.empty() ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    try
+    {
+        const auto scenario_path = args.front();
+        FreeFallSim::FreeFallBatchOptions options;
+        options.defaults = make_default_scenario();
+        std::string summaries_path;
+        std::string trajectories_path;
+        for (std::size_t i = 1; i < args.size(); ++i)
+        {
+            const auto& option = args[i];
+            const bool has_value = i + 1 < args.size();
+            if (option == "--json")
+                options.json_summaries = true;
+            else if (option == "--summaries" && has_value)
+                summaries_path = args[++i];
+            else if (option == "--trajectories" && has_value)
+                trajectories_path = args[++i];
+            else if (option == "--threads" && has_value)
+                options.worker_count = parse_count(option, args[++i]);
+            else if (option == "--chunk" && has_value)
+                options.chunk_size = parse_count(option, args[++i]);
+            else if (option == "--queue" && has_value)
+                options.queue_capacity = parse_count(option, args[++i]);
+            else if (option == "--time-step-study" && has_value)
+            {
+                options.time_step_study = true;
+                options.convergence.rel_tolerance = parse_tolerance(option, args[++i]);
+            }
+            else if (option == "--max-levels" && has_value)
+                options.convergence.max_levels = parse_count(option, args[++i]);
+            else
+                throw std::invalid_argument("unknown or incomplete option " + option);
+        }
+
+        std::vector<char> summaries_buffer;
+        std::vector<char> trajectories_buffer;
+        std::unique_ptr<std::ofstream> summaries_file;
+        std::unique_ptr<std::ofstream> trajectories_file;
+        if (!summaries_path.empty())
+            summaries_file = open_output(summaries_path, summaries_buffer);
+        if (!trajectories_path.empty())
+            trajectories_file = open_output(trajectories_path, trajectories_buffer);
+        std::ostream& summaries = summaries_file ? *summaries_file : std::cout;
+
+        const auto report = FreeFallSim::run_batch(scenario_path, options, summaries, trajectories_file.get());
+        summaries.flush();
+        if (trajectories_file)
+            trajectories_file->flush();
+        if (!summaries || (trajectories_file && !*trajectories_file))
+            throw std::runtime_error("writing the output failed");
+
+        std::cerr << report.scenarios << " scenarios, " << report.landed << " landed, "
+                  << report.trajectory_samples << " trajectory samples in " << report.wall_time_s << " s ("
+                  << report.scenarios_per_second << " scenarios/s, at most " << report.max_chunks_in_flight
+                  << " chunks in flight)\n";
+    }
+    catch (const std::exception& error)
+    {
+        std::cerr << "FreeFallBatch: " << error.what() << "\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,206 @@
+#include "freefall_convergence_study.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include "freefall_trajectory_sink.h"
+
+namespace FreeFallSim
+{
+    namespace
+    {
+        // Impact from the stats, terminal state from the first NetForceZero event
+        class ConvergenceSink : public FreeFallStatsSink
+        {
+            public:
+            void event(const FreeFallEvent& event) override
+            {
+                if (event.kind == FreeFallEventKind::NetForceZero && !m_terminal)
+                    m_terminal = event;
+            }
+
+            const std::optional<FreeFallEvent>& terminal() const { return m_terminal; }
+
+            private:
+            std::optional<FreeFallEvent> m_terminal;
+        };
+
+        template <typename Simulation>
+        FreeFallIntegratorStats run_level(const FreeFallObjProfile& sim_obj_profile, const FreeFallSimulationProfile& sim_vars,
+            FreeFallStatsSink& stats_sink)
+        {
+            Simulation sim{sim_obj_profile, sim_vars, FreeFallSimPlot{}};
+            return sim.run_sim(stats_sink);
+        }
+
+        FreeFallConvergenceLevel run_level(GravityProfile gravity_profile, const FreeFallObjProfile& sim_obj_profile,
+            FreeFallSimulationProfile sim_vars, float time_step, double net_force_epsilon)
+        {
+            // the samples are only needed for the impact, the terminal state is located inside the steps
+            sim_vars.sampling = SamplingProfile::TimeInterval;
+            sim_vars.sample_interval = sim_vars.time_step;
+            sim_vars.console_output = false;
+            sim_vars.time_step = time_step;
+            sim_vars.net_force_epsilon = net_force_epsilon;
+
+            ConvergenceSink stats_sink;
+            const auto integrator_stats = gravity_profile == GravityProfile::NewtonGravitationModel ?
+                run_level<FreeFallNewtonGravitySimlation>(sim_obj_profile, sim_vars, stats_sink) :
+                run_level<FreeFallConstGravitySimlation>(sim_obj_profile, sim_vars, stats_sink);
+            if (stats_sink.sample_count() == 0 || stats_sink.last_position() > 0.0)
+            {
+                throw std::runtime_error("convergence study: the run with time_step " + std::to_string(time_step) +
+                    " did not reach the ground before finish_time");
+            }
+
+            FreeFallConvergenceLevel level;
+            level.time_step = time_step;
+            level.steps = integrator_stats.steps_taken;
+            level.wall_time_s = integrator_stats.wall_time_s;
+            level.impact_time = stats_sink.last_time();
+            level.impact_velocity = -stats_sink.last_velocity();
+            if (stats_sink.terminal())
+            {
+                level.terminal_time = stats_sink.terminal()->time;
+                level.terminal_velocity = -stats_sink.terminal()->velocity;
+            }
+            return level;
+        }
+
+        // The quantities of a level, read and written through the same member pointers
+        struct ConvergenceQuantity
+        {
+            double FreeFallConvergenceLevel::* value;
+            double FreeFallConvergenceLevel::* error;
+            FreeFallConvergenceEstimate FreeFallConvergenceResult::* estimate;
+            bool terminal;                  // only judged when every level reached the terminal state
+        };
+
+        constexpr std::array<ConvergenceQuantity, 4> kConvergenceQuantities{{
+            {&FreeFallConvergenceLevel::impact_time, &FreeFallConvergenceLevel::impact_time_error, &FreeFallConvergenceResult::impact_time, false},
+            {&FreeFallConvergenceLevel::impact_velocity, &FreeFallConvergenceLevel::impact_velocity_error, &FreeFallConvergenceResult::impact_velocity, false},
+            {&FreeFallConvergenceLevel::terminal_time, &FreeFallConvergenceLevel::terminal_time_error, &FreeFallConvergenceResult::terminal_time, true},
+            {&FreeFallConvergenceLevel::terminal_velocity, &FreeFallConvergenceLevel::terminal_velocity_error, &FreeFallConvergenceResult::terminal_velocity, true},
+        }};
+
+        bool judged(const ConvergenceQuantity& quantity, const FreeFallConvergenceResult& result)
+        {
+            return !quantity.terminal || result.terminal_reached;
+        }
+
+        double tolerance_of(const FreeFallConvergenceProfile& convergence, double value)
+        {
+            return convergence.abs_tolerance + convergence.rel_tolerance * std::abs(value);
+        }
+
+        // Estimates and level errors from the levels run so far, true when the tolerance can be judged:
+        // every quantity converges at an observed order or its last two differences are within the tolerance
+        bool estimate_errors(FreeFallConvergenceResult& result, const FreeFallConvergenceProfile& convergence)
+        {
+            auto& levels = result.levels;
+            const auto finest = levels.size() - 1;
+            bool settled{true};
+            for (const auto& quantity : kConvergenceQuantities)
+            {
+                if (!judged(quantity, result))
+                {
+                    result.*quantity.estimate = FreeFallConvergenceEstimate{};
+                    for (auto& level : levels)
+                        level.*quantity.error = std::numeric_limits<double>::quiet_NaN();
+                    continue;
+                }
+                const auto coarse = levels[finest - 2].*quantity.value;
+                const auto medium = levels[finest - 1].*quantity.value;
+                const auto fine = levels[finest].*quantity.value;
+                auto& estimate = result.*quantity.estimate;
+                estimate.observed_order = observed_order(coarse, medium, fine);
+                estimate.extrapolated = richardson_extrapolate(medium, fine, estimate.observed_order);
+                for (auto& level : levels)
+                    level.*quantity.error = std::abs(level.*quantity.value - estimate.extrapolated);
+
+                if (std::isnan(estimate.observed_order))
+                {
+                    // outside the asymptotic range the finest level is as good as its distance to the one before
+                    levels[finest].*quantity.error = std::abs(fine - medium);
+                    const auto tolerance = tolerance_of(convergence, fine);
+                    settled = settled && std::abs(medium - coarse) <= tolerance && std::abs(fine - medium) <= tolerance;
+                }
+            }
+            return settled;
+        }
+    }
+
+        double observed_order(double coarse, double medium, double fine)
+        {
+            const auto coarse_difference = std::abs(coarse - medium);
+            const auto fine_difference = std::abs(medium - fine);
+            if (fine_difference == 0.0)
+                return coarse_difference == 0.0 ? std::numeric_limits<double>::quiet_NaN() : std::numeric_limits<double>::infinity();
+            if (!(coarse_difference > fine_difference) || !std::isfinite(coarse_difference))
+                return std::numeric_limits<double>::quiet_NaN();
+            return std::log2(coarse_difference / fine_difference);
+        }
+
+        double richardson_extrapolate(double medium, double fine, double order)
+        {
+            if (!std::isfinite(order) || order <= 0.0)
+                return fine;
+            return fine + (fine - medium) / (std::exp2(order) - 1.0);
+        }
+
+        FreeFallConvergenceResult run_convergence_study(GravityProfile gravity_profile, const FreeFallObjProfile& sim_obj_profile,
+            const FreeFallSimulationProfile& sim_freefall_vars, const FreeFallConvergenceProfile& convergence)
+        {
+            if (!(sim_freefall_vars.time_step > 0.0f))
+                throw std::invalid_argument("convergence study: time_step must be positive");
+            if (convergence.min_levels < 3 || convergence.min_levels > convergence.max_levels)
+                throw std::invalid_argument("convergence study: min_levels must lie in [3, max_levels]");
+
+            FreeFallConvergenceResult result;
+            result.levels.reserve(convergence.max_levels);
+            auto time_step = sim_freefall_vars.time_step;
+            while (result.levels.size() < convergence.max_levels)
+            {
+                result.levels.push_back(run_level(gravity_profile, sim_obj_profile, sim_freefall_vars, time_step,
+                    convergence.net_force_epsilon));
+                time_step *= 0.5f;
+                result.terminal_reached = std::all_of(result.levels.begin(), result.levels.end(),
+                    [](const FreeFallConvergenceLevel& level) { return !std::isnan(level.terminal_time); });
+                if (result.levels.size() < convergence.min_levels)
+                    continue;
+
+                const bool settled = estimate_errors(result, convergence);
+                for (auto& level : result.levels)
+                {
+                    level.meets_tolerance = settled && std::all_of(kConvergenceQuantities.begin(), kConvergenceQuantities.end(),
+                        [&](const ConvergenceQuantity& quantity)
+                        {
+                            return !judged(quantity, result) ||
+                                level.*quantity.error <= tolerance_of(convergence, (result.*quantity.estimate).extrapolated);
+                        });
+                }
+                if (settled && std::any_of(result.levels.begin(), result.levels.end(),
+                    [](const FreeFallConvergenceLevel& level) { return level.meets_tolerance; }))
+                {
+                    result.converged = true;
+                    break;
+                }
+            }
+
+            // fewest steps wins, the larger step on a tie, adaptive integrators need not get dearer with a smaller first step
+            result.recommended_level = result.levels.size() - 1;
+            if (result.converged)
+            {
+                for (std::size_t i = result.levels.size(); i-- > 0;)
+                {
+                    if (result.levels[i].meets_tolerance && (!result.levels[result.recommended_level].meets_tolerance ||
+                        result.levels[i].steps <= result.levels[result.recommended_level].steps))
+                        result.recommended_level = i;
+                }
+            }
+            result.recommended_time_step = result.levels[result.recommended_level].time_step;
+            return result;
+        }
+}
@@ -0,0 +1,76 @@
+#include "freefall_downsampling.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace FreeFallSim
+{
+        std::vector<std::size_t> lttb_indices(const std::vector<double>& x, const std::vector<double>& y, std::size_t threshold)
+        {
+            const auto size = std::min(x.size(), y.size());
+            std::vector<std::size_t> indices;
+            if (threshold == 0 || threshold >= size || size < 3)
+            {
+                indices.resize(size);
+                std::iota(indices.begin(), indices.end(), std::size_t{0});
+                return indices;
+            }
+            // first and last point are always kept, fewer than 3 points leaves no bucket in between
+            threshold = std::max<std::size_t>(threshold, 3);
+            indices.reserve(threshold);
+            indices.push_back(0);
+
+            const auto bucket_width = static_cast<double>(size - 2) / static_cast<double>(threshold - 2);
+            std::size_t kept = 0;
+            for (std::size_t bucket = 0; bucket < threshold - 2; ++bucket)
+            {
+                const auto begin = static_cast<std::size_t>(std::floor(bucket * bucket_width)) + 1;
+                const auto end = std::min(static_cast<std::size_t>(std::floor((bucket + 1) * bucket_width)) + 1, size - 1);
+
+                // average of the next bucket, the last point for the final bucket
+                const auto next_begin = end;
+                const auto next_end = std::min(static_cast<std::size_t>(std::floor((bucket + 2) * bucket_width)) + 1, size);
+                double average_x{0.0};
+                double average_y{0.0};
+                for (auto i = next_begin; i < next_end; ++i)
+                {
+                    average_x += x[i];
+                    average_y += y[i];
+                }
+                const auto next_count = static_cast<double>(std::max<std::size_t>(next_end - next_begin, 1));
+                average_x /= next_count;
+                average_y /= next_count;
+
+                // twice the triangle area, the constant factor does not change the maximum
+                double largest_area{-1.0};
+                auto selected = begin;
+                for (auto i = begin; i < end; ++i)
+                {
+                    const auto area = std::abs((x[kept] - average_x) * (y[i] - y[kept]) - (x[kept] - x[i]) * (average_y - y[kept]));
+                    if (area > largest_area)
+                    {
+                        largest_area = area;
+                        selected = i;
+                    }
+                }
+                indices.push_back(selected);
+                kept = selected;
+            }
+            indices.push_back(size - 1);
+            return indices;
+        }
+
+        FreeFallDownsampled lttb_downsample(const std::vector<double>& x, const std::vector<double>& y, std::size_t threshold)
+        {
+            FreeFallDownsampled reduced;
+            const auto indices = lttb_indices(x, y, threshold);
+            reduced.x.reserve(indices.size());
+            reduced.y.reserve(indices.size());
+            for (const auto index : indices)
+            {
+                reduced.x.emplace_back(x[index]);
+                reduced.y.emplace_back(y[index]);
+            }
+            return reduced;
+        }
+}
@@ -0,0 +1,484 @@
+
+#include "freefall_ensemble_simulation.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include "freefall_demo_profiles.h"
+
+namespace FreeFallSim
+{
+    namespace
+    {
+        // Thin wrappers so one kernel body serves every instruction set
+
+        template <typename T>
+        struct ScalarOps
+        {
+            using scalar = T;
+            using vec = T;
+            using mask = bool;
+            static constexpr int width = 1;
+            static vec load(const scalar* src) { return *src; }
+            static void store(scalar* dst, vec value) { *dst = value; }
+            static vec set1(scalar value) { return value; }
+            static vec add(vec a, vec b) { return a + b; }
+            static vec sub(vec a, vec b) { return a - b; }
+            static vec mul(vec a, vec b) { return a * b; }
+            static vec div(vec a, vec b) { return a / b; }
+            static mask cmp_ge(vec a, vec b) { return a >= b; }
+            static mask cmp_lt(vec a, vec b) { return a < b; }
+            static mask mask_and(mask a, mask b) { return a && b; }
+            static vec blend(vec if_clear, vec if_set, mask m) { return m ? if_set : if_clear; }
+            static int bits(mask m) { return m ? 1 : 0; }
+        };
+
+        #if defined(__AVX2__)
+        struct Avx2DoubleOps
+        {
+            using scalar = double;
+            using vec = __m256d;
+            using mask = __m256d;
+            static constexpr int width = 4;
+            static vec load(const scalar* src) { return _mm256_load_pd(src); }
+            static void store(scalar* dst, vec value) { _mm256_store_pd(dst, value); }
+            static vec set1(scalar value) { return _mm256_set1_pd(value); }
+            static vec add(vec a, vec b) { return _mm256_add_pd(a, b); }
+            static vec sub(vec a, vec b) { return _mm256_sub_pd(a, b); }
+            static vec mul(vec a, vec b) { return _mm256_mul_pd(a, b); }
+            static vec div(vec a, vec b) { return _mm256_div_pd(a, b); }
+            static mask cmp_ge(vec a, vec b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+            static mask cmp_lt(vec a, vec b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+            static mask mask_and(mask a, mask b) { return _mm256_and_pd(a, b); }
+            static vec blend(vec if_clear, vec if_set, mask m) { return _mm256_blendv_pd(if_clear, if_set, m); }
+            static int bits(mask m) { return _mm256_movemask_pd(m); }
+        };
+
+        struct Avx2FloatOps
+        {
+            using scalar = float;
+            using vec = __m256;
+            using mask = __m256;
+            static constexpr int width = 8;
+            static vec load(const scalar* src) { return _mm256_load_ps(src); }
+            static void store(scalar* dst, vec value) { _mm256_store_ps(dst, value); }
+            static vec set1(scalar value) { return _mm256_set1_ps(value); }
+            static vec add(vec a, vec b) { return _mm256_add_ps(a, b); }
+            static vec sub(vec a, vec b) { return _mm256_sub_ps(a, b); }
+            static vec mul(vec a, vec b) { return _mm256_mul_ps(a, b); }
+            static vec div(vec a, vec b) { return _mm256_div_ps(a, b); }
+            static mask cmp_ge(vec a, vec b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+            static mask cmp_lt(vec a, vec b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+            static mask mask_and(mask a, mask b) { return _mm256_and_ps(a, b); }
+            static vec blend(vec if_clear, vec if_set, mask m) { return _mm256_blendv_ps(if_clear, if_set, m); }
+            static int bits(mask m) { return _mm256_movemask_ps(m); }
+        };
+        #endif
+
+        #if defined(__AVX512F__)
+        struct Avx512DoubleOps
+        {
+            using scalar = double;
+            using vec = __m512d;
+            using mask = __mmask8;
+            static constexpr int width = 8;
+            static vec load(const scalar* src) { return _mm512_load_pd(src); }
+            static void store(scalar* dst, vec value) { _mm512_store_pd(dst, value); }
+            static vec set1(scalar value) { return _mm512_set1_pd(value); }
+            static vec add(vec a, vec b) { return _mm512_add_pd(a, b); }
+            static vec sub(vec a, vec b) { return _mm512_sub_pd(a, b); }
+            static vec mul(vec a, vec b) { return _mm512_mul_pd(a, b); }
+            static vec div(vec a, vec b) { return _mm512_div_pd(a, b); }
+            static mask cmp_ge(vec a, vec b) { return _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ); }
+            static mask cmp_lt(vec a, vec b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+            static mask mask_and(mask a, mask b) { return static_cast<mask>(a & b); }
+            static vec blend(vec if_clear, vec if_set, mask m) { return _mm512_mask_blend_pd(m, if_clear, if_set); }
+            static int bits(mask m) { return static_cast<int>(m); }
+        };
+
+        struct Avx512FloatOps
+        {
+            using scalar = float;
+            using vec = __m512;
+            using mask = __mmask16;
+            static constexpr int width = 16;
+            static vec load(const scalar* src) { return _mm512_load_ps(src); }
+            static void store(scalar* dst, vec value) { _mm512_store_ps(dst, value); }
+            static vec set1(scalar value) { return _mm512_set1_ps(value); }
+            static vec add(vec a, vec b) { return _mm512_add_ps(a, b); }
+            static vec sub(vec a, vec b) { return _mm512_sub_ps(a, b); }
+            static vec mul(vec a, vec b) { return _mm512_mul_ps(a, b); }
+            static vec div(vec a, vec b) { return _mm512_div_ps(a, b); }
+            static mask cmp_ge(vec a, vec b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+            static mask cmp_lt(vec a, vec b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+            static mask mask_and(mask a, mask b) { return static_cast<mask>(a & b); }
+            static vec blend(vec if_clear, vec if_set, mask m) { return _mm512_mask_blend_ps(m, if_clear, if_set); }
+            static int bits(mask m) { return static_cast<int>(m); }
+        };
+        using NativeDoubleOps = Avx512DoubleOps;
+        using NativeFloatOps = Avx512FloatOps;
+        #elif defined(__AVX2__)
+        using NativeDoubleOps = Avx2DoubleOps;
+        using NativeFloatOps = Avx2FloatOps;
+        #else
+        using NativeDoubleOps = ScalarOps<double>;
+        using NativeFloatOps = ScalarOps<float>;
+        #endif
+
+        template <typename Scalar>
+        using NativeOps = std::conditional_t<std::is_same_v<Scalar, float>, NativeFloatOps, NativeDoubleOps>;
+
+        template <typename Scalar>
+        struct EnsembleLanes
+        {
+            const Scalar* position;
+            const Scalar* velocity;
+            const Scalar* drag_coeff;
+            const Scalar* gravity_coeff;
+            const Scalar* planet_radius;
+            const Scalar* time_step;
+            const Scalar* max_steps;
+            std::size_t count;
+        };
+
+        // Advances all objects with the run_sim() update
+        //   a  = g(x) - k*v^2
+        //   v' = v + a*dt
+        //   x' = x - v*dt - 0.5*a*dt^2
+        // until x < 0. Each register lane owns one object, a lane whose object finished is
+        // written back and refilled from the pending queue, empty lanes stay masked off.
+        // kCompensated sums position and velocity with Kahan's compensation, for the position
+        //   y = -(v*dt + 0.5*a*dt^2) - c,   x' = x + y,   c' = (x' - x) - y
+        // c holds the part of the last decrement the rounded x' could not take. Without it a float
+        // velocity near terminal stalls once a*dt drops below half its spacing.
+        template <typename Ops, bool kNewtonGravity, bool kCompensated>
+        void advance_ensemble(const EnsembleLanes<typename Ops::scalar>& lanes, FreeFallEnsembleResult& result)
+        {
+            using Scalar = typename Ops::scalar;
+            constexpr int W = Ops::width;
+            constexpr std::size_t kEmptySlot = static_cast<std::size_t>(-1);
+
+            alignas(64) Scalar position[W], velocity[W], drag_coeff[W], gravity_coeff[W], position_carry[W], velocity_carry[W];
+            alignas(64) Scalar planet_radius[W], time_step[W], half_time_step_sq[W], max_steps[W], steps[W];
+            std::size_t slot_object[W];
+            std::size_t next_object{0};
+            int occupied_bits{0};
+
+            auto retire = [&](int lane)
+            {
+                const auto object = slot_object[lane];
+                result.impact_time[object] = static_cast<double>(steps[lane]) * static_cast<double>(time_step[lane]);
+                result.impact_height[object] = position[lane];
+                result.impact_velocity[object] = velocity[lane];
+                result.steps[object] = static_cast<std::uint64_t>(steps[lane]);
+                slot_object[lane] = kEmptySlot;
+            };
+
+            // Loads pending objects into the free lanes, objects that start finished are
+            // retired immediately. Updates occupied_bits with the lanes holding a running object.
+            auto refill = [&]()
+            {
+                occupied_bits = 0;
+                for (int lane = 0; lane < W; ++lane)
+                {
+                    while (slot_object[lane] == kEmptySlot && next_object < lanes.count)
+                    {
+                        const auto object = next_object++;
+                        slot_object[lane] = object;
+                        position[lane] = lanes.position[object];
+                        velocity[lane] = lanes.velocity[object];
+                        position_carry[lane] = 0;
+                        velocity_carry[lane] = 0;
+                        drag_coeff[lane] = lanes.drag_coeff[object];
+                        gravity_coeff[lane] = lanes.gravity_coeff[object];
+                        planet_radius[lane] = lanes.planet_radius[object];
+                        time_step[lane] = lanes.time_step[object];
+                        half_time_step_sq[lane] = Scalar{0.5} * time_step[lane] * time_step[lane];
+                        max_steps[lane] = lanes.max_steps[object];
+                        steps[lane] = 0;
+                        if (!(position[lane] >= 0 && steps[lane] < max_steps[lane]))
+                            retire(lane);
+                    }
+                    if (slot_object[lane] == kEmptySlot)
+                    {
+                        // masked off lane, negative height keeps it inactive
+                        position[lane] = -1;
+                        velocity[lane] = 0;
+                        position_carry[lane] = 0;
+                        velocity_carry[lane] = 0;
+                        drag_coeff[lane] = 0;
+                        gravity_coeff[lane] = 0;
+                        planet_radius[lane] = 1;
+                        time_step[lane] = 0;
+                        half_time_step_sq[lane] = 0;
+                        max_steps[lane] = 0;
+                        steps[lane] = 0;
+                    }
+                    else
+                    {
+                        occupied_bits |= 1 << lane;
+                    }
+                }
+                return occupied_bits;
+            };
+
+            for (int lane = 0; lane < W; ++lane)
+                slot_object[lane] = kEmptySlot;
+            if (refill() == 0)
+                return;
+
+            const auto zero = Ops::set1(0);
+            const auto one = Ops::set1(1);
+            auto x = Ops::load(position);
+            auto v = Ops::load(velocity);
+            auto cx = Ops::load(position_carry);
+            auto cv = Ops::load(velocity_carry);
+            auto k = Ops::load(drag_coeff);
+            auto gc = Ops::load(gravity_coeff);
+            auto radius = Ops::load(planet_radius);
+            auto dt = Ops::load(time_step);
+            auto half_dt_sq = Ops::load(half_time_step_sq);
+            auto limit = Ops::load(max_steps);
+            auto n = Ops::load(steps);
+
+            while (true)
+            {
+                auto active = Ops::mask_and(Ops::cmp_ge(x, zero), Ops::cmp_lt(n, limit));
+                if (Ops::bits(active) != occupied_bits)
+                {
+                    Ops::store(position, x);
+                    Ops::store(velocity, v);
+                    Ops::store(position_carry, cx);
+                    Ops::store(velocity_carry, cv);
+                    Ops::store(steps, n);
+                    const int active_bits = Ops::bits(active);
+                    for (int lane = 0; lane < W; ++lane)
+                    {
+                        if (slot_object[lane] != kEmptySlot && !(active_bits & (1 << lane)))
+                            retire(lane);
+                    }
+                    if (refill() == 0)
+                        break;
+                    x = Ops::load(position);
+                    v = Ops::load(velocity);
+                    cx = Ops::load(position_carry);
+                    cv = Ops::load(velocity_carry);
+                    k = Ops::load(drag_coeff);
+                    gc = Ops::load(gravity_coeff);
+                    radius = Ops::load(planet_radius);
+                    dt = Ops::load(time_step);
+                    half_dt_sq = Ops::load(half_time_step_sq);
+                    limit = Ops::load(max_steps);
+                    n = Ops::load(steps);
+                    active = Ops::mask_and(Ops::cmp_ge(x, zero), Ops::cmp_lt(n, limit));
+                }
+
+                auto gravity = gc;
+                if constexpr (kNewtonGravity)
+                {
+                    const auto distance = Ops::add(radius, x);
+                    gravity = Ops::div(gc, Ops::mul(distance, distance));
+                }
+                const auto acceleration = Ops::sub(gravity, Ops::mul(k, Ops::mul(v, v)));
+                if constexpr (kCompensated)
+                {
+                    const auto decrement = Ops::add(Ops::mul(v, dt), Ops::mul(acceleration, half_dt_sq));
+                    const auto y_x = Ops::sub(Ops::sub(zero, decrement), cx);
+                    const auto new_position = Ops::add(x, y_x);
+                    const auto y_v = Ops::sub(Ops::mul(acceleration, dt), cv);
+                    const auto new_velocity = Ops::add(v, y_v);
+                    cx = Ops::blend(cx, Ops::sub(Ops::sub(new_position, x), y_x), active);
+                    cv = Ops::blend(cv, Ops::sub(Ops::sub(new_velocity, v), y_v), active);
+                    x = Ops::blend(x, new_position, active);
+                    v = Ops::blend(v, new_velocity, active);
+                }
+                else
+                {
+                    const auto new_velocity = Ops::add(v, Ops::mul(acceleration, dt));
+                    const auto new_position = Ops::sub(Ops::sub(x, Ops::mul(v, dt)), Ops::mul(acceleration, half_dt_sq));
+                    x = Ops::blend(x, new_position, active);
+                    v = Ops::blend(v, new_velocity, active);
+                }
+                n = Ops::blend(n, Ops::add(n, one), active);
+            }
+        }
+
+        template <typename Ops, bool kNewtonGravity>
+        void advance_ensemble(const EnsembleLanes<typename Ops::scalar>& lanes, bool compensated, FreeFallEnsembleResult& result)
+        {
+            if (compensated)
+                advance_ensemble<Ops, kNewtonGravity, true>(lanes, result);
+            else
+                advance_ensemble<Ops, kNewtonGravity, false>(lanes, result);
+        }
+
+        double relative_error(double value, double reference)
+        {
+            if (reference == 0.0)
+                return std::abs(value);
+            return std::abs(value - reference) / std::abs(reference);
+        }
+    }
+
+        template <typename Scalar>
+        void FreeFallBasicEnsembleSimulation<Scalar>::reserve(std::size_t count)
+        {
+            m_position.reserve(count);
+            m_velocity.reserve(count);
+            m_drag_coeff.reserve(count);
+            m_gravity_coeff.reserve(count);
+            m_planet_radius.reserve(count);
+            m_time_step.reserve(count);
+            m_max_steps.reserve(count);
+        }
+
+        template <typename Scalar>
+        void FreeFallBasicEnsembleSimulation<Scalar>::add_object(const FreeFallObjProfile& sim_obj_profile, const FreeFallSimulationProfile& sim_freefall_vars)
+        {
+            // Derive the per object coefficients from the force lambdas once, the kernel
+            // then only needs accelerations: a = gravity_coeff(/(R+x)^2) - drag_coeff*v^2
+            auto unit_state = sim_freefall_vars;
+            unit_state.velocity = 1.0;
+            unit_state.position = 0.0;
+            const auto mass = sim_obj_profile.mass_of_object;
+            const auto radius_of_planet = sim_freefall_vars.kRadiusOfPlanet;
+
+            // the step counter has to stay exact, for float that ends at 2^24
+            const auto step_count_limit = std::ldexp(1.0, std::numeric_limits<Scalar>::digits);
+
+            m_position.emplace_back(static_cast<Scalar>(sim_freefall_vars.position));
+            m_velocity.emplace_back(static_cast<Scalar>(sim_freefall_vars.velocity));
+            m_drag_coeff.emplace_back(static_cast<Scalar>(drag_force(sim_obj_profile, unit_state) / mass));
+            if (m_gravity_profile == GravityProfile::NewtonGravitationModel)
+                m_gravity_coeff.emplace_back(static_cast<Scalar>(newton_gravitational_force(sim_obj_profile, unit_state) * radius_of_planet * radius_of_planet / mass));
+            else
+                m_gravity_coeff.emplace_back(static_cast<Scalar>(const_weight_force(sim_obj_profile, unit_state) / mass));
+            m_planet_radius.emplace_back(static_cast<Scalar>(radius_of_planet));
+            const double time_step = sim_freefall_vars.time_step;
+            m_time_step.emplace_back(static_cast<Scalar>(time_step));
+            m_max_steps.emplace_back(static_cast<Scalar>(std::min(std::floor(sim_freefall_vars.finish_time / time_step), step_count_limit)));
+        }
+
+        template <typename Scalar>
+        FreeFallEnsembleResult FreeFallBasicEnsembleSimulation<Scalar>::run_sim() const
+        {
+            FreeFallEnsembleResult result;
+            const auto count = size();
+            result.impact_time.resize(count);
+            result.impact_height.resize(count);
+            result.impact_velocity.resize(count);
+            result.steps.resize(count);
+
+            const EnsembleLanes<Scalar> lanes{m_position.data(), m_velocity.data(), m_drag_coeff.data(), m_gravity_coeff.data(),
+                m_planet_radius.data(), m_time_step.data(), m_max_steps.data(), count};
+
+            const auto start = std::chrono::steady_clock::now();
+            if (m_gravity_profile == GravityProfile::NewtonGravitationModel)
+                advance_ensemble<NativeOps<Scalar>, true>(lanes, m_compensated, result);
+            else
+                advance_ensemble<NativeOps<Scalar>, false>(lanes, m_compensated, result);
+            const auto stop = std::chrono::steady_clock::now();
+
+            for (const auto steps : result.steps)
+                result.total_object_steps += steps;
+            result.wall_time_s = std::chrono::duration<double>(stop - start).count();
+            if (result.wall_time_s > 0.0)
+                result.object_steps_per_second = static_cast<double>(result.total_object_steps) / result.wall_time_s;
+            return result;
+        }
+
+        template <typename Scalar>
+        const char* FreeFallBasicEnsembleSimulation<Scalar>::simd_backend()
+        {
+            #if defined(__AVX512F__)
+            return "avx512";
+            #elif defined(__AVX2__)
+            return "avx2";
+            #else
+            return "scalar";
+            #endif
+        }
+
+        template <typename Scalar>
+        int FreeFallBasicEnsembleSimulation<Scalar>::simd_lanes()
+        {
+            return NativeOps<Scalar>::width;
+        }
+
+        template class FreeFallBasicEnsembleSimulation<double>;
+        template class FreeFallBasicEnsembleSimulation<float>;
+
+        FreeFallEnsembleProfiles standard_precision_profiles()
+        {
+            auto ball = make_demo_ball_profile();
+            auto vars = make_demo_sim_vars();
+            vars.sample_factor = 1;
+            vars.locate_impact = false;
+
+            FreeFallEnsembleProfiles profiles;
+            for (const auto mass : {0.0577, 0.577})
+            {
+                ball.mass_of_object = mass;
+                for (const float time_step : {0.01f, 0.001f})
+                {
+                    vars.time_step = time_step;
+                    for (const auto height : {10.0, 100.0, 400.0, 1000.0, 3000.0, 10000.0})
+                    {
+                        vars.position = height;
+                        profiles.emplace_back(ball, vars);
+                    }
+                }
+            }
+            return profiles;
+        }
+
+        FreeFallPrecisionError measure_float_ensemble_error(GravityProfile gravity_profile, const FreeFallEnsembleProfiles& profiles,
+            bool compensated)
+        {
+            FreeFallEnsembleSimulation reference_ensemble{gravity_profile};
+            FreeFallFloatEnsembleSimulation float_ensemble{gravity_profile, compensated};
+            reference_ensemble.reserve(profiles.size());
+            float_ensemble.reserve(profiles.size());
+            for (const auto& [obj, vars] : profiles)
+            {
+                reference_ensemble.add_object(obj, vars);
+                float_ensemble.add_object(obj, vars);
+            }
+            const auto reference = reference_ensemble.run_sim();
+            const auto single = float_ensemble.run_sim();
+
+            FreeFallPrecisionError error;
+            error.double_object_steps_per_second = reference.object_steps_per_second;
+            error.float_object_steps_per_second = single.object_steps_per_second;
+            if (profiles.empty())
+                return error;
+            for (std::size_t i = 0; i < profiles.size(); ++i)
+            {
+                const auto time_error = relative_error(single.impact_time[i], reference.impact_time[i]);
+                const auto velocity_error = relative_error(single.impact_velocity[i], reference.impact_velocity[i]);
+                const auto step_difference = single.steps[i] > reference.steps[i] ? single.steps[i] - reference.steps[i]
+                                                                                   : reference.steps[i] - single.steps[i];
+                if (time_error > error.max_impact_time_error)
+                {
+                    error.max_impact_time_error = time_error;
+                    error.worst_impact_time_object = i;
+                }
+                if (velocity_error > error.max_impact_velocity_error)
+                {
+                    error.max_impact_velocity_error = velocity_error;
+                    error.worst_impact_velocity_object = i;
+                }
+                error.max_impact_step_difference = std::max(error.max_impact_step_difference, step_difference);
+                error.mean_impact_time_error += time_error;
+                error.mean_impact_velocity_error += velocity_error;
+            }
+            error.mean_impact_time_error /= static_cast<double>(profiles.size());
+            error.mean_impact_velocity_error /= static_cast<double>(profiles.size());
+            return error;
+        }
+}
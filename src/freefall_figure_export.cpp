@@ -0,0 +1,115 @@
+#include "freefall_figure_export.h"
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+#include "freefall_downsampling.h"
+#include "freefall_trajectory_sink.h"
+
+namespace FreeFallSim
+{
+
+        FreeFallFigure make_figure(const FreeFallSimPlot& sim_plot_vars, FreeFallPlotQuantity quantity, std::size_t max_points)
+        {
+            FreeFallFigure figure;
+            figure.xlabel = "Time(s)";
+            const std::vector<double>* values{nullptr};
+            switch (quantity)
+            {
+                case FreeFallPlotQuantity::Position:
+                    figure.title = "Time(s) vs Position(m)";
+                    figure.ylabel = "Position(m)";
+                    values = &sim_plot_vars.position_data;
+                    break;
+                case FreeFallPlotQuantity::Velocity:
+                    figure.title = "Time(s) vs Velocity(m/s)";
+                    figure.ylabel = "Velocity(m/s)";
+                    values = &sim_plot_vars.velocity_data;
+                    break;
+                case FreeFallPlotQuantity::NetForce:
+                    figure.title = "Time(s) vs NetForce(N)";
+                    figure.ylabel = "NetForce(N)";
+                    values = &sim_plot_vars.netforce_data;
+                    break;
+            }
+            auto shown = lttb_downsample(sim_plot_vars.time_data, *values, max_points);
+            figure.x = std::move(shown.x);
+            figure.y = std::move(shown.y);
+            return figure;
+        }
+
+        FreeFallFigureExportPool::FreeFallFigureExportPool(Renderer renderer, std::size_t thread_count, std::size_t queue_capacity):
+            m_renderer(std::move(renderer)),
+            m_jobs(queue_capacity)
+        {
+            if (!m_renderer)
+                throw std::invalid_argument("FreeFallFigureExportPool: no renderer");
+            if (thread_count == 0)
+                thread_count = std::max(1u, std::thread::hardware_concurrency());
+            m_threads.reserve(thread_count);
+            for (std::size_t i = 0; i < thread_count; ++i)
+                m_threads.emplace_back([this] { worker_loop(); });
+        }
+
+        FreeFallFigureExportPool::~FreeFallFigureExportPool()
+        {
+            m_jobs.close();
+            for (auto& thread : m_threads)
+                thread.join();
+        }
+
+        bool FreeFallFigureExportPool::submit(FreeFallFigureJob job)
+        {
+            {
+                std::lock_guard lock{m_mutex};
+                ++m_pending;
+            }
+            if (m_jobs.push(std::move(job)))
+                return true;
+            std::lock_guard lock{m_mutex};
+            --m_pending;
+            return false;
+        }
+
+        FreeFallFigureExportReport FreeFallFigureExportPool::wait()
+        {
+            std::unique_lock lock{m_mutex};
+            m_idle.wait(lock, [this] { return m_pending == 0; });
+            return std::exchange(m_report, FreeFallFigureExportReport{});
+        }
+
+        void FreeFallFigureExportPool::worker_loop()
+        {
+            while (auto job = m_jobs.pop())
+            {
+                std::string error;
+                try
+                {
+                    const auto sim_plot_vars = job->sim_plot_vars ? job->sim_plot_vars
+                                                                  : std::make_shared<const FreeFallSimPlot>(read_binary_trajectory(job->trajectory_path));
+                    m_renderer(make_figure(*sim_plot_vars, job->quantity, job->max_points), job->output_path);
+                }
+                catch (const std::exception& exception)
+                {
+                    error = job->output_path + ": " + exception.what();
+                }
+                catch (...)
+                {
+                    error = job->output_path + ": unknown error";
+                }
+
+                std::lock_guard lock{m_mutex};
+                if (error.empty())
+                {
+                    ++m_report.rendered;
+                }
+                else
+                {
+                    ++m_report.failed;
+                    m_report.errors.push_back(std::move(error));
+                }
+                if (--m_pending == 0)
+                    m_idle.notify_all();
+            }
+        }
+}
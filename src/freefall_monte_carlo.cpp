@@ -0,0 +1,119 @@
+#include "freefall_monte_carlo.h"
+#include "freefall_analytic_solution.h"
+#include <algorithm>
+#include <cmath>
+
+namespace FreeFallSim
+{
+    namespace
+    {
+        // block {index, parameter} gives the draws of one parameter of one sample
+        enum MonteCarloParameter : std::uint32_t { kMass, kRadius, kDragCoefficient, kFluidDensity };
+        // bounds the envelope when the end time comes from an estimate capped only by finish_time
+        constexpr double kMaxEnvelopeBins{65536.0};
+
+        double draw_parameter(const FreeFallUncertainty& uncertainty, double base_value, const FreeFallMonteCarloProfile& monte_carlo,
+            std::uint64_t index, MonteCarloParameter parameter)
+        {
+            if (uncertainty.kind == FreeFallUncertainty::Kind::Fixed)
+                return base_value;
+            const FreeFallPhilox4x32::Key key{static_cast<std::uint32_t>(monte_carlo.seed), static_cast<std::uint32_t>(monte_carlo.seed >> 32)};
+            const auto words = FreeFallPhilox4x32::block({static_cast<std::uint32_t>(index), static_cast<std::uint32_t>(index >> 32),
+                parameter, 0}, key);
+            const auto uniform_draw = FreeFallPhilox4x32::uniform(words[0], words[1]);
+            // Box-Muller with the second uniform
+            const auto normal_draw = std::sqrt(-2.0 * std::log(uniform_draw)) * std::cos(2.0 * M_PI * FreeFallPhilox4x32::uniform(words[2], words[3]));
+            return uncertainty.draw(base_value, uniform_draw, normal_draw);
+        }
+    }
+
+        double FreeFallUncertainty::draw(double base_value, double uniform_draw, double normal_draw) const
+        {
+            switch (kind)
+            {
+                case Kind::Uniform:
+                    return first + (second - first) * uniform_draw;
+                case Kind::Normal:
+                    return first + second * normal_draw;
+                case Kind::LogNormal:
+                    return first * std::exp(second * normal_draw);
+                case Kind::Fixed:
+                    break;
+            }
+            return base_value;
+        }
+
+        FreeFallMonteCarloResult::FreeFallMonteCarloResult(double quantile_relative_accuracy, FreeFallTimeEnvelope envelope):
+            impact_time_quantiles(quantile_relative_accuracy), impact_speed_quantiles(quantile_relative_accuracy),
+            envelope(std::move(envelope))
+        {}
+
+        void FreeFallMonteCarloResult::add_run(double end_time, double end_position, double end_velocity)
+        {
+            ++sample_count;
+            if (end_position > 0.0)
+                return;
+            ++landed_count;
+            impact_time.add(end_time);
+            impact_speed.add(std::abs(end_velocity));
+            impact_time_quantiles.add(end_time);
+            impact_speed_quantiles.add(std::abs(end_velocity));
+        }
+
+        void FreeFallMonteCarloResult::merge(const FreeFallMonteCarloResult& other)
+        {
+            sample_count += other.sample_count;
+            landed_count += other.landed_count;
+            impact_time.merge(other.impact_time);
+            impact_speed.merge(other.impact_speed);
+            impact_time_quantiles.merge(other.impact_time_quantiles);
+            impact_speed_quantiles.merge(other.impact_speed_quantiles);
+            envelope.merge(other.envelope);
+        }
+
+        std::size_t FreeFallMonteCarloResult::memory_bytes() const
+        {
+            return sizeof(*this) + impact_time_quantiles.memory_bytes() + impact_speed_quantiles.memory_bytes() + envelope.memory_bytes();
+        }
+
+        FreeFallObjProfile draw_monte_carlo_profile(const FreeFallObjProfile& base_obj_profile, const FreeFallMonteCarloProfile& monte_carlo,
+            std::uint64_t index)
+        {
+            auto sim_obj_profile = base_obj_profile;
+            sim_obj_profile.mass_of_object = draw_parameter(monte_carlo.mass_of_object, base_obj_profile.mass_of_object, monte_carlo, index, kMass);
+            sim_obj_profile.radius_of_object = draw_parameter(monte_carlo.radius_of_object, base_obj_profile.radius_of_object, monte_carlo, index, kRadius);
+            sim_obj_profile.kDragCoefficient = draw_parameter(monte_carlo.drag_coefficient, base_obj_profile.kDragCoefficient, monte_carlo, index,
+                kDragCoefficient);
+            sim_obj_profile.fluid_density_air = draw_parameter(monte_carlo.fluid_density_air, base_obj_profile.fluid_density_air, monte_carlo, index,
+                kFluidDensity);
+            return sim_obj_profile;
+        }
+
+        FreeFallSimulationProfile monte_carlo_sim_vars(const FreeFallSimulationProfile& base_sim_vars, const FreeFallMonteCarloProfile& monte_carlo)
+        {
+            auto sim_vars = base_sim_vars;
+            // an interval of 0 leaves only the start and final states
+            sim_vars.sampling = SamplingProfile::TimeInterval;
+            sim_vars.sample_interval = monte_carlo.envelope_bin_width > 0.0 ? monte_carlo.envelope_bin_width : 0.0;
+            sim_vars.console_output = false;
+            return sim_vars;
+        }
+
+        FreeFallMonteCarloResult make_monte_carlo_result(const FreeFallObjProfile& base_obj_profile, const FreeFallSimulationProfile& sim_vars,
+            GravityProfile gravity_profile, const FreeFallMonteCarloProfile& monte_carlo)
+        {
+            const auto end_time = monte_carlo.envelope_end_time > 0.0 ? monte_carlo.envelope_end_time :
+                2.0 * estimate_impact_time(base_obj_profile, sim_vars, gravity_profile);
+            const auto bin_width = monte_carlo.envelope_bin_width;
+            return FreeFallMonteCarloResult{monte_carlo.quantile_relative_accuracy,
+                FreeFallTimeEnvelope{bin_width, std::min(end_time, bin_width * kMaxEnvelopeBins)}};
+        }
+
+        FreeFallMonteCarloResult run_monte_carlo(GravityProfile gravity_profile, const FreeFallObjProfile& base_obj_profile,
+            const FreeFallSimulationProfile& base_sim_vars, const FreeFallMonteCarloProfile& monte_carlo, FreeFallWorkStealingPool& pool)
+        {
+            if (gravity_profile == GravityProfile::NewtonGravitationModel)
+                return run_monte_carlo<FreeFallNewtonGravitySimlation>(base_obj_profile, base_sim_vars, monte_carlo, pool);
+            return run_monte_carlo<FreeFallConstGravitySimlation>(base_obj_profile, base_sim_vars, monte_carlo, pool);
+        }
+}
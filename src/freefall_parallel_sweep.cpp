@@ -0,0 +1,247 @@
+
+#include "freefall_parallel_sweep.h"
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <utility>
+
+namespace FreeFallSim
+{
+
+        FreeFallWorkStealingPool::FreeFallWorkStealingPool(std::size_t thread_count)
+        {
+            if (thread_count == 0)
+                thread_count = std::max(1u, std::thread::hardware_concurrency());
+            m_queues.reserve(thread_count);
+            for (std::size_t worker = 0; worker < thread_count; ++worker)
+                m_queues.emplace_back(std::make_unique<WorkerQueue>());
+            // worker 0 is the thread calling parallel_for
+            m_threads.reserve(thread_count - 1);
+            for (std::size_t worker = 1; worker < thread_count; ++worker)
+                m_threads.emplace_back(&FreeFallWorkStealingPool::worker_loop, this, worker);
+        }
+
+        FreeFallWorkStealingPool::~FreeFallWorkStealingPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_work_ready.notify_all();
+            for (auto& thread : m_threads)
+                thread.join();
+        }
+
+        void FreeFallWorkStealingPool::parallel_for(std::size_t count, const Task& task)
+        {
+            if (count == 0)
+                return;
+
+            // Seed every worker with a contiguous block, stealing evens out the run lengths
+            const auto workers = thread_count();
+            for (std::size_t worker = 0; worker < workers; ++worker)
+            {
+                const auto begin = count * worker / workers;
+                const auto end = count * (worker + 1) / workers;
+                std::lock_guard<std::mutex> lock(m_queues[worker]->mutex);
+                for (auto index = begin; index < end; ++index)
+                    m_queues[worker]->tasks.push_back(index);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_task = &task;
+                m_remaining = count;
+                m_error = nullptr;
+                ++m_generation;
+                ++m_active_workers;
+            }
+            m_work_ready.notify_all();
+
+            run_tasks(0, task);
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            --m_active_workers;
+            m_work_done.wait(lock, [this]() { return m_remaining == 0 && m_active_workers == 0; });
+            m_task = nullptr;
+            if (m_error)
+                std::rethrow_exception(std::exchange(m_error, nullptr));
+        }
+
+        void FreeFallWorkStealingPool::worker_loop(std::size_t worker)
+        {
+            std::size_t seen_generation{0};
+            while (true)
+            {
+                const Task* task{nullptr};
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_work_ready.wait(lock, [&]() { return m_stop || m_generation != seen_generation; });
+                    if (m_stop)
+                        return;
+                    seen_generation = m_generation;
+                    // a late wake up after parallel_for already returned finds no task
+                    if (m_task == nullptr)
+                        continue;
+                    task = m_task;
+                    ++m_active_workers;
+                }
+
+                run_tasks(worker, *task);
+
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    --m_active_workers;
+                }
+                m_work_done.notify_all();
+            }
+        }
+
+        void FreeFallWorkStealingPool::run_tasks(std::size_t worker, const Task& task)
+        {
+            std::size_t index;
+            while (pop_or_steal(worker, index))
+            {
+                try
+                {
+                    task(index, worker);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    if (!m_error)
+                        m_error = std::current_exception();
+                }
+                std::lock_guard<std::mutex> lock(m_mutex);
+                --m_remaining;
+            }
+        }
+
+        bool FreeFallWorkStealingPool::pop_or_steal(std::size_t worker, std::size_t& index)
+        {
+            {
+                auto& own = *m_queues[worker];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                if (!own.tasks.empty())
+                {
+                    index = own.tasks.front();
+                    own.tasks.pop_front();
+                    return true;
+                }
+            }
+            // tasks never spawn new tasks, so a full pass over empty queues means we are done
+            const auto workers = thread_count();
+            for (std::size_t offset = 1; offset < workers; ++offset)
+            {
+                auto& victim = *m_queues[(worker + offset) % workers];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (!victim.tasks.empty())
+                {
+                    index = victim.tasks.back();
+                    victim.tasks.pop_back();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        std::vector<FreeFallSimModels> expand_sweep_grid(const FreeFallSweepGrid& grid)
+        {
+            // an empty axis contributes the single base value
+            auto axis = [](const auto& values, auto base_value)
+            {
+                using value_type = typename std::decay_t<decltype(values)>::value_type;
+                return values.empty() ? std::vector<value_type>{static_cast<value_type>(base_value)} : values;
+            };
+            const auto heights = axis(grid.heights, grid.base_sim_profile.position);
+            const auto masses = axis(grid.masses, grid.base_obj_profile.mass_of_object);
+            const auto drag_coefficients = axis(grid.drag_coefficients, grid.base_obj_profile.kDragCoefficient);
+            const auto time_steps = axis(grid.time_steps, grid.base_sim_profile.time_step);
+
+            std::vector<FreeFallSimModels> sim_models;
+            sim_models.reserve(heights.size() * masses.size() * drag_coefficients.size() * time_steps.size());
+            for (const auto height : heights)
+                for (const auto mass : masses)
+                    for (const auto drag_coefficient : drag_coefficients)
+                        for (const auto time_step : time_steps)
+                        {
+                            auto sim_obj = grid.base_obj_profile;
+                            sim_obj.mass_of_object = mass;
+                            sim_obj.kDragCoefficient = drag_coefficient;
+                            auto sim_vars = grid.base_sim_profile;
+                            sim_vars.position = height;
+                            sim_vars.time_step = time_step;
+                            if (grid.gravity_profile == GravityProfile::NewtonGravitationModel)
+                                sim_models.emplace_back(std::in_place_type<FreeFallNewtonGravitySimlation>, sim_obj, sim_vars, FreeFallSimPlot{});
+                            else
+                                sim_models.emplace_back(std::in_place_type<FreeFallConstGravitySimlation>, sim_obj, sim_vars, FreeFallSimPlot{});
+                        }
+            return sim_models;
+        }
+
+        std::vector<FreeFallSimPlot> run_parallel_sweep(const std::vector<FreeFallSimModels>& sim_models, FreeFallWorkStealingPool& pool)
+        {
+            // every task writes only its own slot, which keeps the output in input order
+            std::vector<FreeFallSimPlot> sim_plots(sim_models.size());
+            pool.parallel_for(sim_models.size(), [&](std::size_t index, std::size_t)
+            {
+                auto sim_model = sim_models[index];
+                sim_plots[index] = std::visit(Simulator{}, sim_model);
+            });
+            return sim_plots;
+        }
+
+        std::vector<FreeFallSimPlot> run_parallel_sweep(const std::vector<FreeFallSimModels>& sim_models, FreeFallWorkStealingPool& pool,
+            std::vector<FreeFallRunStats>& run_stats)
+        {
+            std::vector<FreeFallSimPlot> sim_plots(sim_models.size());
+            run_stats.resize(sim_models.size());
+            pool.parallel_for(sim_models.size(), [&](std::size_t index, std::size_t)
+            {
+                auto& stats = run_stats[index];
+                if (stats.name.empty())
+                    stats.name = "sweep[" + std::to_string(index) + "]";
+                auto sim_model = sim_models[index];
+                sim_plots[index] = std::visit([&stats](auto& sim) { return sim.run_sim(stats); }, sim_model);
+            });
+            return sim_plots;
+        }
+
+        std::vector<FreeFallResultCache::Entry> run_parallel_sweep(const std::vector<FreeFallSimModels>& sim_models, FreeFallWorkStealingPool& pool,
+            FreeFallResultCache& cache)
+        {
+            std::vector<FreeFallResultCache::Entry> entries(sim_models.size());
+            pool.parallel_for(sim_models.size(), [&](std::size_t index, std::size_t)
+            {
+                entries[index] = std::visit([&cache](const auto& sim) { return cache.run_sim(sim); }, sim_models[index]);
+            });
+            return entries;
+        }
+
+        std::vector<FreeFallSimPlot> run_parallel_sweep(const std::vector<FreeFallSimModels>& sim_models, std::size_t thread_count)
+        {
+            FreeFallWorkStealingPool pool{thread_count};
+            return run_parallel_sweep(sim_models, pool);
+        }
+
+        std::vector<FreeFallSweepScaling> measure_sweep_scaling(const std::vector<FreeFallSimModels>& sim_models,
+            const std::vector<std::size_t>& thread_counts)
+        {
+            std::vector<FreeFallSweepScaling> scaling;
+            scaling.reserve(thread_counts.size());
+            for (const auto thread_count : thread_counts)
+            {
+                FreeFallWorkStealingPool pool{thread_count};
+                const auto start = std::chrono::steady_clock::now();
+                const auto sim_plots = run_parallel_sweep(sim_models, pool);
+                const auto stop = std::chrono::steady_clock::now();
+                const auto wall_time_s = std::chrono::duration<double>(stop - start).count();
+                const auto baseline_time = scaling.empty() ? wall_time_s : scaling.front().wall_time_s;
+                const auto baseline_threads = scaling.empty() ? pool.thread_count() : scaling.front().thread_count;
+                const auto speedup = wall_time_s > 0.0 ? baseline_time / wall_time_s : 0.0;
+                const auto efficiency = speedup * baseline_threads / pool.thread_count();
+                scaling.push_back({pool.thread_count(), wall_time_s, speedup, efficiency});
+            }
+            return scaling;
+        }
+}
@@ -0,0 +1,327 @@
+#include "freefall_parameter_fit.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace FreeFallSim
+{
+    namespace
+    {
+        constexpr std::size_t kMaxFitParameters{3};
+        constexpr double kMaxDamping{1e12};
+        constexpr double kMinDamping{1e-12};
+        // largest step of a log parameter, a factor e, keeps a poor start from jumping out of range
+        constexpr double kMaxLogStep{1.0};
+
+        using SquareMatrix = std::array<double, kMaxFitParameters * kMaxFitParameters>;
+        using Vector = std::array<double, kMaxFitParameters>;
+
+        // Solves A x = b for the leading size x size block of a symmetric positive definite A by
+        // Cholesky, false when A is not positive definite
+        bool solve_cholesky(SquareMatrix a, std::size_t size, Vector& x)
+        {
+            for (std::size_t j = 0; j < size; ++j)
+            {
+                auto diagonal = a[j * kMaxFitParameters + j];
+                for (std::size_t k = 0; k < j; ++k)
+                    diagonal -= a[j * kMaxFitParameters + k] * a[j * kMaxFitParameters + k];
+                if (!(diagonal > 0.0))
+                    return false;
+                a[j * kMaxFitParameters + j] = std::sqrt(diagonal);
+                for (std::size_t i = j + 1; i < size; ++i)
+                {
+                    auto value = a[i * kMaxFitParameters + j];
+                    for (std::size_t k = 0; k < j; ++k)
+                        value -= a[i * kMaxFitParameters + k] * a[j * kMaxFitParameters + k];
+                    a[i * kMaxFitParameters + j] = value / a[j * kMaxFitParameters + j];
+                }
+            }
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                for (std::size_t k = 0; k < i; ++k)
+                    x[i] -= a[i * kMaxFitParameters + k] * x[k];
+                x[i] /= a[i * kMaxFitParameters + i];
+            }
+            for (std::size_t i = size; i-- > 0;)
+            {
+                for (std::size_t k = i + 1; k < size; ++k)
+                    x[i] -= a[k * kMaxFitParameters + i] * x[k];
+                x[i] /= a[i * kMaxFitParameters + i];
+            }
+            return true;
+        }
+
+        void validate_drop(const FreeFallMeasuredDrop& drop)
+        {
+            if (drop.time_data.empty() || drop.time_data.size() != drop.position_data.size())
+                throw std::invalid_argument("fit_drop: time_data and position_data must be non empty and of equal length");
+            if (!(drop.time_data.front() >= 0.0) || !std::is_sorted(drop.time_data.begin(), drop.time_data.end()))
+                throw std::invalid_argument("fit_drop: time_data must be ascending from t >= 0");
+            if (!(drop.sim_vars.time_step > 0.0f))
+                throw std::invalid_argument("fit_drop: time_step must be positive");
+            // from rest or downward v stays >= 0, where the engine's k*v^2 drag opposes the motion
+            if (!(drop.sim_vars.velocity >= 0.0))
+                throw std::invalid_argument("fit_drop: release velocity must not be upward (negative)");
+        }
+    }
+
+        void FreeFallFitWorkspace::reserve(std::size_t sample_count)
+        {
+            if (m_residuals.size() >= sample_count)
+                return;
+            m_residuals.resize(sample_count);
+            m_trial_residuals.resize(sample_count);
+            m_jacobian.resize(sample_count * kMaxFitParameters);
+            m_trial_jacobian.resize(sample_count * kMaxFitParameters);
+            ++m_grow_count;
+        }
+
+    // One fit: the free parameters are the logs of Cd, m and r, which keeps them positive and makes
+    // the columns of the Jacobian dk/dln(p) = k, -k and 2k
+    class FreeFallFitSolver
+    {
+        public:
+        FreeFallFitSolver(const FreeFallMeasuredDrop& drop, const FreeFallFitProfile& fit_profile, FreeFallFitWorkspace& workspace):
+            m_drop(drop), m_fit_profile(fit_profile), m_workspace(workspace), m_sample_count(drop.time_data.size())
+        {
+            const auto& sim_vars = drop.sim_vars;
+            m_gravitational_parameter = sim_vars.kUniversalGravitationConst * sim_vars.kMassOfPlanet;
+            m_planet_radius = sim_vars.kRadiusOfPlanet;
+            m_newton_gravity = fit_profile.gravity_profile == GravityProfile::NewtonGravitationModel;
+            m_gravity = sim_vars.gravity_acceleration;
+            m_parameters = {drop.initial_guess.kDragCoefficient, drop.initial_guess.mass_of_object, drop.initial_guess.radius_of_object};
+            for (std::size_t parameter = 0; parameter < kMaxFitParameters; ++parameter)
+                if (fit_profile.parameters & (1u << parameter))
+                    m_free[m_free_count++] = parameter;
+        }
+
+        FreeFallFitResult solve()
+        {
+            FreeFallFitResult result;
+            auto cost = evaluate(m_parameters, m_workspace.m_residuals, m_workspace.m_jacobian);
+            ++result.evaluations;
+            auto damping = m_fit_profile.initial_damping;
+
+            while (m_free_count > 0 && result.iterations < m_fit_profile.max_iterations && !result.converged)
+            {
+                ++result.iterations;
+                SquareMatrix normal{};
+                Vector gradient{};
+                normal_equations(normal, gradient);
+
+                // raise the damping until a step lowers the cost
+                bool accepted{false};
+                while (!accepted && damping <= kMaxDamping)
+                {
+                    auto damped = normal;
+                    Vector step{};
+                    for (std::size_t i = 0; i < m_free_count; ++i)
+                    {
+                        damped[i * kMaxFitParameters + i] += damping * std::max(normal[i * kMaxFitParameters + i], 1e-300);
+                        step[i] = -gradient[i];
+                    }
+                    if (!solve_cholesky(damped, m_free_count, step))
+                    {
+                        damping *= 10.0;
+                        continue;
+                    }
+                    auto trial = m_parameters;
+                    double largest_step{0.0};
+                    for (std::size_t i = 0; i < m_free_count; ++i)
+                    {
+                        const auto log_step = std::clamp(step[i], -kMaxLogStep, kMaxLogStep);
+                        trial[m_free[i]] *= std::exp(log_step);
+                        largest_step = std::max(largest_step, std::abs(log_step));
+                    }
+                    const auto trial_cost = evaluate(trial, m_workspace.m_trial_residuals, m_workspace.m_trial_jacobian);
+                    ++result.evaluations;
+                    if (trial_cost < cost)
+                    {
+                        accepted = true;
+                        const auto decrease = (cost - trial_cost) / std::max(cost, std::numeric_limits<double>::min());
+                        m_parameters = trial;
+                        cost = trial_cost;
+                        m_workspace.m_residuals.swap(m_workspace.m_trial_residuals);
+                        m_workspace.m_jacobian.swap(m_workspace.m_trial_jacobian);
+                        damping = std::max(damping / 10.0, kMinDamping);
+                        result.converged = decrease < m_fit_profile.cost_tolerance || largest_step < m_fit_profile.step_tolerance;
+                    }
+                    else
+                    {
+                        damping *= 10.0;
+                        // no step lowers the cost any more, the current parameters are the optimum
+                        result.converged = largest_step < m_fit_profile.step_tolerance;
+                        if (result.converged)
+                            break;
+                    }
+                }
+                if (!accepted)
+                {
+                    result.converged = true;
+                    break;
+                }
+            }
+
+            result.fitted = m_drop.initial_guess;
+            result.fitted.kDragCoefficient = m_parameters[0];
+            result.fitted.mass_of_object = m_parameters[1];
+            result.fitted.radius_of_object = m_parameters[2];
+            result.rms_residual = std::sqrt(2.0 * cost / static_cast<double>(m_sample_count));
+            if (m_free_count == 0)
+                result.converged = true;
+            standard_deviations(cost, result);
+            return result;
+        }
+
+        private:
+        struct State
+        {
+            double position;                // (x) m
+            double velocity;                // (v) m/s, positive downward
+            double position_sensitivity;    // dx/dk
+            double velocity_sensitivity;    // dv/dk
+        };
+
+        State derivative(const State& state, double drag_per_mass) const
+        {
+            double gravity{m_gravity};
+            double gravity_gradient{0.0};
+            if (m_newton_gravity)
+            {
+                const auto distance = m_planet_radius + state.position;
+                gravity = m_gravitational_parameter / (distance * distance);
+                gravity_gradient = -2.0 * gravity / distance;
+            }
+            return {-state.velocity, gravity - drag_per_mass * state.velocity * state.velocity, -state.velocity_sensitivity,
+                gravity_gradient * state.position_sensitivity - state.velocity * state.velocity -
+                2.0 * drag_per_mass * state.velocity * state.velocity_sensitivity};
+        }
+
+        void rk4_step(State& state, double drag_per_mass, double step) const
+        {
+            auto advance = [](const State& state, const State& rate, double factor)
+            {
+                return State{state.position + factor * rate.position, state.velocity + factor * rate.velocity,
+                    state.position_sensitivity + factor * rate.position_sensitivity, state.velocity_sensitivity + factor * rate.velocity_sensitivity};
+            };
+            const auto k1 = derivative(state, drag_per_mass);
+            const auto k2 = derivative(advance(state, k1, 0.5 * step), drag_per_mass);
+            const auto k3 = derivative(advance(state, k2, 0.5 * step), drag_per_mass);
+            const auto k4 = derivative(advance(state, k3, step), drag_per_mass);
+            const auto sixth = step / 6.0;
+            state.position += sixth * (k1.position + 2.0 * k2.position + 2.0 * k3.position + k4.position);
+            state.velocity += sixth * (k1.velocity + 2.0 * k2.velocity + 2.0 * k3.velocity + k4.velocity);
+            state.position_sensitivity += sixth * (k1.position_sensitivity + 2.0 * k2.position_sensitivity +
+                2.0 * k3.position_sensitivity + k4.position_sensitivity);
+            state.velocity_sensitivity += sixth * (k1.velocity_sensitivity + 2.0 * k2.velocity_sensitivity +
+                2.0 * k3.velocity_sensitivity + k4.velocity_sensitivity);
+        }
+
+        // Integrates the drop through the measured times, fills residuals (model - measured) and the
+        // Jacobian columns of the free parameters, returns half the sum of squared residuals
+        double evaluate(const Vector& parameters, std::vector<double>& residuals, std::vector<double>& jacobian) const
+        {
+            const auto& sim_obj = m_drop.initial_guess;
+            const auto drag_per_mass = parameters[0] * sim_obj.fluid_density_air * M_PI * parameters[2] * parameters[2] / parameters[1];
+            // dk/dln(Cd), dk/dln(m), dk/dln(r)
+            const Vector drag_gradient{drag_per_mass, -drag_per_mass, 2.0 * drag_per_mass};
+            const double max_step = m_drop.sim_vars.time_step;
+
+            State state{m_drop.sim_vars.position, m_drop.sim_vars.velocity, 0.0, 0.0};
+            double time{0.0};
+            double cost{0.0};
+            for (std::size_t sample = 0; sample < m_sample_count; ++sample)
+            {
+                // equal steps of at most time_step ending exactly on the measured time
+                const auto span = m_drop.time_data[sample] - time;
+                const auto steps = span > 0.0 ? std::ceil(span / max_step) : 0.0;
+                for (double step = 0; step < steps; ++step)
+                    rk4_step(state, drag_per_mass, span / steps);
+                time = m_drop.time_data[sample];
+
+                const auto residual = state.position - m_drop.position_data[sample];
+                residuals[sample] = residual;
+                cost += 0.5 * residual * residual;
+                for (std::size_t i = 0; i < m_free_count; ++i)
+                    jacobian[sample * kMaxFitParameters + i] = state.position_sensitivity * drag_gradient[m_free[i]];
+            }
+            return std::isfinite(cost) ? cost : std::numeric_limits<double>::infinity();
+        }
+
+        void normal_equations(SquareMatrix& normal, Vector& gradient) const
+        {
+            const auto& residuals = m_workspace.m_residuals;
+            const auto& jacobian = m_workspace.m_jacobian;
+            for (std::size_t sample = 0; sample < m_sample_count; ++sample)
+            {
+                const auto* row = &jacobian[sample * kMaxFitParameters];
+                for (std::size_t i = 0; i < m_free_count; ++i)
+                {
+                    gradient[i] += row[i] * residuals[sample];
+                    for (std::size_t j = 0; j < m_free_count; ++j)
+                        normal[i * kMaxFitParameters + j] += row[i] * row[j];
+                }
+            }
+        }
+
+        // sigma^2 * (J^T J)^-1 at the optimum, mapped from log space back to the parameters
+        void standard_deviations(double cost, FreeFallFitResult& result) const
+        {
+            if (m_free_count == 0)
+                return;
+            SquareMatrix normal{};
+            Vector gradient{};
+            normal_equations(normal, gradient);
+            const auto degrees_of_freedom = static_cast<double>(m_sample_count) - static_cast<double>(m_free_count);
+            const auto residual_variance = degrees_of_freedom > 0.0 ? 2.0 * cost / degrees_of_freedom : 0.0;
+            std::array<double*, kMaxFitParameters> stddevs{&result.drag_coefficient_stddev, &result.mass_stddev, &result.radius_stddev};
+            for (std::size_t i = 0; i < m_free_count; ++i)
+            {
+                Vector unit{};
+                unit[i] = 1.0;
+                const auto variance = solve_cholesky(normal, m_free_count, unit) ? residual_variance * unit[i] :
+                    std::numeric_limits<double>::infinity();
+                *stddevs[m_free[i]] = m_parameters[m_free[i]] * std::sqrt(variance);
+            }
+        }
+
+        const FreeFallMeasuredDrop& m_drop;
+        const FreeFallFitProfile& m_fit_profile;
+        FreeFallFitWorkspace& m_workspace;
+        std::size_t m_sample_count;
+        double m_gravity;
+        double m_gravitational_parameter;
+        double m_planet_radius;
+        bool m_newton_gravity;
+        Vector m_parameters;                            // Cd, m, r
+        std::array<std::size_t, kMaxFitParameters> m_free{};
+        std::size_t m_free_count{0};
+    };
+
+        FreeFallFitResult fit_drop(const FreeFallMeasuredDrop& drop, const FreeFallFitProfile& fit_profile, FreeFallFitWorkspace& workspace)
+        {
+            validate_drop(drop);
+            workspace.reserve(drop.time_data.size());
+            return FreeFallFitSolver{drop, fit_profile, workspace}.solve();
+        }
+
+        FreeFallFitResult fit_drop(const FreeFallMeasuredDrop& drop, const FreeFallFitProfile& fit_profile)
+        {
+            FreeFallFitWorkspace workspace;
+            return fit_drop(drop, fit_profile, workspace);
+        }
+
+        std::vector<FreeFallFitResult> fit_drops(const std::vector<FreeFallMeasuredDrop>& drops, const FreeFallFitProfile& fit_profile,
+            FreeFallWorkStealingPool& pool)
+        {
+            std::vector<FreeFallFitResult> results(drops.size());
+            std::vector<FreeFallFitWorkspace> workspaces(pool.thread_count());
+            pool.parallel_for(drops.size(), [&](std::size_t index, std::size_t worker)
+            {
+                results[index] = fit_drop(drops[index], fit_profile, workspaces[worker]);
+            });
+            return results;
+        }
+}
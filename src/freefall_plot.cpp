@@ -0,0 +1,56 @@
+#include "freefall_plot.h"
+#include <mutex>
+#include <stdexcept>
+#include <matplot/matplot.h>
+
+namespace FreeFallSim
+{
+    namespace
+    {
+        void show_figure(const FreeFallFigure& figure)
+        {
+            matplot::plot(figure.x, figure.y);
+            matplot::title(figure.title);
+            matplot::xlabel(figure.xlabel);
+            matplot::ylabel(figure.ylabel);
+            matplot::show();
+        }
+
+        // The figure registry of matplot and the gnuplot pipes behind it are process wide and not
+        // known to be safe from several threads, so every export draws on one quiet figure in turn
+        std::mutex& render_mutex()
+        {
+            static std::mutex mutex;
+            return mutex;
+        }
+    }
+
+        void plot_time_vs_velocity(const FreeFallSimPlot& sim_plot_vars, std::size_t max_points)
+        {
+            show_figure(make_figure(sim_plot_vars, FreeFallPlotQuantity::Velocity, max_points));
+        }
+
+        void plot_time_vs_position(const FreeFallSimPlot& sim_plot_vars, std::size_t max_points)
+        {
+            show_figure(make_figure(sim_plot_vars, FreeFallPlotQuantity::Position, max_points));
+        }
+
+        void plot_time_vs_force(const FreeFallSimPlot& sim_plot_vars, std::size_t max_points)
+        {
+            show_figure(make_figure(sim_plot_vars, FreeFallPlotQuantity::NetForce, max_points));
+        }
+
+        void save_figure(const FreeFallFigure& figure, const std::string& output_path)
+        {
+            std::lock_guard lock{render_mutex()};
+            static const matplot::figure_handle handle = matplot::figure(true);
+            auto axes = handle->current_axes();
+            // hold is off, the new line replaces the one of the previous job
+            axes->plot(figure.x, figure.y);
+            axes->title(figure.title);
+            axes->xlabel(figure.xlabel);
+            axes->ylabel(figure.ylabel);
+            if (!handle->save(output_path))
+                throw std::runtime_error("save_figure: can not write " + output_path);
+        }
+}
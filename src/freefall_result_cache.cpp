@@ -0,0 +1,445 @@
+#include "freefall_result_cache.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace FreeFallSim
+{
+    namespace
+    {
+        struct CacheFileHeader
+        {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t reserved;
+            std::uint64_t key;
+            std::uint64_t sample_count;
+            std::uint64_t event_count;
+            std::uint64_t steps_taken;
+            std::uint64_t steps_rejected;
+            double wall_time_s;
+            double fast_forward_time;
+        };
+
+        constexpr char kCacheMagic[8] = {'F', 'F', 'C', 'A', 'C', 'H', 'E', '1'};
+        constexpr std::uint32_t kCacheFileVersion{1};
+        // Part of every key, bump it when a change of the integrators changes the trajectories so stale
+        // cache files stop matching
+        constexpr std::string_view kResultVersion{"results-1"};
+        constexpr const char* kCacheFileExtension{".ffc"};
+
+        class Fnv1a
+        {
+            public:
+            void bytes(const void* data, std::size_t size)
+            {
+                const auto* byte = static_cast<const unsigned char*>(data);
+                for (std::size_t i = 0; i < size; ++i)
+                {
+                    m_hash ^= byte[i];
+                    m_hash *= kPrime;
+                }
+            }
+            template <typename Integer>
+            void integer(Integer value)
+            {
+                const auto wide = static_cast<std::uint64_t>(value);
+                bytes(&wide, sizeof(wide));
+            }
+            void real(double value)
+            {
+                // +0.0 and -0.0 give the same trajectory
+                const double canonical = value == 0.0 ? 0.0 : value;
+                bytes(&canonical, sizeof(canonical));
+            }
+            void text(std::string_view value)
+            {
+                integer(value.size());
+                bytes(value.data(), value.size());
+            }
+            std::uint64_t value() const { return m_hash; }
+
+            private:
+            static constexpr std::uint64_t kOffsetBasis{14695981039346656037ull};
+            static constexpr std::uint64_t kPrime{1099511628211ull};
+            std::uint64_t m_hash{kOffsetBasis};
+        };
+
+        std::size_t data_bytes(std::size_t sample_count, std::size_t event_count)
+        {
+            return 4 * sample_count * sizeof(double) + event_count * sizeof(FreeFallEvent);
+        }
+    }
+
+        std::uint64_t hash_profiles(const FreeFallObjProfile& sim_obj_profile, const FreeFallSimulationProfile& sim_vars,
+            std::string_view model_name)
+        {
+            Fnv1a hash;
+            hash.text(kResultVersion);
+            hash.text(model_name);
+            hash.real(sim_obj_profile.kDragCoefficient);
+            hash.real(sim_obj_profile.mass_of_object);
+            hash.real(sim_obj_profile.radius_of_object);
+            hash.real(sim_obj_profile.fluid_density_air);
+
+            hash.real(sim_vars.kUniversalGravitationConst);
+            hash.real(sim_vars.kMassOfPlanet);
+            hash.real(sim_vars.kRadiusOfPlanet);
+            hash.real(sim_vars.gravity_acceleration);
+            hash.real(sim_vars.position);
+            hash.real(sim_vars.velocity);
+            hash.real(sim_vars.time_step);
+            hash.integer(sim_vars.sample_factor);
+            hash.integer(sim_vars.finish_time);
+            hash.integer(static_cast<int>(sim_vars.integrator));
+            hash.real(sim_vars.abs_tolerance);
+            hash.real(sim_vars.rel_tolerance);
+            hash.integer(static_cast<int>(sim_vars.sampling));
+            hash.real(sim_vars.sample_interval);
+            hash.integer(sim_vars.max_points);
+            hash.integer(sim_vars.locate_impact);
+            hash.integer(sim_vars.event_heights.size());
+            for (const auto height : sim_vars.event_heights)
+                hash.real(height);
+            hash.real(sim_vars.net_force_epsilon);
+            hash.integer(sim_vars.steady_state_fast_forward);
+            hash.real(sim_vars.steady_state_tolerance);
+            return hash.value();
+        }
+
+        FreeFallCachedTrajectory::FreeFallCachedTrajectory(FreeFallSimPlot sim_plot): m_sim_plot(std::move(sim_plot))
+        {
+            point_into_plot();
+        }
+
+        FreeFallCachedTrajectory::FreeFallCachedTrajectory(const std::string& path, std::uint64_t key)
+        {
+            const auto descriptor = ::open(path.c_str(), O_RDONLY);
+            if (descriptor < 0)
+                throw std::runtime_error("FreeFallCachedTrajectory: can not open " + path);
+            struct stat file_status{};
+            if (::fstat(descriptor, &file_status) != 0 || static_cast<std::size_t>(file_status.st_size) < sizeof(CacheFileHeader))
+            {
+                ::close(descriptor);
+                throw std::runtime_error("FreeFallCachedTrajectory: truncated " + path);
+            }
+            m_mapping_bytes = static_cast<std::size_t>(file_status.st_size);
+            auto* mapping = ::mmap(nullptr, m_mapping_bytes, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            ::close(descriptor);
+            if (mapping == MAP_FAILED)
+                throw std::runtime_error("FreeFallCachedTrajectory: can not map " + path);
+            m_mapping = mapping;
+
+            CacheFileHeader header;
+            std::memcpy(&header, m_mapping, sizeof(header));
+            const bool valid = std::memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) == 0 && header.version == kCacheFileVersion &&
+                header.key == key && header.sample_count <= m_mapping_bytes && header.event_count <= m_mapping_bytes &&
+                sizeof(CacheFileHeader) + data_bytes(header.sample_count, header.event_count) == m_mapping_bytes;
+            if (!valid)
+            {
+                ::munmap(m_mapping, m_mapping_bytes);
+                throw std::runtime_error("FreeFallCachedTrajectory: malformed " + path);
+            }
+
+            // the header is a multiple of 8 bytes and mappings are page aligned, the columns are aligned doubles
+            m_size = header.sample_count;
+            m_event_count = header.event_count;
+            const auto* columns = reinterpret_cast<const double*>(static_cast<const char*>(m_mapping) + sizeof(CacheFileHeader));
+            m_time = columns;
+            m_position = columns + m_size;
+            m_velocity = columns + 2 * m_size;
+            m_net_force = columns + 3 * m_size;
+            m_events = reinterpret_cast<const FreeFallEvent*>(columns + 4 * m_size);
+            m_integrator_stats.steps_taken = header.steps_taken;
+            m_integrator_stats.steps_rejected = header.steps_rejected;
+            m_integrator_stats.wall_time_s = header.wall_time_s;
+            m_integrator_stats.fast_forward_time = header.fast_forward_time;
+        }
+
+        FreeFallCachedTrajectory::~FreeFallCachedTrajectory()
+        {
+            if (m_mapping != nullptr)
+                ::munmap(m_mapping, m_mapping_bytes);
+        }
+
+        void FreeFallCachedTrajectory::point_into_plot()
+        {
+            m_size = std::min({m_sim_plot.time_data.size(), m_sim_plot.position_data.size(),
+                m_sim_plot.velocity_data.size(), m_sim_plot.netforce_data.size()});
+            m_event_count = m_sim_plot.events.size();
+            m_time = m_sim_plot.time_data.data();
+            m_position = m_sim_plot.position_data.data();
+            m_velocity = m_sim_plot.velocity_data.data();
+            m_net_force = m_sim_plot.netforce_data.data();
+            m_events = m_sim_plot.events.data();
+            m_integrator_stats = m_sim_plot.integrator_stats;
+        }
+
+        std::size_t FreeFallCachedTrajectory::size_bytes() const
+        {
+            return data_bytes(m_size, m_event_count);
+        }
+
+        FreeFallSimPlot FreeFallCachedTrajectory::to_plot() const
+        {
+            FreeFallSimPlot sim_plot_vars;
+            sim_plot_vars.time_data.assign(m_time, m_time + m_size);
+            sim_plot_vars.position_data.assign(m_position, m_position + m_size);
+            sim_plot_vars.velocity_data.assign(m_velocity, m_velocity + m_size);
+            sim_plot_vars.netforce_data.assign(m_net_force, m_net_force + m_size);
+            sim_plot_vars.events.assign(m_events, m_events + m_event_count);
+            sim_plot_vars.integrator_stats = m_integrator_stats;
+            return sim_plot_vars;
+        }
+
+        void FreeFallCachedTrajectory::write_file(const std::string& path, std::uint64_t key) const
+        {
+            // a name of its own next to the target, writers missing the same key at once never share it
+            std::string temporary_path = path + ".XXXXXX";
+            const auto descriptor = ::mkstemp(temporary_path.data());
+            if (descriptor < 0)
+                throw std::runtime_error("FreeFallCachedTrajectory: can not create " + temporary_path);
+            auto* file = ::fdopen(descriptor, "wb");
+            if (file == nullptr)
+            {
+                ::close(descriptor);
+                std::remove(temporary_path.c_str());
+                throw std::runtime_error("FreeFallCachedTrajectory: can not create " + temporary_path);
+            }
+
+            CacheFileHeader header{};
+            std::memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+            header.version = kCacheFileVersion;
+            header.key = key;
+            header.sample_count = m_size;
+            header.event_count = m_event_count;
+            header.steps_taken = m_integrator_stats.steps_taken;
+            header.steps_rejected = m_integrator_stats.steps_rejected;
+            header.wall_time_s = m_integrator_stats.wall_time_s;
+            header.fast_forward_time = m_integrator_stats.fast_forward_time;
+            bool written = std::fwrite(&header, sizeof(header), 1, file) == 1;
+            for (const auto* column : {m_time, m_position, m_velocity, m_net_force})
+                written = written && std::fwrite(column, sizeof(double), m_size, file) == m_size;
+            written = written && std::fwrite(m_events, sizeof(FreeFallEvent), m_event_count, file) == m_event_count;
+            written = std::fclose(file) == 0 && written;
+            if (written && std::rename(temporary_path.c_str(), path.c_str()) == 0)
+                return;
+
+            std::remove(temporary_path.c_str());
+            // another writer of the key got its file in place first, the contents are the same
+            std::error_code error;
+            if (!written || !std::filesystem::is_regular_file(path, error))
+                throw std::runtime_error("FreeFallCachedTrajectory: write failed " + path);
+        }
+
+        FreeFallResultCache::FreeFallResultCache(FreeFallCacheOptions options): m_options(std::move(options))
+        {
+            if (!m_options.directory.empty())
+            {
+                std::filesystem::create_directories(m_options.directory);
+                adopt_directory();
+            }
+        }
+
+        std::string FreeFallResultCache::file_path(std::uint64_t key) const
+        {
+            char name[17];
+            std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+            return (std::filesystem::path{m_options.directory} / (std::string{name} + kCacheFileExtension)).string();
+        }
+
+        void FreeFallResultCache::adopt_directory()
+        {
+            // files of earlier runs, the least recently written ones are evicted first
+            struct Found
+            {
+                std::filesystem::file_time_type write_time;
+                DiskFile file;
+            };
+            std::vector<Found> found;
+            for (const auto& directory_entry : std::filesystem::directory_iterator{m_options.directory})
+            {
+                const auto& path = directory_entry.path();
+                if (!directory_entry.is_regular_file() || path.extension() != kCacheFileExtension)
+                    continue;
+                const auto stem = path.stem().string();
+                char* parse_end{nullptr};
+                const auto key = std::strtoull(stem.c_str(), &parse_end, 16);
+                if (stem.size() != 16 || parse_end != stem.c_str() + stem.size())
+                    continue;
+                found.push_back({directory_entry.last_write_time(), {key, directory_entry.file_size()}});
+            }
+            std::sort(found.begin(), found.end(), [](const Found& lhs, const Found& rhs) { return lhs.write_time > rhs.write_time; });
+            for (const auto& entry : found)
+            {
+                m_disk_lru.push_back(entry.file);
+                m_disk_index[entry.file.key] = std::prev(m_disk_lru.end());
+                m_stats.disk_bytes += entry.file.bytes;
+            }
+            m_stats.disk_entries = m_disk_lru.size();
+            insert_disk(0, 0);
+        }
+
+        FreeFallResultCache::Entry FreeFallResultCache::find(std::uint64_t key)
+        {
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                const auto memory_entry = m_memory_index.find(key);
+                if (memory_entry != m_memory_index.end())
+                {
+                    m_memory_lru.splice(m_memory_lru.begin(), m_memory_lru, memory_entry->second);
+                    ++m_stats.memory_hits;
+                    return memory_entry->second->second;
+                }
+                if (m_disk_index.count(key) == 0)
+                {
+                    ++m_stats.misses;
+                    return nullptr;
+                }
+            }
+
+            // mapped outside the lock, a file which vanished or does not parse is a miss
+            Entry entry;
+            try
+            {
+                entry = std::make_shared<const FreeFallCachedTrajectory>(file_path(key), key);
+            }
+            catch (const std::runtime_error&)
+            {
+            }
+            std::lock_guard<std::mutex> lock{m_mutex};
+            if (!entry)
+            {
+                erase_disk(key);
+                ++m_stats.misses;
+                return nullptr;
+            }
+            ++m_stats.disk_hits;
+            touch_disk(key);
+            insert_memory(key, entry);
+            return entry;
+        }
+
+        FreeFallResultCache::Entry FreeFallResultCache::insert(std::uint64_t key, FreeFallSimPlot sim_plot)
+        {
+            Entry entry = std::make_shared<const FreeFallCachedTrajectory>(std::move(sim_plot));
+            std::uint64_t file_bytes{0};
+            bool write_failed{false};
+            if (!m_options.directory.empty() && entry->size_bytes() + sizeof(CacheFileHeader) <= m_options.disk_capacity_bytes)
+            {
+                // a full disk or a read only directory costs the disk tier, not the result
+                try
+                {
+                    entry->write_file(file_path(key), key);
+                    file_bytes = entry->size_bytes() + sizeof(CacheFileHeader);
+                }
+                catch (const std::runtime_error&)
+                {
+                    write_failed = true;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock{m_mutex};
+            ++m_stats.insertions;
+            if (write_failed)
+                ++m_stats.disk_write_failures;
+            insert_memory(key, entry);
+            if (file_bytes > 0)
+                insert_disk(key, file_bytes);
+            return entry;
+        }
+
+        void FreeFallResultCache::insert_memory(std::uint64_t key, const Entry& entry)
+        {
+            const auto existing = m_memory_index.find(key);
+            if (existing != m_memory_index.end())
+            {
+                m_stats.memory_bytes -= existing->second->second->size_bytes();
+                m_memory_lru.erase(existing->second);
+                m_memory_index.erase(existing);
+            }
+            if (entry->size_bytes() <= m_options.memory_capacity_bytes && m_options.memory_capacity_bytes > 0)
+            {
+                m_memory_lru.emplace_front(key, entry);
+                m_memory_index[key] = m_memory_lru.begin();
+                m_stats.memory_bytes += entry->size_bytes();
+            }
+            while (m_stats.memory_bytes > m_options.memory_capacity_bytes && !m_memory_lru.empty())
+            {
+                const auto& [evicted_key, evicted] = m_memory_lru.back();
+                m_stats.memory_bytes -= evicted->size_bytes();
+                m_memory_index.erase(evicted_key);
+                m_memory_lru.pop_back();
+                ++m_stats.memory_evictions;
+            }
+            m_stats.memory_entries = m_memory_lru.size();
+        }
+
+        void FreeFallResultCache::touch_disk(std::uint64_t key)
+        {
+            const auto file = m_disk_index.find(key);
+            if (file != m_disk_index.end())
+                m_disk_lru.splice(m_disk_lru.begin(), m_disk_lru, file->second);
+        }
+
+        void FreeFallResultCache::insert_disk(std::uint64_t key, std::uint64_t bytes)
+        {
+            if (bytes > 0)
+            {
+                const auto existing = m_disk_index.find(key);
+                if (existing != m_disk_index.end())
+                {
+                    m_stats.disk_bytes -= existing->second->bytes;
+                    m_disk_lru.erase(existing->second);
+                }
+                m_disk_lru.push_front({key, bytes});
+                m_disk_index[key] = m_disk_lru.begin();
+                m_stats.disk_bytes += bytes;
+            }
+            // mapped entries stay readable after their file is unlinked
+            while (m_stats.disk_bytes > m_options.disk_capacity_bytes && !m_disk_lru.empty())
+            {
+                const auto evicted_key = m_disk_lru.back().key;
+                std::error_code error;
+                std::filesystem::remove(file_path(evicted_key), error);
+                erase_disk(evicted_key);
+                ++m_stats.disk_evictions;
+            }
+            m_stats.disk_entries = m_disk_lru.size();
+        }
+
+        void FreeFallResultCache::erase_disk(std::uint64_t key)
+        {
+            const auto file = m_disk_index.find(key);
+            if (file == m_disk_index.end())
+                return;
+            m_stats.disk_bytes -= file->second->bytes;
+            m_disk_lru.erase(file->second);
+            m_disk_index.erase(file);
+            m_stats.disk_entries = m_disk_lru.size();
+        }
+
+        FreeFallCacheStats FreeFallResultCache::stats() const
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            return m_stats;
+        }
+
+        void FreeFallResultCache::clear_memory()
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_memory_lru.clear();
+            m_memory_index.clear();
+            m_stats.memory_bytes = 0;
+            m_stats.memory_entries = 0;
+        }
+}
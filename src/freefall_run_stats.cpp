@@ -0,0 +1,90 @@
+#include "freefall_run_stats.h"
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace FreeFallSim
+{
+    namespace
+    {
+        const auto kTraceEpoch = std::chrono::steady_clock::now();
+        std::atomic<std::size_t> next_thread_index{0};
+
+        // names are user supplied, quotes and control characters have to be escaped in JSON
+        void write_json_string(std::ostream& output, const std::string& value)
+        {
+            output<< '"';
+            for (const auto character : value)
+            {
+                switch (character)
+                {
+                    case '"':
+                        output<< "\\\"";
+                        break;
+                    case '\\':
+                        output<< "\\\\";
+                        break;
+                    case '\n':
+                        output<< "\\n";
+                        break;
+                    case '\t':
+                        output<< "\\t";
+                        break;
+                    default:
+                        if (static_cast<unsigned char>(character) < 0x20)
+                            output<< "\\u"<< std::hex<< std::setw(4)<< std::setfill('0')<< static_cast<int>(character)<< std::dec;
+                        else
+                            output<< character;
+                }
+            }
+            output<< '"';
+        }
+    }
+
+        double trace_clock_us()
+        {
+            return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - kTraceEpoch).count();
+        }
+
+        std::size_t trace_thread_index()
+        {
+            thread_local const std::size_t thread_index = next_thread_index.fetch_add(1, std::memory_order_relaxed);
+            return thread_index;
+        }
+
+        void write_chrome_trace(std::ostream& trace_output, const std::vector<FreeFallRunStats>& run_stats)
+        {
+            // formatted on a stream of its own, the flags, precision and fill of the caller's stream stay as they are
+            std::ostringstream output;
+            output<< std::fixed<< std::setprecision(3);
+            output<< "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+            for (std::size_t i = 0; i < run_stats.size(); ++i)
+            {
+                const auto& stats = run_stats[i];
+                output<< (i == 0 ? "\n" : ",\n");
+                output<< "{\"name\":";
+                write_json_string(output, stats.name);
+                output<< ",\"cat\":\"run_sim\",\"ph\":\"X\",\"pid\":1,\"tid\":"<< stats.thread_index;
+                output<< ",\"ts\":"<< stats.start_us<< ",\"dur\":"<< stats.wall_time_s * 1e6;
+                output<< ",\"args\":{\"steps\":"<< stats.steps<< ",\"steps_rejected\":"<< stats.steps_rejected;
+                output<< ",\"samples\":"<< stats.samples;
+                output<< ",\"integration_us\":"<< stats.integration_time_s * 1e6<< ",\"output_us\":"<< stats.output_time_s * 1e6;
+                output<< ",\"peak_trajectory_bytes\":"<< stats.peak_trajectory_bytes<< ",\"reallocations\":"<< stats.reallocations<< "}}";
+            }
+            output<< "\n]}\n";
+            trace_output<< output.str();
+        }
+
+        void write_chrome_trace(const std::string& path, const std::vector<FreeFallRunStats>& run_stats)
+        {
+            std::ofstream output{path};
+            if (!output)
+                throw std::runtime_error("write_chrome_trace: can not open " + path);
+            write_chrome_trace(output, run_stats);
+            output.flush();
+            if (!output)
+                throw std::runtime_error("write_chrome_trace: write failed for " + path);
+        }
+}
@@ -0,0 +1,145 @@
+#include "freefall_streaming_stats.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace FreeFallSim
+{
+
+        void FreeFallWelford::merge(const FreeFallWelford& other)
+        {
+            if (other.m_count == 0)
+                return;
+            if (m_count == 0)
+            {
+                *this = other;
+                return;
+            }
+            const auto count = m_count + other.m_count;
+            const auto delta = other.m_mean - m_mean;
+            const auto weight = static_cast<double>(other.m_count) / static_cast<double>(count);
+            m_mean += delta * weight;
+            m_m2 += other.m_m2 + delta * delta * static_cast<double>(m_count) * weight;
+            m_count = count;
+            m_min = std::min(m_min, other.m_min);
+            m_max = std::max(m_max, other.m_max);
+        }
+
+        double FreeFallWelford::stddev() const
+        {
+            return std::sqrt(variance());
+        }
+
+        FreeFallQuantileSketch::FreeFallQuantileSketch(double relative_accuracy, std::size_t max_buckets):
+            m_relative_accuracy(std::clamp(relative_accuracy, 1e-6, 0.5)),
+            m_gamma((1.0 + m_relative_accuracy) / (1.0 - m_relative_accuracy)),
+            m_inverse_log_gamma(1.0 / std::log(m_gamma)),
+            m_max_buckets(std::max<std::size_t>(max_buckets, 2))
+        {}
+
+        int FreeFallQuantileSketch::bucket_index(double value) const
+        {
+            return static_cast<int>(std::ceil(std::log(value) * m_inverse_log_gamma));
+        }
+
+        void FreeFallQuantileSketch::add(double value)
+        {
+            ++m_count;
+            if (!(value > kMinValue))
+            {
+                ++m_zero_count;
+                return;
+            }
+            add_to_bucket(bucket_index(value), 1);
+        }
+
+        void FreeFallQuantileSketch::add_to_bucket(int index, std::uint64_t count)
+        {
+            if (m_buckets.empty())
+            {
+                m_first_index = index;
+                m_buckets.push_back(count);
+                return;
+            }
+            // values below the folded range land in the lowest bucket
+            index = std::max(index, m_first_index - static_cast<int>(m_max_buckets - m_buckets.size()));
+            if (index < m_first_index)
+            {
+                m_buckets.insert(m_buckets.begin(), static_cast<std::size_t>(m_first_index - index), 0);
+                m_first_index = index;
+            }
+            const auto offset = static_cast<std::size_t>(index - m_first_index);
+            if (offset >= m_buckets.size())
+                m_buckets.resize(offset + 1, 0);
+            m_buckets[offset] += count;
+            if (m_buckets.size() > m_max_buckets)
+                fold_lowest_buckets();
+        }
+
+        void FreeFallQuantileSketch::fold_lowest_buckets()
+        {
+            const auto excess = m_buckets.size() - m_max_buckets;
+            std::uint64_t folded{0};
+            for (std::size_t i = 0; i <= excess; ++i)
+                folded += m_buckets[i];
+            m_buckets.erase(m_buckets.begin(), m_buckets.begin() + static_cast<std::ptrdiff_t>(excess));
+            m_buckets.front() = folded;
+            m_first_index += static_cast<int>(excess);
+        }
+
+        void FreeFallQuantileSketch::merge(const FreeFallQuantileSketch& other)
+        {
+            if (other.m_relative_accuracy != m_relative_accuracy)
+                throw std::invalid_argument("FreeFallQuantileSketch: merging sketches of different relative accuracy");
+            m_count += other.m_count;
+            m_zero_count += other.m_zero_count;
+            for (std::size_t i = 0; i < other.m_buckets.size(); ++i)
+                if (other.m_buckets[i] > 0)
+                    add_to_bucket(other.m_first_index + static_cast<int>(i), other.m_buckets[i]);
+        }
+
+        double FreeFallQuantileSketch::quantile(double q) const
+        {
+            if (m_count == 0)
+                return 0.0;
+            const auto rank = static_cast<std::uint64_t>(std::clamp(q, 0.0, 1.0) * static_cast<double>(m_count - 1));
+            if (rank < m_zero_count)
+                return 0.0;
+            std::uint64_t seen{m_zero_count};
+            for (std::size_t i = 0; i < m_buckets.size(); ++i)
+            {
+                seen += m_buckets[i];
+                if (seen > rank)
+                    return 2.0 * std::pow(m_gamma, m_first_index + static_cast<int>(i)) / (m_gamma + 1.0);
+            }
+            return 2.0 * std::pow(m_gamma, m_first_index + static_cast<int>(m_buckets.size()) - 1) / (m_gamma + 1.0);
+        }
+
+        FreeFallTimeEnvelope::FreeFallTimeEnvelope(double bin_width, double end_time)
+        {
+            if (bin_width > 0.0 && end_time > 0.0)
+            {
+                m_bin_width = bin_width;
+                m_inverse_bin_width = 1.0 / bin_width;
+                m_bins.resize(static_cast<std::size_t>(end_time / bin_width + 0.5) + 1);
+            }
+        }
+
+        void FreeFallTimeEnvelope::merge(const FreeFallTimeEnvelope& other)
+        {
+            if (other.m_bins.empty())
+                return;
+            if (m_bins.empty())
+            {
+                *this = other;
+                return;
+            }
+            if (other.m_bin_width != m_bin_width || other.m_bins.size() != m_bins.size())
+                throw std::invalid_argument("FreeFallTimeEnvelope: merging envelopes of different bins");
+            for (std::size_t i = 0; i < m_bins.size(); ++i)
+            {
+                m_bins[i].position.merge(other.m_bins[i].position);
+                m_bins[i].velocity.merge(other.m_bins[i].velocity);
+            }
+        }
+}
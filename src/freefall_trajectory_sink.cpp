@@ -0,0 +1,210 @@
+
+#include "freefall_trajectory_sink.h"
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+namespace FreeFallSim
+{
+    namespace
+    {
+        struct BinaryTrajectoryHeader
+        {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t block_capacity;
+            std::uint64_t sample_count;
+            std::uint64_t reserved;
+        };
+
+        constexpr std::size_t kIoBufferBytes{1 << 20};
+    }
+
+        void FreeFallColumnarSink::begin(std::size_t expected_samples)
+        {
+            if (expected_samples == 0)
+                return;
+            const auto reserve = m_sim_plot_vars.time_data.size() + expected_samples;
+            m_sim_plot_vars.time_data.reserve(reserve);
+            m_sim_plot_vars.position_data.reserve(reserve);
+            m_sim_plot_vars.velocity_data.reserve(reserve);
+            m_sim_plot_vars.netforce_data.reserve(reserve);
+        }
+
+        std::size_t FreeFallColumnarSink::buffered_bytes() const
+        {
+            return (m_sim_plot_vars.time_data.capacity() + m_sim_plot_vars.position_data.capacity() +
+                m_sim_plot_vars.velocity_data.capacity() + m_sim_plot_vars.netforce_data.capacity()) * sizeof(double);
+        }
+
+        FreeFallRingBufferSink::FreeFallRingBufferSink(std::size_t capacity):
+            m_time(std::max<std::size_t>(capacity, 1)), m_position(m_time.size()),
+            m_velocity(m_time.size()), m_net_force(m_time.size())
+        {}
+
+        std::size_t FreeFallRingBufferSink::size() const
+        {
+            return m_total_samples < m_time.size() ? static_cast<std::size_t>(m_total_samples) : m_time.size();
+        }
+
+        FreeFallSimPlot FreeFallRingBufferSink::to_plot() const
+        {
+            FreeFallSimPlot sim_plot_vars;
+            const auto count = size();
+            // once wrapped around the oldest sample sits at the write position
+            const auto oldest = count < m_time.size() ? 0 : m_next;
+            sim_plot_vars.time_data.reserve(count);
+            sim_plot_vars.position_data.reserve(count);
+            sim_plot_vars.velocity_data.reserve(count);
+            sim_plot_vars.netforce_data.reserve(count);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const auto slot = (oldest + i) % m_time.size();
+                sim_plot_vars.time_data.emplace_back(m_time[slot]);
+                sim_plot_vars.position_data.emplace_back(m_position[slot]);
+                sim_plot_vars.velocity_data.emplace_back(m_velocity[slot]);
+                sim_plot_vars.netforce_data.emplace_back(m_net_force[slot]);
+            }
+            return sim_plot_vars;
+        }
+
+        void FreeFallConsoleSink::write(double time, double position, double velocity, double net_force)
+        {
+            // same format the hard-wired console print used, velocity printed positive while falling
+            m_output<< "Time: "<< time<< " ";
+            m_output<< "Height: "<< position<< " ";
+            m_output<< "NetForce: "<< round_to(net_force, 0.0001) << " ";
+            m_output<< "Velocity: "<< round_to(-velocity, 0.001)<< " \n";
+        }
+
+        void FreeFallConsoleSink::event(const FreeFallEvent& event)
+        {
+            static constexpr const char* kEventNames[] = {"GroundImpact", "HeightReached", "NetForceZero"};
+            m_output<< "Event: "<< kEventNames[static_cast<int>(event.kind)]<< " ";
+            m_output<< "Time: "<< event.time<< " ";
+            m_output<< "Height: "<< event.position<< " ";
+            m_output<< "Velocity: "<< round_to(-event.velocity, 0.001)<< " \n";
+        }
+
+        FreeFallBinaryFileSink::FreeFallBinaryFileSink(const std::string& path, std::size_t block_capacity):
+            m_io_buffer(kIoBufferBytes),
+            m_block_capacity(std::clamp<std::size_t>(block_capacity, 1, std::numeric_limits<std::uint32_t>::max()))
+        {
+            m_file = std::fopen(path.c_str(), "wb");
+            if (m_file == nullptr)
+                throw std::runtime_error("FreeFallBinaryFileSink: can not open " + path);
+            std::setvbuf(m_file, m_io_buffer.data(), _IOFBF, m_io_buffer.size());
+            m_time.reserve(m_block_capacity);
+            m_position.reserve(m_block_capacity);
+            m_velocity.reserve(m_block_capacity);
+            m_net_force.reserve(m_block_capacity);
+            write_header();
+        }
+
+        FreeFallBinaryFileSink::~FreeFallBinaryFileSink()
+        {
+            if (!m_finished)
+            {
+                try
+                {
+                    end();
+                }
+                catch (...)
+                {
+                    // destructor must not throw, a truncated file fails to load instead
+                }
+            }
+            if (m_file != nullptr)
+                std::fclose(m_file);
+        }
+
+        std::size_t FreeFallBinaryFileSink::buffered_bytes() const
+        {
+            // staged block plus the stdio buffer
+            return 4 * m_block_capacity * sizeof(double) + m_io_buffer.size();
+        }
+
+        void FreeFallBinaryFileSink::write_header()
+        {
+            BinaryTrajectoryHeader header{};
+            std::memcpy(header.magic, kMagic, sizeof(kMagic));
+            header.version = kVersion;
+            header.block_capacity = static_cast<std::uint32_t>(m_block_capacity);
+            header.sample_count = m_sample_count;
+            if (std::fwrite(&header, sizeof(header), 1, m_file) != 1)
+                throw std::runtime_error("FreeFallBinaryFileSink: header write failed");
+        }
+
+        void FreeFallBinaryFileSink::flush_block()
+        {
+            const std::uint64_t count = m_time.size();
+            if (count == 0)
+                return;
+            bool written = std::fwrite(&count, sizeof(count), 1, m_file) == 1;
+            for (const auto* column : {&m_time, &m_position, &m_velocity, &m_net_force})
+                written = written && std::fwrite(column->data(), sizeof(double), count, m_file) == count;
+            if (!written)
+                throw std::runtime_error("FreeFallBinaryFileSink: block write failed");
+            m_sample_count += count;
+            m_time.clear();
+            m_position.clear();
+            m_velocity.clear();
+            m_net_force.clear();
+        }
+
+        void FreeFallBinaryFileSink::end()
+        {
+            if (m_finished)
+                return;
+            m_finished = true;
+            flush_block();
+            if (std::fseek(m_file, 0, SEEK_SET) != 0)
+                throw std::runtime_error("FreeFallBinaryFileSink: seek failed");
+            write_header();
+            if (std::fflush(m_file) != 0)
+                throw std::runtime_error("FreeFallBinaryFileSink: flush failed");
+        }
+
+        FreeFallSimPlot read_binary_trajectory(const std::string& path)
+        {
+            std::unique_ptr<std::FILE, int (*)(std::FILE*)> file{std::fopen(path.c_str(), "rb"), &std::fclose};
+            if (!file)
+                throw std::runtime_error("read_binary_trajectory: can not open " + path);
+            BinaryTrajectoryHeader header{};
+            if (std::fread(&header, sizeof(header), 1, file.get()) != 1 ||
+                std::memcmp(header.magic, FreeFallBinaryFileSink::kMagic, sizeof(header.magic)) != 0 ||
+                header.version != FreeFallBinaryFileSink::kVersion)
+                throw std::runtime_error("read_binary_trajectory: not a trajectory file " + path);
+
+            // the header is not trusted with the allocation, every sample takes 4 doubles of the file
+            std::error_code error;
+            const auto file_size = std::filesystem::file_size(path, error);
+            const auto max_samples = error || file_size < sizeof(header) ? 0 : (file_size - sizeof(header)) / (4 * sizeof(double));
+            if (header.sample_count > max_samples)
+                throw std::runtime_error("read_binary_trajectory: sample count larger than the file " + path);
+
+            FreeFallSimPlot sim_plot_vars;
+            const auto total = static_cast<std::size_t>(header.sample_count);
+            for (auto* column : {&sim_plot_vars.time_data, &sim_plot_vars.position_data, &sim_plot_vars.velocity_data, &sim_plot_vars.netforce_data})
+                column->reserve(total);
+
+            std::uint64_t count{0};
+            while (std::fread(&count, sizeof(count), 1, file.get()) == 1)
+            {
+                if (count > header.block_capacity || count > total - sim_plot_vars.time_data.size())
+                    throw std::runtime_error("read_binary_trajectory: corrupt block in " + path);
+                for (auto* column : {&sim_plot_vars.time_data, &sim_plot_vars.position_data, &sim_plot_vars.velocity_data, &sim_plot_vars.netforce_data})
+                {
+                    const auto offset = column->size();
+                    column->resize(offset + count);
+                    if (std::fread(column->data() + offset, sizeof(double), count, file.get()) != count)
+                        throw std::runtime_error("read_binary_trajectory: truncated block in " + path);
+                }
+            }
+            if (sim_plot_vars.time_data.size() != total)
+                throw std::runtime_error("read_binary_trajectory: sample count mismatch in " + path);
+            return sim_plot_vars;
+        }
+}
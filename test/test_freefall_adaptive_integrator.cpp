@@ -0,0 +1,88 @@
+#include "freefall_dragforce_simulation.h"
+#include "freefall_demo_profiles.h"
+#include <gtest/gtest.h>
+#include <cmath>
+
+class FreeFallAdaptiveIntegratorTest: public ::testing::Test
+{
+    protected:
+    void SetUp() override
+    {
+        freefall_sim_obj = FreeFallSim::make_demo_ball_profile();
+        freefall_sim_vars = FreeFallSim::make_demo_sim_vars();
+    }
+
+    double terminal_velocity() const
+    {
+        const auto area = M_PI * std::pow(freefall_sim_obj.radius_of_object, 2);
+        return std::sqrt(freefall_sim_obj.mass_of_object * freefall_sim_vars.gravity_acceleration /
+            (freefall_sim_obj.kDragCoefficient * freefall_sim_obj.fluid_density_air * area));
+    }
+
+    FreeFallSim::FreeFallObjProfile freefall_sim_obj;
+    FreeFallSim::FreeFallSimulationProfile freefall_sim_vars;
+};
+
+TEST_F(FreeFallAdaptiveIntegratorTest, GivenDormandPrinceConstGravityReachesTerminalVelocityWithFewSteps)
+{
+    auto fixed_vars = freefall_sim_vars;
+    FreeFallSim::FreeFallConstGravitySimlation fixed_sim{freefall_sim_obj, fixed_vars, FreeFallSim::FreeFallSimPlot{}};
+    const auto fixed_plot = fixed_sim.run_sim();
+
+    auto adaptive_vars = freefall_sim_vars;
+    adaptive_vars.integrator = FreeFallSim::IntegratorProfile::DormandPrince45;
+    FreeFallSim::FreeFallConstGravitySimlation adaptive_sim{freefall_sim_obj, adaptive_vars, FreeFallSim::FreeFallSimPlot{}};
+    const auto adaptive_plot = adaptive_sim.run_sim();
+
+    ASSERT_FALSE(adaptive_plot.velocity_data.empty());
+    EXPECT_NEAR(-adaptive_plot.velocity_data.back(), terminal_velocity(), 1e-3 * terminal_velocity());
+    // the ground crossing is located inside the last step
+    EXPECT_DOUBLE_EQ(adaptive_plot.position_data.back(), 0.0);
+    EXPECT_LT(adaptive_plot.integrator_stats.steps_taken * 10, fixed_plot.integrator_stats.steps_taken);
+    // the step grows while the drop accelerates, at the default tolerances that overreaches a few times at most
+    EXPECT_LE(adaptive_plot.integrator_stats.steps_rejected * 5, adaptive_plot.integrator_stats.steps_taken);
+
+    // released at terminal velocity the solution is a straight line and no step is ever retried
+    adaptive_vars.velocity = terminal_velocity();
+    FreeFallSim::FreeFallConstGravitySimlation steady_sim{freefall_sim_obj, adaptive_vars, FreeFallSim::FreeFallSimPlot{}};
+    const auto steady_plot = steady_sim.run_sim();
+    EXPECT_EQ(steady_plot.integrator_stats.steps_rejected, 0u);
+    EXPECT_DOUBLE_EQ(steady_plot.position_data.back(), 0.0);
+}
+
+TEST_F(FreeFallAdaptiveIntegratorTest, GivenTightToleranceAndLargeFirstStepDormandPrinceRejectsSteps)
+{
+    freefall_sim_vars.integrator = FreeFallSim::IntegratorProfile::DormandPrince45;
+    freefall_sim_vars.time_step = 5.0;
+    freefall_sim_vars.abs_tolerance = 1e-10;
+    freefall_sim_vars.rel_tolerance = 1e-10;
+    FreeFallSim::FreeFallConstGravitySimlation adaptive_sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    const auto adaptive_plot = adaptive_sim.run_sim();
+
+    EXPECT_GT(adaptive_plot.integrator_stats.steps_rejected, 0u);
+    EXPECT_LT(adaptive_plot.integrator_stats.steps_rejected, adaptive_plot.integrator_stats.steps_taken);
+    // the rejected tries do not cost accuracy
+    EXPECT_DOUBLE_EQ(adaptive_plot.position_data.back(), 0.0);
+    EXPECT_NEAR(-adaptive_plot.velocity_data.back(), terminal_velocity(), 1e-3 * terminal_velocity());
+}
+
+TEST_F(FreeFallAdaptiveIntegratorTest, GivenDormandPrinceNewtonGravityMatchesFineFixedStepWith40mHeight)
+{
+    freefall_sim_vars.position = 40;
+    auto fine_vars = freefall_sim_vars;
+    fine_vars.time_step = 1e-4;
+    fine_vars.sample_factor = 1;
+    FreeFallSim::FreeFallNewtonGravitySimlation fine_sim{freefall_sim_obj, fine_vars, FreeFallSim::FreeFallSimPlot{}};
+    const auto fine_plot = fine_sim.run_sim();
+
+    auto adaptive_vars = freefall_sim_vars;
+    adaptive_vars.integrator = FreeFallSim::IntegratorProfile::DormandPrince45;
+    adaptive_vars.abs_tolerance = 1e-9;
+    adaptive_vars.rel_tolerance = 1e-9;
+    FreeFallSim::FreeFallNewtonGravitySimlation adaptive_sim{freefall_sim_obj, adaptive_vars, FreeFallSim::FreeFallSimPlot{}};
+    const auto adaptive_plot = adaptive_sim.run_sim();
+
+    ASSERT_FALSE(adaptive_plot.velocity_data.empty());
+    EXPECT_NEAR(adaptive_plot.velocity_data.back(), fine_plot.velocity_data.back(), 1e-3);
+    EXPECT_GT(adaptive_plot.integrator_stats.wall_time_s, 0.0);
+}
@@ -0,0 +1,111 @@
+#include "freefall_analytic_solution.h"
+#include "freefall_demo_profiles.h"
+#include <gtest/gtest.h>
+#include <cmath>
+
+class FreeFallAnalyticSolutionTest: public ::testing::Test
+{
+    protected:
+    void SetUp() override
+    {
+        freefall_sim_obj = FreeFallSim::make_demo_ball_profile();
+        freefall_sim_vars = FreeFallSim::make_demo_sim_vars();
+    }
+
+    // Reference impact from the adaptive integrator at a tight tolerance
+    FreeFallSim::FreeFallSimPlot adaptive_reference() const
+    {
+        auto adaptive_vars = freefall_sim_vars;
+        adaptive_vars.integrator = FreeFallSim::IntegratorProfile::DormandPrince45;
+        adaptive_vars.abs_tolerance = 1e-11;
+        adaptive_vars.rel_tolerance = 1e-11;
+        FreeFallSim::FreeFallConstGravitySimlation adaptive_sim{freefall_sim_obj, adaptive_vars, FreeFallSim::FreeFallSimPlot{}};
+        return adaptive_sim.run_sim();
+    }
+
+    FreeFallSim::FreeFallObjProfile freefall_sim_obj;
+    FreeFallSim::FreeFallSimulationProfile freefall_sim_vars;
+};
+
+TEST_F(FreeFallAnalyticSolutionTest, GivenDropFromRestStateMatchesAdaptiveIntegrator)
+{
+    const FreeFallSim::FreeFallConstGravityAnalytic analytic{freefall_sim_obj, freefall_sim_vars};
+    const auto reference = adaptive_reference();
+    for (std::size_t i = 0; i < reference.time_data.size(); ++i)
+    {
+        const auto state = analytic.state_at(reference.time_data[i]);
+        EXPECT_NEAR(state.position, reference.position_data[i], 1e-6);
+        EXPECT_NEAR(-state.velocity, reference.velocity_data[i], 1e-6);
+    }
+    const auto impact = analytic.impact();
+    EXPECT_NEAR(impact.velocity, -reference.velocity_data.back(), 1e-5);
+    EXPECT_NEAR(impact.velocity, analytic.terminal_velocity(), 1e-3 * analytic.terminal_velocity());
+}
+
+TEST_F(FreeFallAnalyticSolutionTest, GivenHeightTimeToHeightInvertsStateAt)
+{
+    const FreeFallSim::FreeFallConstGravityAnalytic analytic{freefall_sim_obj, freefall_sim_vars};
+    for (const auto height : {399.0, 350.0, 100.0, 1.0, 0.0})
+    {
+        const auto time = analytic.time_to_height(height);
+        ASSERT_TRUE(time.has_value());
+        EXPECT_NEAR(analytic.state_at(*time).position, height, 1e-9);
+    }
+    EXPECT_FALSE(analytic.time_to_height(401.0).has_value());
+}
+
+TEST_F(FreeFallAnalyticSolutionTest, GivenStartAboveTerminalVelocitySlowsDownToTerminalVelocity)
+{
+    freefall_sim_vars.velocity = 60.0;
+    const FreeFallSim::FreeFallConstGravityAnalytic analytic{freefall_sim_obj, freefall_sim_vars};
+    const auto reference = adaptive_reference();
+    const auto impact = analytic.impact();
+    EXPECT_NEAR(impact.velocity, -reference.velocity_data.back(), 1e-5);
+    EXPECT_NEAR(impact.time, reference.time_data.back(), 1e-5);
+    EXPECT_GT(impact.velocity, analytic.terminal_velocity());
+}
+
+TEST_F(FreeFallAnalyticSolutionTest, GivenUpwardThrowObjectRisesToApexBeforeFalling)
+{
+    freefall_sim_vars.velocity = -15.0;
+    const FreeFallSim::FreeFallConstGravityAnalytic analytic{freefall_sim_obj, freefall_sim_vars};
+    const auto rise_time = analytic.time_to_height(405.0);
+    ASSERT_TRUE(rise_time.has_value());
+    EXPECT_LT(analytic.state_at(*rise_time).velocity, 0.0);
+    EXPECT_NEAR(analytic.state_at(*rise_time).position, 405.0, 1e-9);
+    // passes the release height again on the way down, slower than it was thrown because of drag
+    const auto fall_time = analytic.time_to_height(399.999);
+    ASSERT_TRUE(fall_time.has_value());
+    EXPECT_GT(*fall_time, *rise_time);
+    EXPECT_LT(analytic.state_at(*fall_time).velocity, 15.0);
+    EXPECT_FALSE(analytic.time_to_height(500.0).has_value());
+}
+
+TEST_F(FreeFallAnalyticSolutionTest, GivenUpwardThrowClosedFormRunSimMatchesFixedStep)
+{
+    // the engine's k*v^2 drag does not turn with the motion, the closed form is only used for descents
+    freefall_sim_vars.velocity = -15.0;
+    FreeFallSim::FreeFallConstGravitySimlation fixed_step_sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    const auto fixed_plot = fixed_step_sim.run_sim();
+    freefall_sim_vars.integrator = FreeFallSim::IntegratorProfile::ClosedForm;
+    FreeFallSim::FreeFallConstGravitySimlation closed_form_sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    const auto closed_plot = closed_form_sim.run_sim();
+
+    EXPECT_GT(closed_plot.integrator_stats.steps_taken, 0u);
+    EXPECT_EQ(closed_plot.time_data, fixed_plot.time_data);
+    EXPECT_EQ(closed_plot.position_data, fixed_plot.position_data);
+    EXPECT_EQ(closed_plot.velocity_data, fixed_plot.velocity_data);
+}
+
+TEST_F(FreeFallAnalyticSolutionTest, GivenClosedFormRunSimSamplesEveryHeightMultiple)
+{
+    freefall_sim_vars.integrator = FreeFallSim::IntegratorProfile::ClosedForm;
+    FreeFallSim::FreeFallConstGravitySimlation closed_form_sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    const auto sim_plot = closed_form_sim.run_sim();
+    ASSERT_EQ(sim_plot.position_data.size(), 41u);
+    EXPECT_EQ(sim_plot.position_data.front(), 400.0);
+    EXPECT_EQ(sim_plot.position_data.back(), 0.0);
+    EXPECT_EQ(sim_plot.integrator_stats.steps_taken, 0u);
+    for (std::size_t i = 1; i < sim_plot.time_data.size(); ++i)
+        EXPECT_GT(sim_plot.time_data[i], sim_plot.time_data[i - 1]);
+}
@@ -0,0 +1,106 @@
+#include "freefall_atmosphere.h"
+#include "freefall_demo_profiles.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <random>
+
+class FreeFallAtmosphereTest: public ::testing::Test
+{
+    protected:
+    void SetUp() override
+    {
+        freefall_sim_obj = FreeFallSim::make_demo_ball_profile();
+        freefall_sim_obj.fluid_density_air = 1.225;
+        freefall_sim_vars = FreeFallSim::make_demo_sim_vars();
+        freefall_sim_vars.position = 100;
+        freefall_sim_vars.time_step = 0.001;
+    }
+
+    FreeFallSim::FreeFallObjProfile freefall_sim_obj;
+    FreeFallSim::FreeFallSimulationProfile freefall_sim_vars;
+};
+
+TEST_F(FreeFallAtmosphereTest, GivenStandardAtmosphereDensityMatchesThe1976Tables)
+{
+    // geometric height in m, density in kg/m^3 from the published US Standard Atmosphere 1976 tables
+    const std::vector<std::pair<double, double>> published{{0.0, 1.2250}, {10000.0, 4.1351e-1}, {20000.0, 8.8910e-2},
+        {30000.0, 1.8410e-2}, {50000.0, 1.0269e-3}, {80000.0, 1.8458e-5}};
+    for (const auto& [height, density] : published)
+        EXPECT_NEAR(FreeFallSim::us_standard_atmosphere_density(height) / density, 1.0, 1e-3) << height;
+
+    // clamped outside the modelled range
+    EXPECT_DOUBLE_EQ(FreeFallSim::us_standard_atmosphere_density(-50.0), FreeFallSim::us_standard_atmosphere_density(0.0));
+    EXPECT_DOUBLE_EQ(FreeFallSim::us_standard_atmosphere_density(1e6),
+        FreeFallSim::us_standard_atmosphere_density_geopotential(FreeFallSim::kStandardAtmosphereTop));
+}
+
+TEST_F(FreeFallAtmosphereTest, GivenTablesInterpolationStaysWithinTheFittedTolerance)
+{
+    const auto& density_table = FreeFallSim::standard_atmosphere_density_table();
+    const auto gravity_table = FreeFallSim::make_newton_gravity_table(freefall_sim_vars, 40000.0);
+    auto newton_gravity = [this](double position)
+    {
+        auto sim_vars = freefall_sim_vars;
+        sim_vars.position = position;
+        return FreeFallSim::newton_gravitational_force(freefall_sim_obj, sim_vars) / freefall_sim_obj.mass_of_object;
+    };
+
+    std::mt19937_64 generator{11};
+    std::uniform_real_distribution<double> height{0.0, 40000.0};
+    std::vector<double> heights(1000);
+    for (auto& value : heights)
+        value = height(generator);
+    std::vector<double> geopotentials(heights.size());
+    for (std::size_t i = 0; i < heights.size(); ++i)
+        geopotentials[i] = FreeFallSim::geopotential_height(heights[i]);
+    std::vector<double> densities(heights.size());
+    density_table.evaluate(geopotentials.data(), densities.data(), geopotentials.size());
+    for (std::size_t i = 0; i < heights.size(); ++i)
+    {
+        EXPECT_NEAR(densities[i] / FreeFallSim::us_standard_atmosphere_density(heights[i]), 1.0, FreeFallSim::kDensityTableTolerance);
+        EXPECT_DOUBLE_EQ(densities[i], FreeFallSim::tabulated_standard_atmosphere_density(heights[i]));
+        EXPECT_NEAR(gravity_table(heights[i]) / newton_gravity(heights[i]), 1.0, FreeFallSim::kGravityTableTolerance);
+    }
+
+    // end values are held outside the range
+    EXPECT_DOUBLE_EQ(FreeFallSim::tabulated_standard_atmosphere_density(-10.0), FreeFallSim::tabulated_standard_atmosphere_density(0.0));
+    EXPECT_NEAR(FreeFallSim::tabulated_standard_atmosphere_density(1e6) / FreeFallSim::us_standard_atmosphere_density(1e6), 1.0,
+        FreeFallSim::kDensityTableTolerance);
+    EXPECT_NEAR(gravity_table(50000.0) / gravity_table(40000.0), 1.0, 1e-12);
+}
+
+TEST_F(FreeFallAtmosphereTest, GivenLowDropAtmosphereModelsMatchNewtonAtSeaLevelDensity)
+{
+    // 100 m above sea level the density drops by ~1%, the impact speed follows its square root
+    FreeFallSim::FreeFallNewtonGravitySimlation newton_sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    FreeFallSim::FreeFallNewtonAtmosphereSimlation atmosphere_sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    FreeFallSim::FreeFallTabulatedAtmosphereSimlation tabulated_sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    const auto newton_plot = newton_sim.run_sim();
+    const auto atmosphere_plot = atmosphere_sim.run_sim();
+    const auto tabulated_plot = tabulated_sim.run_sim();
+
+    EXPECT_NEAR(atmosphere_plot.velocity_data.back() / newton_plot.velocity_data.back(), 1.0, 5e-3);
+    EXPECT_LT(atmosphere_plot.time_data.back(), newton_plot.time_data.back());
+    EXPECT_NEAR(tabulated_plot.time_data.back(), atmosphere_plot.time_data.back(), 1e-6);
+    EXPECT_NEAR(tabulated_plot.velocity_data.back(), atmosphere_plot.velocity_data.back(), 1e-6);
+}
+
+TEST_F(FreeFallAtmosphereTest, GivenHighDropThinAirRaisesTheTerminalVelocity)
+{
+    freefall_sim_vars.position = 30000;
+    freefall_sim_vars.time_step = 0.01;
+    FreeFallSim::FreeFallNewtonGravitySimlation newton_sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    FreeFallSim::FreeFallTabulatedAtmosphereSimlation tabulated_sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    const auto newton_plot = newton_sim.run_sim();
+    const auto tabulated_plot = tabulated_sim.run_sim();
+
+    // at 30 km the air is ~66 times thinner, the fastest speed scales with its inverse square root
+    auto max_speed = [](const FreeFallSim::FreeFallSimPlot& sim_plot)
+    {
+        return -*std::min_element(sim_plot.velocity_data.begin(), sim_plot.velocity_data.end());
+    };
+    EXPECT_GT(max_speed(tabulated_plot), 4.0 * max_speed(newton_plot));
+    EXPECT_LT(tabulated_plot.time_data.back(), newton_plot.time_data.back());
+    // back in the dense air near the ground it slows down towards the sea level terminal velocity
+    EXPECT_NEAR(tabulated_plot.velocity_data.back() / newton_plot.velocity_data.back(), 1.0, 0.05);
+}
@@ -0,0 +1,215 @@
+#include "freefall_batch.h"
+#include "freefall_bounded_queue.h"
+#include "freefall_demo_profiles.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+class FreeFallBatchTest: public ::testing::Test
+{
+    protected:
+    void SetUp() override
+    {
+        defaults.sim_obj_profile = FreeFallSim::make_demo_ball_profile();
+        defaults.sim_freefall_vars = FreeFallSim::make_demo_sim_vars();
+        defaults.sim_freefall_vars.position = 100;
+    }
+
+    // count scenarios of varying height, mass and gravity model as CSV
+    static std::string make_csv(std::size_t count)
+    {
+        std::string text{"id,gravity,position,mass\n"};
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            text += "drop" + std::to_string(i) + "," + (i % 3 == 0 ? "newton" : "constant") + "," +
+                std::to_string(5 + (i * 37) % 400) + "," + std::to_string(0.03 + 0.01 * static_cast<double>(i % 7)) + "\n";
+        }
+        return text;
+    }
+
+    FreeFallSim::FreeFallScenario defaults;
+};
+
+TEST_F(FreeFallBatchTest, GivenCsvScenariosReaderAppliesColumnsOverDefaults)
+{
+    const std::string text{"id, gravity ,position,time_step,locate_impact\n"
+                           "\n"
+                           "# comment lines are skipped\n"
+                           "\"ball, small\",newton,250,0.001,false\n"
+                           "plain,constant,,,\n"};
+    FreeFallSim::FreeFallScenarioReader reader{text, FreeFallSim::FreeFallScenarioFormat::Csv, defaults};
+    FreeFallSim::FreeFallScenario scenario;
+
+    ASSERT_TRUE(reader.next(scenario));
+    EXPECT_EQ(scenario.index, 0u);
+    EXPECT_EQ(scenario.id, "ball, small");
+    EXPECT_EQ(scenario.gravity_profile, FreeFallSim::GravityProfile::NewtonGravitationModel);
+    EXPECT_DOUBLE_EQ(scenario.sim_freefall_vars.position, 250.0);
+    EXPECT_FLOAT_EQ(scenario.sim_freefall_vars.time_step, 0.001f);
+    EXPECT_FALSE(scenario.sim_freefall_vars.locate_impact);
+    EXPECT_DOUBLE_EQ(scenario.sim_obj_profile.mass_of_object, 0.0577);
+
+    ASSERT_TRUE(reader.next(scenario));
+    EXPECT_EQ(scenario.index, 1u);
+    EXPECT_EQ(scenario.id, "plain");
+    EXPECT_EQ(scenario.gravity_profile, FreeFallSim::GravityProfile::ConstantGravity);
+    EXPECT_DOUBLE_EQ(scenario.sim_freefall_vars.position, 100.0);
+    EXPECT_TRUE(scenario.sim_freefall_vars.locate_impact);
+    EXPECT_EQ(reader.line_number(), 5u);
+    EXPECT_FALSE(reader.next(scenario));
+}
+
+TEST_F(FreeFallBatchTest, GivenJsonLinesScenariosReaderParsesFlatObjects)
+{
+    const std::string text{"{\"id\": \"a \\\"quoted\\\" id\", \"mass\": 0.5, \"integrator\": \"dormand_prince45\", \"sample_factor\": 5}\n"
+                           "{}\n"
+                           "{\"radius\": null, \"steady_state_fast_forward\": true}"};
+    FreeFallSim::FreeFallScenarioReader reader{text, FreeFallSim::FreeFallScenarioFormat::JsonLines, defaults};
+    FreeFallSim::FreeFallScenario scenario;
+
+    ASSERT_TRUE(reader.next(scenario));
+    EXPECT_EQ(scenario.id, "a \"quoted\" id");
+    EXPECT_DOUBLE_EQ(scenario.sim_obj_profile.mass_of_object, 0.5);
+    EXPECT_EQ(scenario.sim_freefall_vars.integrator, FreeFallSim::IntegratorProfile::DormandPrince45);
+    EXPECT_EQ(scenario.sim_freefall_vars.sample_factor, 5);
+    ASSERT_TRUE(reader.next(scenario));
+    EXPECT_EQ(scenario.id, "");
+    EXPECT_DOUBLE_EQ(scenario.sim_obj_profile.mass_of_object, 0.0577);
+    ASSERT_TRUE(reader.next(scenario));
+    EXPECT_DOUBLE_EQ(scenario.sim_obj_profile.radius_of_object, 0.06661/2);
+    EXPECT_TRUE(scenario.sim_freefall_vars.steady_state_fast_forward);
+    EXPECT_FALSE(reader.next(scenario));
+
+    EXPECT_EQ(FreeFallSim::scenario_format_from_path("runs/drops.jsonl"), FreeFallSim::FreeFallScenarioFormat::JsonLines);
+    EXPECT_EQ(FreeFallSim::scenario_format_from_path("runs/drops.csv"), FreeFallSim::FreeFallScenarioFormat::Csv);
+}
+
+TEST_F(FreeFallBatchTest, GivenMalformedRecordsReaderThrowsNamingTheLine)
+{
+    EXPECT_THROW((FreeFallSim::FreeFallScenarioReader{"id,colour\n", FreeFallSim::FreeFallScenarioFormat::Csv}), std::invalid_argument);
+
+    const auto expect_error_on_line_2 = [this](const std::string& text, FreeFallSim::FreeFallScenarioFormat format)
+    {
+        FreeFallSim::FreeFallScenarioReader reader{text, format, defaults};
+        FreeFallSim::FreeFallScenario scenario;
+        try
+        {
+            while (reader.next(scenario))
+            {}
+            ADD_FAILURE() << "no error for " << text;
+        }
+        catch (const std::invalid_argument& error)
+        {
+            EXPECT_EQ(std::string(error.what()).rfind("line 2:", 0), 0u) << error.what();
+        }
+    };
+    expect_error_on_line_2("id,position\nx,12m\n", FreeFallSim::FreeFallScenarioFormat::Csv);
+    expect_error_on_line_2("id,position\nx,1,2\n", FreeFallSim::FreeFallScenarioFormat::Csv);
+    expect_error_on_line_2("id,gravity\nx,moon\n", FreeFallSim::FreeFallScenarioFormat::Csv);
+    expect_error_on_line_2("{\"id\":\"a\"}\n{\"colour\":\"red\"}\n", FreeFallSim::FreeFallScenarioFormat::JsonLines);
+    expect_error_on_line_2("{}\n{\"mass\":0.1\n", FreeFallSim::FreeFallScenarioFormat::JsonLines);
+}
+
+TEST_F(FreeFallBatchTest, GivenClosedBoundedQueuePopDrainsThenStops)
+{
+    FreeFallSim::FreeFallBoundedQueue<int> queue{2};
+    std::thread producer{[&queue]()
+    {
+        for (int i = 0; i < 100; ++i)
+            ASSERT_TRUE(queue.push(i));
+        queue.close();
+    }};
+    int expected{0};
+    while (auto item = queue.pop())
+        EXPECT_EQ(*item, expected++);
+    producer.join();
+    EXPECT_EQ(expected, 100);
+    EXPECT_FALSE(queue.push(100));
+}
+
+TEST_F(FreeFallBatchTest, GivenManyScenariosBatchOutputIsOrderedAndIndependentOfThreads)
+{
+    const auto text = make_csv(1000);
+    FreeFallSim::FreeFallBatchOptions options;
+    options.defaults = defaults;
+    options.chunk_size = 7;
+    options.queue_capacity = 2;
+
+    std::string reference;
+    for (const std::size_t workers : {1, 3})
+    {
+        options.worker_count = workers;
+        std::ostringstream summaries;
+        const auto report = FreeFallSim::run_batch(text, FreeFallSim::FreeFallScenarioFormat::Csv, options, summaries);
+        EXPECT_EQ(report.scenarios, 1000u);
+        EXPECT_EQ(report.landed, 1000u);
+        EXPECT_LE(report.max_chunks_in_flight, FreeFallSim::chunks_in_flight_limit(options));
+        if (reference.empty())
+            reference = summaries.str();
+        else
+            EXPECT_EQ(summaries.str(), reference);
+    }
+
+    // header plus one line per scenario, in file order, matching a direct run
+    std::istringstream lines{reference};
+    std::string line;
+    std::getline(lines, line);
+    EXPECT_EQ(line + "\n", FreeFallSim::kScenarioSummaryCsvHeader);
+    FreeFallSim::FreeFallScenarioReader reader{text, FreeFallSim::FreeFallScenarioFormat::Csv, defaults};
+    FreeFallSim::FreeFallScenario scenario;
+    while (reader.next(scenario))
+    {
+        ASSERT_TRUE(std::getline(lines, line));
+        std::string expected;
+        FreeFallSim::append_summary_csv(expected, FreeFallSim::simulate_scenario(scenario));
+        EXPECT_EQ(line + "\n", expected);
+    }
+    EXPECT_FALSE(std::getline(lines, line));
+}
+
+TEST_F(FreeFallBatchTest, GivenTrajectoryOutputBatchWritesEverySampleOfMappedFile)
+{
+    const auto path = std::filesystem::temp_directory_path() / ("freefall_batch_" + std::to_string(::getpid()) + ".jsonl");
+    {
+        std::ofstream file{path};
+        file << "{\"id\":\"a\",\"position\":50}\n{\"id\":\"b\",\"position\":20,\"gravity\":\"newton\"}\n";
+    }
+    FreeFallSim::FreeFallBatchOptions options;
+    options.defaults = defaults;
+    options.worker_count = 2;
+    options.json_summaries = true;
+    std::ostringstream summaries;
+    std::ostringstream trajectories;
+    const auto report = FreeFallSim::run_batch(path.string(), options, summaries, &trajectories);
+    std::filesystem::remove(path);
+
+    EXPECT_EQ(report.scenarios, 2u);
+    const auto summary_text = summaries.str();
+    EXPECT_EQ(summary_text.find("{\"index\":0,\"id\":\"a\",\"landed\":true"), 0u);
+    EXPECT_NE(summary_text.find("\n{\"index\":1,\"id\":\"b\""), std::string::npos);
+
+    const auto trajectory_text = trajectories.str();
+    EXPECT_EQ(trajectory_text.rfind(FreeFallSim::kTrajectoryCsvHeader, 0), 0u);
+    const auto rows = static_cast<std::uint64_t>(std::count(trajectory_text.begin(), trajectory_text.end(), '\n')) - 1;
+    EXPECT_EQ(rows, report.trajectory_samples);
+    EXPECT_GT(rows, 2u);
+    // scenario 0 rows come before scenario 1 rows
+    EXPECT_LT(trajectory_text.find("\n0,"), trajectory_text.find("\n1,"));
+    EXPECT_EQ(trajectory_text.find("\n0,", trajectory_text.find("\n1,")), std::string::npos);
+}
+
+TEST_F(FreeFallBatchTest, GivenBadRecordBatchRethrowsTheParseError)
+{
+    auto text = make_csv(500);
+    text += "late,constant,ten,0.1\n";
+    FreeFallSim::FreeFallBatchOptions options;
+    options.defaults = defaults;
+    options.worker_count = 2;
+    options.chunk_size = 16;
+    std::ostringstream summaries;
+    EXPECT_THROW(FreeFallSim::run_batch(text, FreeFallSim::FreeFallScenarioFormat::Csv, options, summaries), std::invalid_argument);
+    EXPECT_THROW(FreeFallSim::run_batch(std::string{"/nonexistent/scenarios.csv"}, options, summaries), std::runtime_error);
+}
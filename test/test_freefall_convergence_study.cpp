@@ -0,0 +1,196 @@
+#include "freefall_convergence_study.h"
+#include "freefall_analytic_solution.h"
+#include "freefall_batch.h"
+#include "freefall_demo_profiles.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <sstream>
+
+class FreeFallConvergenceStudyTest: public ::testing::Test
+{
+    protected:
+    void SetUp() override
+    {
+        freefall_sim_obj = FreeFallSim::make_demo_ball_profile();
+        freefall_sim_vars = FreeFallSim::make_demo_sim_vars();
+        freefall_sim_vars.position = 20;
+        freefall_sim_vars.time_step = 0.1;
+        freefall_sim_vars.sample_factor = 1;
+    }
+
+    FreeFallSim::FreeFallObjProfile freefall_sim_obj;
+    FreeFallSim::FreeFallSimulationProfile freefall_sim_vars;
+};
+
+TEST_F(FreeFallConvergenceStudyTest, GivenSecondOrderSeriesOrderAndExtrapolationAreExact)
+{
+    // q(h) = 3 + 2*h^2 at h = 0.4, 0.2, 0.1
+    const auto order = FreeFallSim::observed_order(3.32, 3.08, 3.02);
+    EXPECT_NEAR(order, 2.0, 1e-9);
+    EXPECT_NEAR(FreeFallSim::richardson_extrapolate(3.08, 3.02, order), 3.0, 1e-12);
+
+    EXPECT_TRUE(std::isinf(FreeFallSim::observed_order(1.5, 1.0, 1.0)));
+    EXPECT_TRUE(std::isnan(FreeFallSim::observed_order(1.0, 1.0, 1.0)));
+    // growing differences are outside the asymptotic range
+    EXPECT_TRUE(std::isnan(FreeFallSim::observed_order(1.0, 1.1, 1.5)));
+    EXPECT_EQ(FreeFallSim::richardson_extrapolate(1.1, 1.5, std::numeric_limits<double>::quiet_NaN()), 1.5);
+}
+
+TEST_F(FreeFallConvergenceStudyTest, GivenFixedStepStudyRecommendsLargestStepMeetingTolerance)
+{
+    FreeFallSim::FreeFallConvergenceProfile convergence;
+    convergence.rel_tolerance = 1e-3;
+    const auto result = FreeFallSim::run_convergence_study(FreeFallSim::GravityProfile::ConstantGravity, freefall_sim_obj,
+        freefall_sim_vars, convergence);
+
+    ASSERT_TRUE(result.converged);
+    ASSERT_GE(result.levels.size(), 3u);
+    EXPECT_EQ(result.levels.front().time_step, 0.1f);
+    EXPECT_EQ(result.levels[1].time_step, 0.05f);
+    // the FixedStep update is first order
+    EXPECT_NEAR(result.impact_time.observed_order, 1.0, 0.05);
+    EXPECT_NEAR(result.impact_velocity.observed_order, 1.0, 0.05);
+
+    // extrapolated and recommended values against the closed form drop
+    const FreeFallSim::FreeFallConstGravityAnalytic analytic{freefall_sim_obj, freefall_sim_vars};
+    const auto impact = analytic.impact();
+    EXPECT_NEAR(result.impact_time.extrapolated, impact.time, 1e-4 * impact.time);
+    EXPECT_NEAR(result.impact_velocity.extrapolated, std::abs(impact.velocity), 1e-4 * std::abs(impact.velocity));
+
+    const auto& recommended = result.levels[result.recommended_level];
+    EXPECT_EQ(result.recommended_time_step, recommended.time_step);
+    EXPECT_TRUE(recommended.meets_tolerance);
+    EXPECT_LE(std::abs(recommended.impact_time - impact.time), 1.1e-3 * impact.time);
+    EXPECT_LE(std::abs(recommended.impact_velocity - std::abs(impact.velocity)), 1.1e-3 * std::abs(impact.velocity));
+    // every larger step misses the tolerance and the study stopped at the first level meeting it
+    for (std::size_t i = 0; i < result.recommended_level; ++i)
+        EXPECT_FALSE(result.levels[i].meets_tolerance);
+    EXPECT_EQ(result.recommended_level + 1, result.levels.size());
+    for (std::size_t i = 1; i < result.levels.size(); ++i)
+        EXPECT_GT(result.levels[i].steps, result.levels[i - 1].steps);
+    // 20 m is too short to get within 1e-3 of the weight, only the impact is judged
+    EXPECT_FALSE(result.terminal_reached);
+    EXPECT_TRUE(std::isnan(recommended.terminal_time));
+    EXPECT_TRUE(std::isnan(result.terminal_velocity.extrapolated));
+}
+
+TEST_F(FreeFallConvergenceStudyTest, GivenLongDropTerminalStateConvergesOnItsOwn)
+{
+    freefall_sim_vars.position = 400;
+    freefall_sim_vars.time_step = 0.05;
+    FreeFallSim::FreeFallConvergenceProfile convergence;
+    convergence.rel_tolerance = 1e-3;
+    const auto result = FreeFallSim::run_convergence_study(FreeFallSim::GravityProfile::ConstantGravity, freefall_sim_obj,
+        freefall_sim_vars, convergence);
+
+    ASSERT_TRUE(result.converged);
+    ASSERT_TRUE(result.terminal_reached);
+    // |F| = eps*W at v = vt*sqrt(1 - eps), reached well before the impact and not equal to the impact values
+    const FreeFallSim::FreeFallConstGravityAnalytic analytic{freefall_sim_obj, freefall_sim_vars};
+    const auto terminal_velocity = analytic.terminal_velocity() * std::sqrt(1.0 - convergence.net_force_epsilon);
+    EXPECT_NEAR(result.terminal_velocity.extrapolated, terminal_velocity, 1e-3 * terminal_velocity);
+    EXPECT_LT(result.terminal_time.extrapolated, 0.5 * result.impact_time.extrapolated);
+    EXPECT_NE(result.levels.front().terminal_velocity, result.levels.front().impact_velocity);
+    EXPECT_NEAR(result.terminal_time.observed_order, 1.0, 0.1);
+
+    // released above terminal velocity the drag slows the ball down to the same state
+    freefall_sim_vars.velocity = 60;
+    const auto slowed = FreeFallSim::run_convergence_study(FreeFallSim::GravityProfile::ConstantGravity, freefall_sim_obj,
+        freefall_sim_vars, convergence);
+    ASSERT_TRUE(slowed.terminal_reached);
+    EXPECT_NEAR(slowed.terminal_velocity.extrapolated, analytic.terminal_velocity() * std::sqrt(1.0 + convergence.net_force_epsilon),
+        1e-3 * terminal_velocity);
+    EXPECT_GT(slowed.terminal_time.extrapolated, 0.0);
+}
+
+TEST_F(FreeFallConvergenceStudyTest, GivenAdaptiveIntegratorStudyKeepsTheFirstStep)
+{
+    freefall_sim_vars.position = 400;
+    freefall_sim_vars.integrator = FreeFallSim::IntegratorProfile::DormandPrince45;
+    const auto result = FreeFallSim::run_convergence_study(FreeFallSim::GravityProfile::NewtonGravitationModel, freefall_sim_obj,
+        freefall_sim_vars);
+
+    // the error control already holds the quantities well inside 1e-3 at any first step
+    ASSERT_TRUE(result.converged);
+    EXPECT_EQ(result.levels.size(), 3u);
+    EXPECT_EQ(result.recommended_time_step, 0.1f);
+    ASSERT_TRUE(result.terminal_reached);
+    EXPECT_LT(result.terminal_time.extrapolated, result.impact_time.extrapolated);
+    EXPECT_NEAR(result.terminal_velocity.extrapolated, result.impact_velocity.extrapolated, 1e-3 * result.impact_velocity.extrapolated);
+}
+
+TEST_F(FreeFallConvergenceStudyTest, GivenBadProfilesStudyThrows)
+{
+    FreeFallSim::FreeFallConvergenceProfile convergence;
+    convergence.min_levels = 2;
+    EXPECT_THROW(FreeFallSim::run_convergence_study(FreeFallSim::GravityProfile::ConstantGravity, freefall_sim_obj, freefall_sim_vars,
+        convergence), std::invalid_argument);
+    convergence.min_levels = 3;
+    convergence.max_levels = 10;
+
+    auto no_step = freefall_sim_vars;
+    no_step.time_step = 0.0f;
+    EXPECT_THROW(FreeFallSim::run_convergence_study(FreeFallSim::GravityProfile::ConstantGravity, freefall_sim_obj, no_step,
+        convergence), std::invalid_argument);
+
+    auto short_run = freefall_sim_vars;
+    short_run.finish_time = 1;
+    EXPECT_THROW(FreeFallSim::run_convergence_study(FreeFallSim::GravityProfile::ConstantGravity, freefall_sim_obj, short_run,
+        convergence), std::runtime_error);
+}
+
+TEST_F(FreeFallConvergenceStudyTest, GivenTimeStepStudyBatchWritesOneRowPerScenario)
+{
+    FreeFallSim::FreeFallBatchOptions options;
+    options.defaults.sim_obj_profile = freefall_sim_obj;
+    options.defaults.sim_freefall_vars = freefall_sim_vars;
+    options.worker_count = 2;
+    options.time_step_study = true;
+    options.convergence.rel_tolerance = 1e-2;
+    // the second scenario stops after 1 s, 100 m up
+    const std::string text{"id,position,finish_time\nlow,10,1000\nshort,100,1\nhigh,100,1000\n"};
+
+    std::ostringstream rows;
+    const auto report = FreeFallSim::run_batch(text, FreeFallSim::FreeFallScenarioFormat::Csv, options, rows);
+    EXPECT_EQ(report.scenarios, 3u);
+    EXPECT_EQ(report.landed, 2u);
+
+    std::istringstream lines{rows.str()};
+    std::string line;
+    ASSERT_TRUE(std::getline(lines, line));
+    EXPECT_EQ(line + "\n", FreeFallSim::kConvergenceCsvHeader);
+    FreeFallSim::FreeFallScenarioReader reader{text, FreeFallSim::FreeFallScenarioFormat::Csv, options.defaults};
+    FreeFallSim::FreeFallScenario scenario;
+    while (reader.next(scenario))
+    {
+        ASSERT_TRUE(std::getline(lines, line));
+        std::string expected;
+        FreeFallSim::FreeFallConvergenceResult result;
+        if (scenario.id == "short")
+        {
+            EXPECT_EQ(line.rfind("1,short,0,0,nan,0,0,nan,nan,nan,nan,", 0), 0u);
+            EXPECT_THROW(FreeFallSim::run_convergence_study(scenario.gravity_profile, scenario.sim_obj_profile,
+                scenario.sim_freefall_vars, options.convergence), std::runtime_error);
+        }
+        else
+        {
+            result = FreeFallSim::run_convergence_study(scenario.gravity_profile, scenario.sim_obj_profile,
+                scenario.sim_freefall_vars, options.convergence);
+        }
+        FreeFallSim::append_convergence_csv(expected, scenario, result);
+        // wall times differ between runs but are not part of the row
+        EXPECT_EQ(line + "\n", expected);
+    }
+    EXPECT_FALSE(std::getline(lines, line));
+
+    options.json_summaries = true;
+    std::ostringstream json_rows;
+    FreeFallSim::run_batch(text, FreeFallSim::FreeFallScenarioFormat::Csv, options, json_rows);
+    EXPECT_EQ(json_rows.str().find("{\"index\":0,\"id\":\"low\",\"converged\":true,\"landed\":true,\"recommended_time_step\":"), 0u);
+    EXPECT_NE(json_rows.str().find("{\"index\":1,\"id\":\"short\",\"converged\":false,\"landed\":false,\"recommended_time_step\":null,"
+        "\"levels\":0,\"steps\":0,\"impact_time\":null,"), std::string::npos);
+
+    std::ostringstream trajectories;
+    EXPECT_THROW(FreeFallSim::run_batch(text, FreeFallSim::FreeFallScenarioFormat::Csv, options, rows, &trajectories),
+        std::invalid_argument);
+}
@@ -0,0 +1,131 @@
+#include "freefall_ensemble_simulation.h"
+#include "freefall_demo_profiles.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+class FreeFallEnsembleSimulationTest: public ::testing::Test
+{
+    protected:
+    void SetUp() override
+    {
+        freefall_sim_obj = FreeFallSim::make_demo_ball_profile();
+        freefall_sim_vars = FreeFallSim::make_demo_sim_vars();
+        freefall_sim_vars.sample_factor = 1; // every step is sampled so the last sample is the impact state
+        freefall_sim_vars.locate_impact = false; // the ensemble reports the state after the crossing step
+    }
+
+    // Varies height and mass over a few profiles, odd count so SIMD lanes are left partially filled
+    std::vector<std::pair<FreeFallSim::FreeFallObjProfile, FreeFallSim::FreeFallSimulationProfile>> make_profiles() const
+    {
+        std::vector<std::pair<FreeFallSim::FreeFallObjProfile, FreeFallSim::FreeFallSimulationProfile>> profiles;
+        const double heights[] = {40, 400, 5, 120, 0, 250, 1000, 75, 33, 400, 10};
+        auto mass = 0.03;
+        for (const auto height : heights)
+        {
+            auto obj = freefall_sim_obj;
+            obj.mass_of_object = mass;
+            auto vars = freefall_sim_vars;
+            vars.position = height;
+            profiles.emplace_back(obj, vars);
+            mass += 0.01;
+        }
+        return profiles;
+    }
+
+    FreeFallSim::FreeFallObjProfile freefall_sim_obj;
+    FreeFallSim::FreeFallSimulationProfile freefall_sim_vars;
+};
+
+TEST_F(FreeFallEnsembleSimulationTest, GivenMixedProfilesConstGravityEnsembleMatchesScalarRunSim)
+{
+    const auto profiles = make_profiles();
+    FreeFallSim::FreeFallEnsembleSimulation ensemble{FreeFallSim::GravityProfile::ConstantGravity};
+    for (const auto& [obj, vars] : profiles)
+        ensemble.add_object(obj, vars);
+    const auto result = ensemble.run_sim();
+
+    for (std::size_t i = 0; i < profiles.size(); ++i)
+    {
+        FreeFallSim::FreeFallConstGravitySimlation scalar_sim{profiles[i].first, profiles[i].second, FreeFallSim::FreeFallSimPlot{}};
+        const auto plot = scalar_sim.run_sim();
+        ASSERT_EQ(result.steps[i], plot.velocity_data.size());
+        if (plot.velocity_data.empty())
+            continue;
+        const auto tolerance = FreeFallSim::FreeFallEnsembleSimulation::kEnsembleRelativeTolerance;
+        EXPECT_NEAR(result.impact_velocity[i], -plot.velocity_data.back(), tolerance * std::abs(plot.velocity_data.back()));
+        EXPECT_NEAR(result.impact_height[i], plot.position_data.back(), 1e-6);
+    }
+    EXPECT_GT(result.total_object_steps, 0u);
+    EXPECT_GT(result.object_steps_per_second, 0.0);
+}
+
+TEST_F(FreeFallEnsembleSimulationTest, GivenMixedProfilesNewtonGravityEnsembleMatchesScalarRunSim)
+{
+    const auto profiles = make_profiles();
+    FreeFallSim::FreeFallEnsembleSimulation ensemble{FreeFallSim::GravityProfile::NewtonGravitationModel};
+    for (const auto& [obj, vars] : profiles)
+        ensemble.add_object(obj, vars);
+    const auto result = ensemble.run_sim();
+
+    for (std::size_t i = 0; i < profiles.size(); ++i)
+    {
+        FreeFallSim::FreeFallNewtonGravitySimlation scalar_sim{profiles[i].first, profiles[i].second, FreeFallSim::FreeFallSimPlot{}};
+        const auto plot = scalar_sim.run_sim();
+        ASSERT_EQ(result.steps[i], plot.velocity_data.size());
+        if (plot.velocity_data.empty())
+            continue;
+        const auto tolerance = FreeFallSim::FreeFallEnsembleSimulation::kEnsembleRelativeTolerance;
+        EXPECT_NEAR(result.impact_velocity[i], -plot.velocity_data.back(), tolerance * std::abs(plot.velocity_data.back()));
+        EXPECT_NEAR(result.impact_height[i], plot.position_data.back(), 1e-6);
+    }
+}
+
+TEST_F(FreeFallEnsembleSimulationTest, GivenMixedProfilesFloatEnsembleStaysWithinOneStepOfDoubleEnsemble)
+{
+    const auto profiles = make_profiles();
+    FreeFallSim::FreeFallEnsembleSimulation reference_ensemble{FreeFallSim::GravityProfile::ConstantGravity};
+    FreeFallSim::FreeFallFloatEnsembleSimulation float_ensemble{FreeFallSim::GravityProfile::ConstantGravity};
+    EXPECT_TRUE(float_ensemble.compensated());
+    EXPECT_FALSE(reference_ensemble.compensated());
+    for (const auto& [obj, vars] : profiles)
+    {
+        reference_ensemble.add_object(obj, vars);
+        float_ensemble.add_object(obj, vars);
+    }
+    const auto reference = reference_ensemble.run_sim();
+    const auto single = float_ensemble.run_sim();
+
+    ASSERT_EQ(single.steps.size(), profiles.size());
+    for (std::size_t i = 0; i < profiles.size(); ++i)
+    {
+        EXPECT_LE(std::abs(static_cast<double>(single.steps[i]) - static_cast<double>(reference.steps[i])), 1.0);
+        EXPECT_NEAR(single.impact_velocity[i], reference.impact_velocity[i], 1e-5 * std::abs(reference.impact_velocity[i]) + 1e-6);
+    }
+    EXPECT_GE(FreeFallSim::FreeFallFloatEnsembleSimulation::simd_lanes(), FreeFallSim::FreeFallEnsembleSimulation::simd_lanes());
+}
+
+TEST_F(FreeFallEnsembleSimulationTest, GivenStandardProfilesCompensatedFloatEnsembleMeetsErrorBudget)
+{
+    const auto profiles = FreeFallSim::standard_precision_profiles();
+    for (const auto gravity_profile : {FreeFallSim::GravityProfile::ConstantGravity, FreeFallSim::GravityProfile::NewtonGravitationModel})
+    {
+        const auto error = FreeFallSim::measure_float_ensemble_error(gravity_profile, profiles);
+        EXPECT_LE(error.max_impact_step_difference, FreeFallSim::kFloatImpactStepBudget);
+        EXPECT_LE(error.max_impact_velocity_error, FreeFallSim::kFloatImpactVelocityBudget);
+        EXPECT_LE(error.mean_impact_velocity_error, error.max_impact_velocity_error);
+        EXPECT_GT(error.float_object_steps_per_second, 0.0);
+    }
+}
+
+TEST_F(FreeFallEnsembleSimulationTest, GivenStandardProfilesUncompensatedFloatEnsembleDriftsOnLongDrops)
+{
+    const auto profiles = FreeFallSim::standard_precision_profiles();
+    const auto plain = FreeFallSim::measure_float_ensemble_error(FreeFallSim::GravityProfile::ConstantGravity, profiles, false);
+    const auto compensated = FreeFallSim::measure_float_ensemble_error(FreeFallSim::GravityProfile::ConstantGravity, profiles, true);
+    EXPECT_GT(plain.max_impact_step_difference, FreeFallSim::kFloatImpactStepBudget);
+    EXPECT_GT(plain.max_impact_time_error, compensated.max_impact_time_error);
+    EXPECT_GT(plain.max_impact_velocity_error, compensated.max_impact_velocity_error);
+    // the drift grows with the step count, the worst case is one of the 10 km drops
+    EXPECT_DOUBLE_EQ(profiles[plain.worst_impact_time_object].second.position, 10000.0);
+}
@@ -0,0 +1,127 @@
+#include "freefall_dragforce_simulation.h"
+#include "freefall_analytic_solution.h"
+#include "freefall_demo_profiles.h"
+#include <gtest/gtest.h>
+#include <cmath>
+
+class FreeFallEventsTest: public ::testing::Test
+{
+    protected:
+    void SetUp() override
+    {
+        freefall_sim_obj = FreeFallSim::make_demo_ball_profile();
+        freefall_sim_vars = FreeFallSim::make_demo_sim_vars();
+    }
+
+    static const FreeFallSim::FreeFallEvent* find_event(const FreeFallSim::FreeFallSimPlot& sim_plot, FreeFallSim::FreeFallEventKind kind,
+        double position = std::nan(""))
+    {
+        for (const auto& event : sim_plot.events)
+        {
+            if (event.kind == kind && (std::isnan(position) || event.position == position))
+                return &event;
+        }
+        return nullptr;
+    }
+
+    FreeFallSim::FreeFallObjProfile freefall_sim_obj;
+    FreeFallSim::FreeFallSimulationProfile freefall_sim_vars;
+};
+
+TEST_F(FreeFallEventsTest, GivenFixedStepImpactIsLocatedInsideTheLastStep)
+{
+    FreeFallSim::FreeFallConstGravitySimlation const_gravity_sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    const auto sim_plot = const_gravity_sim.run_sim();
+    const auto* impact = find_event(sim_plot, FreeFallSim::FreeFallEventKind::GroundImpact);
+    ASSERT_NE(impact, nullptr);
+
+    const double time_step = freefall_sim_vars.time_step;
+    const auto steps = sim_plot.integrator_stats.steps_taken;
+    EXPECT_DOUBLE_EQ(impact->position, 0.0);
+    EXPECT_GT(impact->time, (steps - 1) * time_step);
+    EXPECT_LE(impact->time, steps * time_step);
+    // only the first order drift of the scheme remains, not the up to one step overshoot
+    const FreeFallSim::FreeFallConstGravityAnalytic analytic{freefall_sim_obj, freefall_sim_vars};
+    EXPECT_NEAR(impact->time, analytic.impact().time, 0.5 * time_step);
+    EXPECT_NEAR(-impact->velocity, analytic.impact().velocity, 1e-3);
+}
+
+TEST_F(FreeFallEventsTest, GivenHeightAndNetForceEventsMatchClosedForm)
+{
+    constexpr double kNetForceEpsilon{1e-3};
+    freefall_sim_vars.event_heights = {300.0, 100.0, 500.0};
+    freefall_sim_vars.net_force_epsilon = kNetForceEpsilon;
+    const FreeFallSim::FreeFallConstGravityAnalytic analytic{freefall_sim_obj, freefall_sim_vars};
+    // |F| = m*g*(1 - v^2/vt^2) drops to epsilon*m*g at v = vt*sqrt(1 - epsilon)
+    const auto net_force_time = analytic.terminal_velocity() / freefall_sim_vars.gravity_acceleration *
+        std::atanh(std::sqrt(1.0 - kNetForceEpsilon));
+
+    for (const auto& [integrator, tolerance] : {std::pair{FreeFallSim::IntegratorProfile::DormandPrince45, 1e-5},
+        std::pair{FreeFallSim::IntegratorProfile::ClosedForm, 1e-9}})
+    {
+        auto sim_vars = freefall_sim_vars;
+        sim_vars.integrator = integrator;
+        sim_vars.abs_tolerance = 1e-10;
+        sim_vars.rel_tolerance = 1e-10;
+        FreeFallSim::FreeFallConstGravitySimlation const_gravity_sim{freefall_sim_obj, sim_vars, FreeFallSim::FreeFallSimPlot{}};
+        const auto sim_plot = const_gravity_sim.run_sim();
+
+        for (const auto height : {300.0, 100.0})
+        {
+            const auto* event = find_event(sim_plot, FreeFallSim::FreeFallEventKind::HeightReached, height);
+            ASSERT_NE(event, nullptr);
+            EXPECT_NEAR(event->time, *analytic.time_to_height(height), tolerance);
+        }
+        // never reached from a drop at 400 m
+        EXPECT_EQ(find_event(sim_plot, FreeFallSim::FreeFallEventKind::HeightReached, 500.0), nullptr);
+
+        const auto* net_force = find_event(sim_plot, FreeFallSim::FreeFallEventKind::NetForceZero);
+        ASSERT_NE(net_force, nullptr);
+        EXPECT_NEAR(net_force->time, net_force_time, 1e3 * tolerance);
+        EXPECT_NEAR(net_force->net_force, kNetForceEpsilon * freefall_sim_obj.mass_of_object * freefall_sim_vars.gravity_acceleration, 1e-6);
+
+        const auto* impact = find_event(sim_plot, FreeFallSim::FreeFallEventKind::GroundImpact);
+        ASSERT_NE(impact, nullptr);
+        EXPECT_NEAR(impact->time, analytic.impact().time, tolerance);
+    }
+}
+
+TEST_F(FreeFallEventsTest, GivenSteadyStateFastForwardHighDropTakesFewSteps)
+{
+    freefall_sim_vars.position = 40000;
+    freefall_sim_vars.sampling = FreeFallSim::SamplingProfile::TimeInterval;
+    freefall_sim_vars.sample_interval = 1.0;
+    freefall_sim_vars.event_heights = {1000.0};
+    auto fast_vars = freefall_sim_vars;
+    fast_vars.steady_state_fast_forward = true;
+
+    FreeFallSim::FreeFallConstGravitySimlation full_const{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    FreeFallSim::FreeFallConstGravitySimlation fast_const{freefall_sim_obj, fast_vars, FreeFallSim::FreeFallSimPlot{}};
+    FreeFallSim::FreeFallNewtonGravitySimlation full_newton{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    FreeFallSim::FreeFallNewtonGravitySimlation fast_newton{freefall_sim_obj, fast_vars, FreeFallSim::FreeFallSimPlot{}};
+    const std::pair<FreeFallSim::FreeFallSimPlot, FreeFallSim::FreeFallSimPlot> runs[] = {{full_const.run_sim(), fast_const.run_sim()},
+        {full_newton.run_sim(), fast_newton.run_sim()}};
+
+    for (const auto& [full_plot, fast_plot] : runs)
+    {
+        EXPECT_LT(fast_plot.integrator_stats.steps_taken * 20, full_plot.integrator_stats.steps_taken);
+        EXPECT_GT(fast_plot.integrator_stats.fast_forward_time, 0.0);
+        const auto* full_impact = find_event(full_plot, FreeFallSim::FreeFallEventKind::GroundImpact);
+        const auto* fast_impact = find_event(fast_plot, FreeFallSim::FreeFallEventKind::GroundImpact);
+        ASSERT_NE(full_impact, nullptr);
+        ASSERT_NE(fast_impact, nullptr);
+        EXPECT_NEAR(fast_impact->time, full_impact->time, 1e-6 * full_impact->time);
+        EXPECT_NEAR(fast_impact->velocity, full_impact->velocity, 1e-6 * std::abs(full_impact->velocity));
+
+        const auto* full_height = find_event(full_plot, FreeFallSim::FreeFallEventKind::HeightReached, 1000.0);
+        const auto* fast_height = find_event(fast_plot, FreeFallSim::FreeFallEventKind::HeightReached, 1000.0);
+        ASSERT_NE(full_height, nullptr);
+        ASSERT_NE(fast_height, nullptr);
+        EXPECT_NEAR(fast_height->time, full_height->time, 1e-6 * full_height->time);
+
+        // the time samples keep going through the jump
+        ASSERT_EQ(fast_plot.time_data.size(), full_plot.time_data.size());
+        for (std::size_t i = 0; i < fast_plot.time_data.size(); i += 100)
+            EXPECT_NEAR(fast_plot.position_data[i], full_plot.position_data[i], 1e-2);
+    }
+}
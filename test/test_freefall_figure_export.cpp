@@ -0,0 +1,128 @@
+#include "freefall_figure_export.h"
+#include "freefall_trajectory_sink.h"
+#include "freefall_demo_profiles.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <filesystem>
+#include <future>
+#include <map>
+#include <unistd.h>
+
+class FreeFallFigureExportTest: public ::testing::Test
+{
+    protected:
+    void SetUp() override
+    {
+        freefall_sim_obj = FreeFallSim::make_demo_ball_profile();
+        freefall_sim_vars = FreeFallSim::make_demo_sim_vars();
+        freefall_sim_vars.time_step = 0.001;
+        freefall_sim_vars.sample_factor = 1;
+        trajectory_path = std::filesystem::temp_directory_path() / ("freefall_figure_export_" + std::to_string(::getpid()) + ".fft");
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove(trajectory_path);
+    }
+
+    FreeFallSim::FreeFallSimPlot run_plot() const
+    {
+        FreeFallSim::FreeFallConstGravitySimlation sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+        return sim.run_sim();
+    }
+
+    FreeFallSim::FreeFallObjProfile freefall_sim_obj;
+    FreeFallSim::FreeFallSimulationProfile freefall_sim_vars;
+    std::filesystem::path trajectory_path;
+};
+
+TEST_F(FreeFallFigureExportTest, GivenRunMakeFigureLabelsAndDownsamplesTheQuantity)
+{
+    const auto sim_plot_vars = run_plot();
+    ASSERT_GT(sim_plot_vars.time_data.size(), 500u);
+
+    const auto velocity = FreeFallSim::make_figure(sim_plot_vars, FreeFallSim::FreeFallPlotQuantity::Velocity, 500);
+    EXPECT_EQ(velocity.title, "Time(s) vs Velocity(m/s)");
+    EXPECT_EQ(velocity.xlabel, "Time(s)");
+    EXPECT_EQ(velocity.ylabel, "Velocity(m/s)");
+    ASSERT_EQ(velocity.x.size(), 500u);
+    EXPECT_EQ(velocity.y.front(), sim_plot_vars.velocity_data.front());
+    EXPECT_EQ(velocity.y.back(), sim_plot_vars.velocity_data.back());
+
+    const auto force = FreeFallSim::make_figure(sim_plot_vars, FreeFallSim::FreeFallPlotQuantity::NetForce, 0);
+    EXPECT_EQ(force.ylabel, "NetForce(N)");
+    EXPECT_EQ(force.y, sim_plot_vars.netforce_data);
+    EXPECT_EQ(FreeFallSim::make_figure(sim_plot_vars, FreeFallSim::FreeFallPlotQuantity::Position).ylabel, "Position(m)");
+}
+
+TEST_F(FreeFallFigureExportTest, GivenSavedAndSharedTrajectoriesPoolRendersEveryJob)
+{
+    {
+        FreeFallSim::FreeFallNewtonGravitySimlation sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+        FreeFallSim::FreeFallBinaryFileSink file_sink{trajectory_path.string()};
+        sim.run_sim(file_sink);
+    }
+    const auto shared_plot = std::make_shared<const FreeFallSim::FreeFallSimPlot>(run_plot());
+
+    std::mutex rendered_mutex;
+    std::map<std::string, FreeFallSim::FreeFallFigure> rendered;
+    FreeFallSim::FreeFallFigureExportPool pool{[&](const FreeFallSim::FreeFallFigure& figure, const std::string& output_path)
+    {
+        std::lock_guard lock{rendered_mutex};
+        rendered.emplace(output_path, figure);
+    }, 3, 2};
+    EXPECT_EQ(pool.thread_count(), 3u);
+
+    for (int i = 0; i < 10; ++i)
+    {
+        FreeFallSim::FreeFallFigureJob job;
+        job.quantity = FreeFallSim::FreeFallPlotQuantity::Position;
+        job.output_path = "figure" + std::to_string(i) + ".svg";
+        if (i % 2 == 0)
+            job.trajectory_path = trajectory_path.string();
+        else
+            job.sim_plot_vars = shared_plot;
+        ASSERT_TRUE(pool.submit(std::move(job)));
+    }
+    FreeFallSim::FreeFallFigureJob missing;
+    missing.trajectory_path = "/nonexistent/run.fft";
+    missing.output_path = "missing.png";
+    ASSERT_TRUE(pool.submit(std::move(missing)));
+
+    const auto report = pool.wait();
+    EXPECT_EQ(report.rendered, 10u);
+    EXPECT_EQ(report.failed, 1u);
+    ASSERT_EQ(report.errors.size(), 1u);
+    EXPECT_EQ(report.errors.front().rfind("missing.png: ", 0), 0u);
+    ASSERT_EQ(rendered.size(), 10u);
+    EXPECT_EQ(rendered.at("figure0.svg").title, "Time(s) vs Position(m)");
+    EXPECT_EQ(rendered.at("figure1.svg").y.back(), shared_plot->position_data.back());
+    // a second wait starts a new tally
+    EXPECT_EQ(pool.wait().rendered, 0u);
+}
+
+TEST_F(FreeFallFigureExportTest, GivenBusyRenderersSubmitReturnsWithoutWaitingForThem)
+{
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::atomic<int> started{0};
+    FreeFallSim::FreeFallFigureExportPool pool{[&](const FreeFallSim::FreeFallFigure&, const std::string&)
+    {
+        ++started;
+        released.wait();
+    }, 1, 8};
+
+    const auto shared_plot = std::make_shared<const FreeFallSim::FreeFallSimPlot>(run_plot());
+    // every renderer is stuck, the jobs only have to fit into the queue
+    for (int i = 0; i < 8; ++i)
+    {
+        FreeFallSim::FreeFallFigureJob job;
+        job.sim_plot_vars = shared_plot;
+        job.output_path = std::to_string(i) + ".png";
+        ASSERT_TRUE(pool.submit(std::move(job)));
+    }
+    EXPECT_LE(started.load(), 1);
+    release.set_value();
+    EXPECT_EQ(pool.wait().rendered, 8u);
+    EXPECT_EQ(started.load(), 8);
+}
@@ -0,0 +1,136 @@
+#include "freefall_monte_carlo.h"
+#include "freefall_demo_profiles.h"
+#include <gtest/gtest.h>
+#include <cmath>
+
+class FreeFallMonteCarloTest: public ::testing::Test
+{
+    protected:
+    void SetUp() override
+    {
+        freefall_sim_obj = FreeFallSim::make_demo_ball_profile();
+        freefall_sim_obj.fluid_density_air = 1.225;
+        freefall_sim_vars = FreeFallSim::make_demo_sim_vars();
+        freefall_sim_vars.position = 100;
+        freefall_sim_vars.time_step = 0.001;
+        monte_carlo.sample_count = 2000;
+        monte_carlo.seed = 42;
+        monte_carlo.mass_of_object = FreeFallSim::FreeFallUncertainty::log_normal(0.0577, 0.05);
+        monte_carlo.radius_of_object = FreeFallSim::FreeFallUncertainty::normal(0.06661/2, 0.0005);
+        monte_carlo.drag_coefficient = FreeFallSim::FreeFallUncertainty::uniform(0.4, 0.55);
+        monte_carlo.fluid_density_air = FreeFallSim::FreeFallUncertainty::normal(1.225, 0.02);
+        monte_carlo.chunk_size = 64;
+    }
+
+    FreeFallSim::FreeFallObjProfile freefall_sim_obj;
+    FreeFallSim::FreeFallSimulationProfile freefall_sim_vars;
+    FreeFallSim::FreeFallMonteCarloProfile monte_carlo;
+};
+
+TEST_F(FreeFallMonteCarloTest, GivenPhiloxKnownAnswerTestsOutputMatchesTheReference)
+{
+    // known answer vectors of the Random123 distribution for philox4x32 with 10 rounds
+    using Philox = FreeFallSim::FreeFallPhilox4x32;
+    EXPECT_EQ(Philox::block({0, 0, 0, 0}, {0, 0}), (Philox::Counter{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+    EXPECT_EQ(Philox::block({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff}),
+        (Philox::Counter{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+    EXPECT_EQ(Philox::block({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0}),
+        (Philox::Counter{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}));
+    EXPECT_GT(Philox::uniform(0, 0), 0.0);
+    EXPECT_LT(Philox::uniform(0xffffffff, 0xffffffff), 1.0);
+}
+
+TEST_F(FreeFallMonteCarloTest, GivenSampleIndexDrawsDependOnlyOnSeedAndIndex)
+{
+    const auto first = FreeFallSim::draw_monte_carlo_profile(freefall_sim_obj, monte_carlo, 17);
+    const auto again = FreeFallSim::draw_monte_carlo_profile(freefall_sim_obj, monte_carlo, 17);
+    const auto next = FreeFallSim::draw_monte_carlo_profile(freefall_sim_obj, monte_carlo, 18);
+    EXPECT_EQ(first.mass_of_object, again.mass_of_object);
+    EXPECT_EQ(first.kDragCoefficient, again.kDragCoefficient);
+    EXPECT_NE(first.mass_of_object, next.mass_of_object);
+    EXPECT_GE(first.kDragCoefficient, 0.4);
+    EXPECT_LE(first.kDragCoefficient, 0.55);
+
+    // the parameters are drawn from their own streams, fixing one leaves the others unchanged
+    auto fixed_mass = monte_carlo;
+    fixed_mass.mass_of_object = {};
+    const auto other = FreeFallSim::draw_monte_carlo_profile(freefall_sim_obj, fixed_mass, 17);
+    EXPECT_EQ(other.mass_of_object, freefall_sim_obj.mass_of_object);
+    EXPECT_EQ(other.radius_of_object, first.radius_of_object);
+    EXPECT_EQ(other.fluid_density_air, first.fluid_density_air);
+
+    FreeFallSim::FreeFallWelford drag_coefficients;
+    for (std::uint64_t index = 0; index < 10000; ++index)
+        drag_coefficients.add(FreeFallSim::draw_monte_carlo_profile(freefall_sim_obj, monte_carlo, index).kDragCoefficient);
+    EXPECT_NEAR(drag_coefficients.mean(), 0.475, 0.005);
+    EXPECT_NEAR(drag_coefficients.stddev(), 0.15 / std::sqrt(12.0), 0.002);
+}
+
+TEST_F(FreeFallMonteCarloTest, GivenFixedParametersEveryRunMatchesTheSingleSimulation)
+{
+    FreeFallSim::FreeFallMonteCarloProfile fixed;
+    fixed.sample_count = 50;
+    FreeFallSim::FreeFallWorkStealingPool pool{2};
+    const auto result = FreeFallSim::run_monte_carlo(FreeFallSim::GravityProfile::ConstantGravity, freefall_sim_obj, freefall_sim_vars, fixed, pool);
+    FreeFallSim::FreeFallConstGravitySimlation sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    const auto sim_plot_vars = sim.run_sim();
+
+    EXPECT_EQ(result.sample_count, 50u);
+    EXPECT_EQ(result.landed_count, 50u);
+    EXPECT_DOUBLE_EQ(result.impact_time.mean(), sim_plot_vars.time_data.back());
+    EXPECT_EQ(result.impact_time.min(), result.impact_time.max());
+    EXPECT_DOUBLE_EQ(result.impact_speed.mean(), -sim_plot_vars.velocity_data.back());
+    EXPECT_NEAR(result.impact_time_quantiles.quantile(0.5) / sim_plot_vars.time_data.back(), 1.0, fixed.quantile_relative_accuracy);
+    EXPECT_EQ(result.envelope[0].position.count(), 50u);
+    EXPECT_DOUBLE_EQ(result.envelope[0].position.mean(), freefall_sim_vars.position);
+}
+
+TEST_F(FreeFallMonteCarloTest, GivenThreadCountsResultsAgree)
+{
+    FreeFallSim::FreeFallWorkStealingPool serial_pool{1};
+    FreeFallSim::FreeFallWorkStealingPool parallel_pool{3};
+    const auto serial = FreeFallSim::run_monte_carlo<FreeFallSim::FreeFallNewtonGravitySimlation>(freefall_sim_obj, freefall_sim_vars,
+        monte_carlo, serial_pool);
+    const auto parallel = FreeFallSim::run_monte_carlo<FreeFallSim::FreeFallNewtonGravitySimlation>(freefall_sim_obj, freefall_sim_vars,
+        monte_carlo, parallel_pool);
+
+    EXPECT_EQ(parallel.sample_count, monte_carlo.sample_count);
+    EXPECT_EQ(parallel.landed_count, serial.landed_count);
+    EXPECT_EQ(parallel.impact_time.min(), serial.impact_time.min());
+    EXPECT_EQ(parallel.impact_speed.max(), serial.impact_speed.max());
+    EXPECT_NEAR(parallel.impact_time.mean(), serial.impact_time.mean(), 1e-12);
+    EXPECT_NEAR(parallel.impact_speed.variance(), serial.impact_speed.variance(), 1e-9);
+    for (const auto q : {0.05, 0.5, 0.95})
+    {
+        EXPECT_EQ(parallel.impact_time_quantiles.quantile(q), serial.impact_time_quantiles.quantile(q));
+        EXPECT_EQ(parallel.impact_speed_quantiles.quantile(q), serial.impact_speed_quantiles.quantile(q));
+    }
+    ASSERT_EQ(parallel.envelope.size(), serial.envelope.size());
+    for (std::size_t bin = 0; bin < serial.envelope.size(); ++bin)
+        EXPECT_EQ(parallel.envelope[bin].velocity.count(), serial.envelope[bin].velocity.count());
+
+    // the spread of the inputs shows in the impact distribution, the quantiles are ordered
+    EXPECT_GT(serial.impact_time.stddev(), 0.0);
+    EXPECT_LT(serial.impact_time_quantiles.quantile(0.05), serial.impact_time_quantiles.quantile(0.95));
+    EXPECT_GE(serial.impact_time_quantiles.quantile(0.05), serial.impact_time.min() * (1.0 - monte_carlo.quantile_relative_accuracy));
+}
+
+TEST_F(FreeFallMonteCarloTest, GivenMoreSamplesMemoryStaysTheSame)
+{
+    FreeFallSim::FreeFallWorkStealingPool pool{2};
+    monte_carlo.envelope_end_time = 10.0;
+    monte_carlo.sample_count = 200;
+    const auto small = FreeFallSim::run_monte_carlo(FreeFallSim::GravityProfile::ConstantGravity, freefall_sim_obj, freefall_sim_vars,
+        monte_carlo, pool);
+    monte_carlo.sample_count = 4000;
+    const auto large = FreeFallSim::run_monte_carlo(FreeFallSim::GravityProfile::ConstantGravity, freefall_sim_obj, freefall_sim_vars,
+        monte_carlo, pool);
+
+    EXPECT_EQ(large.envelope.size(), small.envelope.size());
+    // only the sketches may grow, by the few buckets the wider sample reaches
+    EXPECT_LT(large.memory_bytes(), small.memory_bytes() + 4096);
+    // every run is in the air in the first bin, none after the latest impact
+    EXPECT_EQ(large.envelope[0].position.count(), 4000u);
+    const auto last_bin = static_cast<std::size_t>(large.impact_time.max() / large.envelope.bin_width() + 0.5);
+    EXPECT_EQ(large.envelope[last_bin + 1].position.count(), 0u);
+}
@@ -0,0 +1,80 @@
+#include "freefall_parallel_sweep.h"
+#include "freefall_demo_profiles.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+class FreeFallParallelSweepTest: public ::testing::Test
+{
+    protected:
+    void SetUp() override
+    {
+        grid.gravity_profile = FreeFallSim::GravityProfile::ConstantGravity;
+        grid.base_obj_profile = FreeFallSim::make_demo_ball_profile();
+        grid.base_sim_profile = FreeFallSim::make_demo_sim_vars();
+        grid.heights = {40, 400, 1000};
+        grid.drag_coefficients = {0.3, 0.47};
+    }
+
+    FreeFallSim::FreeFallSweepGrid grid;
+};
+
+TEST_F(FreeFallParallelSweepTest, GivenPoolEveryIndexRunsExactlyOnce)
+{
+    FreeFallSim::FreeFallWorkStealingPool pool{4};
+    std::vector<std::atomic<int>> visits(1000);
+    pool.parallel_for(visits.size(), [&](std::size_t index, std::size_t worker)
+    {
+        EXPECT_LT(worker, pool.thread_count());
+        ++visits[index];
+    });
+    for (const auto& visit : visits)
+        EXPECT_EQ(visit.load(), 1);
+}
+
+TEST_F(FreeFallParallelSweepTest, GivenThrowingTaskPoolRethrowsAfterCompletion)
+{
+    FreeFallSim::FreeFallWorkStealingPool pool{3};
+    std::atomic<int> finished{0};
+    EXPECT_THROW(pool.parallel_for(50, [&](std::size_t index, std::size_t)
+    {
+        if (index == 7)
+            throw std::runtime_error("task failed");
+        ++finished;
+    }), std::runtime_error);
+    EXPECT_EQ(finished.load(), 49);
+}
+
+TEST_F(FreeFallParallelSweepTest, GivenGridParallelSweepMatchesSerialVisitInInputOrder)
+{
+    const auto sim_models = FreeFallSim::expand_sweep_grid(grid);
+    ASSERT_EQ(sim_models.size(), 6u);
+
+    const auto sim_plots = FreeFallSim::run_parallel_sweep(sim_models, 4);
+    ASSERT_EQ(sim_plots.size(), sim_models.size());
+    for (std::size_t i = 0; i < sim_models.size(); ++i)
+    {
+        auto sim_model = sim_models[i];
+        const auto serial_plot = std::visit(FreeFallSim::Simulator{}, sim_model);
+        EXPECT_EQ(sim_plots[i].position_data, serial_plot.position_data);
+        EXPECT_EQ(sim_plots[i].velocity_data, serial_plot.velocity_data);
+    }
+}
+
+TEST_F(FreeFallParallelSweepTest, GivenThreadCountsScalingIsRelativeToTheFirst)
+{
+    const auto sim_models = FreeFallSim::expand_sweep_grid(grid);
+    const auto scaling = FreeFallSim::measure_sweep_scaling(sim_models, {1, 2, 4});
+    ASSERT_EQ(scaling.size(), 3u);
+    EXPECT_EQ(scaling[0].thread_count, 1u);
+    EXPECT_EQ(scaling[2].thread_count, 4u);
+    EXPECT_DOUBLE_EQ(scaling[0].speedup, 1.0);
+    EXPECT_DOUBLE_EQ(scaling[0].efficiency, 1.0);
+    for (const auto& entry : scaling)
+    {
+        EXPECT_GT(entry.wall_time_s, 0.0);
+        EXPECT_DOUBLE_EQ(entry.speedup, scaling[0].wall_time_s / entry.wall_time_s);
+        EXPECT_DOUBLE_EQ(entry.efficiency, entry.speedup / static_cast<double>(entry.thread_count));
+    }
+}
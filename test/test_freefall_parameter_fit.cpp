@@ -0,0 +1,146 @@
+#include "freefall_parameter_fit.h"
+#include "freefall_analytic_solution.h"
+#include "freefall_sim_engine.h"
+#include "freefall_demo_profiles.h"
+#include <gtest/gtest.h>
+#include <random>
+
+class FreeFallParameterFitTest: public ::testing::Test
+{
+    protected:
+    void SetUp() override
+    {
+        freefall_sim_obj = FreeFallSim::make_demo_ball_profile();
+        freefall_sim_obj.fluid_density_air = 1.225;
+        freefall_sim_vars = FreeFallSim::make_demo_sim_vars();
+        freefall_sim_vars.position = 100;
+    }
+
+    // heights of the closed form drop every 0.05 s until impact, with optional gaussian noise
+    FreeFallSim::FreeFallMeasuredDrop measure_drop(double noise = 0.0, unsigned seed = 1) const
+    {
+        const FreeFallSim::FreeFallConstGravityAnalytic analytic{freefall_sim_obj, freefall_sim_vars};
+        std::mt19937_64 generator{seed};
+        std::normal_distribution<double> error{0.0, noise};
+        FreeFallSim::FreeFallMeasuredDrop drop;
+        drop.initial_guess = freefall_sim_obj;
+        drop.initial_guess.kDragCoefficient = 0.2;
+        drop.sim_vars = freefall_sim_vars;
+        for (double time = 0.0; time < analytic.impact().time; time += 0.05)
+        {
+            drop.time_data.push_back(time);
+            drop.position_data.push_back(analytic.state_at(time).position + (noise > 0.0 ? error(generator) : 0.0));
+        }
+        return drop;
+    }
+
+    FreeFallSim::FreeFallObjProfile freefall_sim_obj;
+    FreeFallSim::FreeFallSimulationProfile freefall_sim_vars;
+};
+
+TEST_F(FreeFallParameterFitTest, GivenExactDropFitRecoversTheDragCoefficient)
+{
+    const auto drop = measure_drop();
+    const auto result = FreeFallSim::fit_drop(drop, FreeFallSim::FreeFallFitProfile{});
+
+    EXPECT_TRUE(result.converged);
+    EXPECT_NEAR(result.fitted.kDragCoefficient, 0.47, 1e-6);
+    EXPECT_EQ(result.fitted.mass_of_object, drop.initial_guess.mass_of_object);
+    EXPECT_LT(result.rms_residual, 1e-6);
+    EXPECT_LT(result.iterations, 20u);
+}
+
+TEST_F(FreeFallParameterFitTest, GivenNoisyDropFitIsWithinItsStandardDeviation)
+{
+    const auto drop = measure_drop(0.02, 7);
+    const auto result = FreeFallSim::fit_drop(drop, FreeFallSim::FreeFallFitProfile{});
+
+    EXPECT_TRUE(result.converged);
+    EXPECT_GT(result.drag_coefficient_stddev, 0.0);
+    EXPECT_LT(result.drag_coefficient_stddev, 0.01);
+    EXPECT_NEAR(result.fitted.kDragCoefficient, 0.47, 4.0 * result.drag_coefficient_stddev);
+    EXPECT_NEAR(result.rms_residual, 0.02, 0.005);
+}
+
+TEST_F(FreeFallParameterFitTest, GivenDragCoefficientAndMassFreeFitRecoversTheirRatio)
+{
+    auto drop = measure_drop(0.01, 3);
+    drop.initial_guess.mass_of_object = 0.08;
+    FreeFallSim::FreeFallFitProfile fit_profile;
+    fit_profile.parameters = FreeFallSim::kFitDragCoefficient | FreeFallSim::kFitMass;
+    const auto result = FreeFallSim::fit_drop(drop, fit_profile);
+    const auto drag_only = FreeFallSim::fit_drop(drop, FreeFallSim::FreeFallFitProfile{});
+
+    // only k = Cd*rho*pi*r^2/m shapes the drop, the split between Cd and m is undetermined
+    EXPECT_NEAR(result.fitted.kDragCoefficient / result.fitted.mass_of_object,
+        drag_only.fitted.kDragCoefficient / drag_only.fitted.mass_of_object, 1e-3);
+    EXPECT_NEAR(result.rms_residual, drag_only.rms_residual, 1e-6);
+    EXPECT_GT(result.mass_stddev, 10.0 * result.fitted.mass_of_object);
+}
+
+TEST_F(FreeFallParameterFitTest, GivenHighDropNewtonGravityFitMatchesTheAdaptiveRun)
+{
+    freefall_sim_vars.position = 10000;
+    freefall_sim_vars.integrator = FreeFallSim::IntegratorProfile::DormandPrince45;
+    freefall_sim_vars.abs_tolerance = 1e-10;
+    freefall_sim_vars.rel_tolerance = 1e-10;
+    freefall_sim_vars.sampling = FreeFallSim::SamplingProfile::TimeInterval;
+    freefall_sim_vars.sample_interval = 0.5;
+    FreeFallSim::FreeFallNewtonGravitySimlation sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    const auto sim_plot_vars = sim.run_sim();
+
+    FreeFallSim::FreeFallMeasuredDrop drop;
+    drop.initial_guess = freefall_sim_obj;
+    drop.initial_guess.kDragCoefficient = 1.0;
+    drop.sim_vars = freefall_sim_vars;
+    drop.sim_vars.time_step = 0.05;
+    drop.time_data = sim_plot_vars.time_data;
+    drop.position_data = sim_plot_vars.position_data;
+    FreeFallSim::FreeFallFitProfile fit_profile;
+    fit_profile.gravity_profile = FreeFallSim::GravityProfile::NewtonGravitationModel;
+    const auto result = FreeFallSim::fit_drop(drop, fit_profile);
+
+    EXPECT_TRUE(result.converged);
+    EXPECT_NEAR(result.fitted.kDragCoefficient, 0.47, 1e-5);
+}
+
+TEST_F(FreeFallParameterFitTest, GivenBatchOfDropsParallelFitsMatchSingleFits)
+{
+    std::vector<FreeFallSim::FreeFallMeasuredDrop> drops;
+    for (unsigned seed = 1; seed <= 8; ++seed)
+    {
+        freefall_sim_vars.position = 50.0 + 10.0 * seed;
+        drops.push_back(measure_drop(0.01, seed));
+    }
+    FreeFallSim::FreeFallWorkStealingPool pool{3};
+    const auto results = FreeFallSim::fit_drops(drops, FreeFallSim::FreeFallFitProfile{}, pool);
+
+    ASSERT_EQ(results.size(), drops.size());
+    FreeFallSim::FreeFallFitWorkspace workspace;
+    // the longest drop first, the buffers are then sized for all of them
+    for (std::size_t index = drops.size(); index-- > 0;)
+    {
+        const auto single = FreeFallSim::fit_drop(drops[index], FreeFallSim::FreeFallFitProfile{}, workspace);
+        EXPECT_EQ(results[index].fitted.kDragCoefficient, single.fitted.kDragCoefficient);
+        EXPECT_EQ(results[index].iterations, single.iterations);
+        EXPECT_NEAR(single.fitted.kDragCoefficient, 0.47, 0.05);
+    }
+    EXPECT_EQ(workspace.grow_count(), 1u);
+}
+
+TEST_F(FreeFallParameterFitTest, GivenMalformedSeriesFitThrows)
+{
+    auto drop = measure_drop();
+    drop.position_data.pop_back();
+    EXPECT_THROW(FreeFallSim::fit_drop(drop, FreeFallSim::FreeFallFitProfile{}), std::invalid_argument);
+    drop = measure_drop();
+    std::swap(drop.time_data[1], drop.time_data[2]);
+    EXPECT_THROW(FreeFallSim::fit_drop(drop, FreeFallSim::FreeFallFitProfile{}), std::invalid_argument);
+    drop.time_data.clear();
+    drop.position_data.clear();
+    EXPECT_THROW(FreeFallSim::fit_drop(drop, FreeFallSim::FreeFallFitProfile{}), std::invalid_argument);
+    // thrown upward the engine's drag law does not oppose the motion
+    drop = measure_drop();
+    drop.sim_vars.velocity = -5.0;
+    EXPECT_THROW(FreeFallSim::fit_drop(drop, FreeFallSim::FreeFallFitProfile{}), std::invalid_argument);
+}
@@ -0,0 +1,253 @@
+#include "freefall_result_cache.h"
+#include "freefall_parallel_sweep.h"
+#include "freefall_demo_profiles.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+class FreeFallResultCacheTest: public ::testing::Test
+{
+    protected:
+    void SetUp() override
+    {
+        freefall_sim_obj = FreeFallSim::make_demo_ball_profile();
+        freefall_sim_obj.fluid_density_air = 1.225;
+        freefall_sim_vars = FreeFallSim::make_demo_sim_vars();
+        freefall_sim_vars.position = 100;
+        freefall_sim_vars.time_step = 0.001;
+        cache_directory = std::filesystem::temp_directory_path() /
+            ("freefall_result_cache_" + std::to_string(::getpid()) + "_" + ::testing::UnitTest::GetInstance()->current_test_info()->name());
+        std::filesystem::remove_all(cache_directory);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(cache_directory);
+    }
+
+    FreeFallSim::FreeFallConstGravitySimlation make_sim(double position)
+    {
+        auto sim_vars = freefall_sim_vars;
+        sim_vars.position = position;
+        return FreeFallSim::FreeFallConstGravitySimlation{freefall_sim_obj, sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    }
+
+    FreeFallSim::FreeFallObjProfile freefall_sim_obj;
+    FreeFallSim::FreeFallSimulationProfile freefall_sim_vars;
+    std::filesystem::path cache_directory;
+};
+
+TEST_F(FreeFallResultCacheTest, GivenProfilesKeyChangesWithEveryTrajectoryField)
+{
+    const auto key = FreeFallSim::hash_profiles(freefall_sim_obj, freefall_sim_vars, "ConstantGravity+QuadraticDrag");
+    EXPECT_EQ(key, FreeFallSim::hash_profiles(freefall_sim_obj, freefall_sim_vars, "ConstantGravity+QuadraticDrag"));
+    EXPECT_NE(key, FreeFallSim::hash_profiles(freefall_sim_obj, freefall_sim_vars, "NewtonGravity+QuadraticDrag"));
+
+    auto sim_vars = freefall_sim_vars;
+    sim_vars.console_output = true;
+    EXPECT_EQ(key, FreeFallSim::hash_profiles(freefall_sim_obj, sim_vars, "ConstantGravity+QuadraticDrag"));
+    sim_vars.velocity = -0.0;
+    EXPECT_EQ(key, FreeFallSim::hash_profiles(freefall_sim_obj, sim_vars, "ConstantGravity+QuadraticDrag"));
+    sim_vars.event_heights = {50.0};
+    EXPECT_NE(key, FreeFallSim::hash_profiles(freefall_sim_obj, sim_vars, "ConstantGravity+QuadraticDrag"));
+    sim_vars = freefall_sim_vars;
+    sim_vars.time_step = 0.002f;
+    EXPECT_NE(key, FreeFallSim::hash_profiles(freefall_sim_obj, sim_vars, "ConstantGravity+QuadraticDrag"));
+    auto sim_obj = freefall_sim_obj;
+    sim_obj.mass_of_object *= 2.0;
+    EXPECT_NE(key, FreeFallSim::hash_profiles(sim_obj, freefall_sim_vars, "ConstantGravity+QuadraticDrag"));
+
+    auto const_sim = make_sim(100);
+    FreeFallSim::FreeFallNewtonGravitySimlation newton_sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    EXPECT_EQ(FreeFallSim::cache_key(const_sim), key);
+    EXPECT_NE(FreeFallSim::cache_key(newton_sim), key);
+}
+
+TEST_F(FreeFallResultCacheTest, GivenRepeatedRunsMemoryTierServesThemAndEvictsLeastRecentlyUsed)
+{
+    auto sim_plot_vars = make_sim(100).run_sim();
+    FreeFallSim::FreeFallCacheOptions options;
+    // room for two 100 m drops, not three
+    options.memory_capacity_bytes = 2 * FreeFallSim::FreeFallCachedTrajectory{sim_plot_vars}.size_bytes() + 64;
+    FreeFallSim::FreeFallResultCache cache{options};
+
+    auto first = make_sim(100);
+    const auto entry = cache.run_sim(first);
+    ASSERT_EQ(entry->size(), sim_plot_vars.time_data.size());
+    EXPECT_FALSE(entry->mapped());
+    EXPECT_EQ(entry->to_plot().position_data, sim_plot_vars.position_data);
+    auto again = make_sim(100);
+    EXPECT_EQ(cache.run_sim(again), entry);
+
+    auto second = make_sim(100.001);
+    auto third = make_sim(100.002);
+    cache.run_sim(second);
+    cache.run_sim(first);
+    cache.run_sim(third);
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.memory_hits, 2u);
+    EXPECT_EQ(stats.misses, 3u);
+    EXPECT_EQ(stats.memory_evictions, 1u);
+    EXPECT_EQ(stats.memory_entries, 2u);
+    EXPECT_LE(stats.memory_bytes, options.memory_capacity_bytes);
+    // the second drop was the least recently used one
+    EXPECT_NE(cache.find(FreeFallSim::cache_key(first)), nullptr);
+    EXPECT_EQ(cache.find(FreeFallSim::cache_key(second)), nullptr);
+}
+
+TEST_F(FreeFallResultCacheTest, GivenCacheDirectoryNewCacheMapsTheFilesOfAnEarlierOne)
+{
+    freefall_sim_vars.event_heights = {50.0};
+    FreeFallSim::FreeFallCacheOptions options;
+    options.directory = cache_directory.string();
+    auto sim = make_sim(100);
+    const auto sim_plot_vars = make_sim(100).run_sim();
+    {
+        FreeFallSim::FreeFallResultCache cache{options};
+        cache.run_sim(sim);
+        EXPECT_EQ(cache.stats().disk_entries, 1u);
+    }
+
+    FreeFallSim::FreeFallResultCache cache{options};
+    EXPECT_EQ(cache.stats().disk_entries, 1u);
+    const auto entry = cache.run_sim(sim);
+    ASSERT_TRUE(entry->mapped());
+    const auto stats = cache.stats();
+    EXPECT_EQ(stats.disk_hits, 1u);
+    EXPECT_EQ(stats.misses, 0u);
+    const auto cached_plot = entry->to_plot();
+    EXPECT_EQ(cached_plot.time_data, sim_plot_vars.time_data);
+    EXPECT_EQ(cached_plot.position_data, sim_plot_vars.position_data);
+    EXPECT_EQ(cached_plot.velocity_data, sim_plot_vars.velocity_data);
+    EXPECT_EQ(cached_plot.netforce_data, sim_plot_vars.netforce_data);
+    ASSERT_EQ(entry->event_count(), sim_plot_vars.events.size());
+    EXPECT_EQ(entry->events()[0].kind, FreeFallSim::FreeFallEventKind::HeightReached);
+    EXPECT_DOUBLE_EQ(entry->events()[0].time, sim_plot_vars.events[0].time);
+    EXPECT_EQ(entry->integrator_stats().steps_taken, sim_plot_vars.integrator_stats.steps_taken);
+    // promoted, the next lookup does not touch the file
+    EXPECT_EQ(cache.run_sim(sim), entry);
+    EXPECT_EQ(cache.stats().memory_hits, 1u);
+}
+
+TEST_F(FreeFallResultCacheTest, GivenDiskCapOldestFilesAreDeleted)
+{
+    const auto file_bytes = FreeFallSim::FreeFallCachedTrajectory{make_sim(100).run_sim()}.size_bytes() + 64;
+    FreeFallSim::FreeFallCacheOptions options;
+    options.directory = cache_directory.string();
+    options.disk_capacity_bytes = 2 * file_bytes + 64;
+    FreeFallSim::FreeFallResultCache cache{options};
+    auto first = make_sim(100);
+    auto second = make_sim(100.001);
+    auto third = make_sim(100.002);
+    cache.run_sim(first);
+    cache.run_sim(second);
+    cache.run_sim(third);
+
+    const auto stats = cache.stats();
+    EXPECT_EQ(stats.disk_evictions, 1u);
+    EXPECT_EQ(stats.disk_entries, 2u);
+    EXPECT_LE(stats.disk_bytes, options.disk_capacity_bytes);
+    EXPECT_EQ(std::distance(std::filesystem::directory_iterator{cache_directory}, std::filesystem::directory_iterator{}), 2);
+
+    cache.clear_memory();
+    EXPECT_EQ(cache.find(FreeFallSim::cache_key(first)), nullptr);
+    EXPECT_NE(cache.find(FreeFallSim::cache_key(third)), nullptr);
+}
+
+TEST_F(FreeFallResultCacheTest, GivenCorruptFileLookupIsAMissAndRerunsTheSimulation)
+{
+    FreeFallSim::FreeFallCacheOptions options;
+    options.directory = cache_directory.string();
+    auto sim = make_sim(100);
+    {
+        FreeFallSim::FreeFallResultCache cache{options};
+        cache.run_sim(sim);
+    }
+    for (const auto& directory_entry : std::filesystem::directory_iterator{cache_directory})
+        std::filesystem::resize_file(directory_entry.path(), directory_entry.file_size() - 8);
+
+    FreeFallSim::FreeFallResultCache cache{options};
+    const auto entry = cache.run_sim(sim);
+    EXPECT_FALSE(entry->mapped());
+    EXPECT_EQ(entry->to_plot().position_data, make_sim(100).run_sim().position_data);
+    const auto stats = cache.stats();
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.disk_hits, 0u);
+    EXPECT_EQ(stats.disk_entries, 1u);
+}
+
+TEST_F(FreeFallResultCacheTest, GivenUnwritableCacheFileResultIsStillReturnedAndFailureCounted)
+{
+    FreeFallSim::FreeFallCacheOptions options;
+    options.directory = cache_directory.string();
+    FreeFallSim::FreeFallResultCache cache{options};
+    auto sim = make_sim(100);
+    // a directory in the way of the cache file makes the rename fail
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(FreeFallSim::cache_key(sim)));
+    const auto blocked = cache_directory / (std::string{name} + ".ffc");
+    std::filesystem::create_directories(blocked / "occupied");
+
+    FreeFallSim::FreeFallResultCache::Entry entry;
+    ASSERT_NO_THROW(entry = cache.run_sim(sim));
+    EXPECT_EQ(entry->to_plot().position_data, make_sim(100).run_sim().position_data);
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.disk_write_failures, 1u);
+    EXPECT_EQ(stats.disk_entries, 0u);
+    EXPECT_EQ(stats.memory_entries, 1u);
+    EXPECT_EQ(cache.run_sim(sim), entry);
+    // no temporary file is left behind
+    EXPECT_EQ(std::distance(std::filesystem::directory_iterator{cache_directory}, std::filesystem::directory_iterator{}), 1);
+}
+
+TEST_F(FreeFallResultCacheTest, GivenConcurrentMissesOfOneKeyEveryWriteSucceeds)
+{
+    FreeFallSim::FreeFallCacheOptions options;
+    options.directory = cache_directory.string();
+    options.memory_capacity_bytes = 0;
+    FreeFallSim::FreeFallResultCache cache{options};
+    const auto sim = make_sim(100);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i)
+        threads.emplace_back([&]() { cache.insert(FreeFallSim::cache_key(sim), make_sim(100).run_sim()); });
+    for (auto& thread : threads)
+        thread.join();
+
+    const auto stats = cache.stats();
+    EXPECT_EQ(stats.insertions, 8u);
+    EXPECT_EQ(stats.disk_write_failures, 0u);
+    EXPECT_EQ(stats.disk_entries, 1u);
+    EXPECT_EQ(std::distance(std::filesystem::directory_iterator{cache_directory}, std::filesystem::directory_iterator{}), 1);
+    const auto entry = cache.find(FreeFallSim::cache_key(sim));
+    ASSERT_NE(entry, nullptr);
+    EXPECT_TRUE(entry->mapped());
+}
+
+TEST_F(FreeFallResultCacheTest, GivenRepeatedSweepOnlyTheFirstOneRuns)
+{
+    FreeFallSim::FreeFallSweepGrid grid;
+    grid.base_obj_profile = freefall_sim_obj;
+    grid.base_sim_profile = freefall_sim_vars;
+    grid.heights = {50, 100};
+    grid.masses = {0.05, 0.1};
+    const auto sim_models = FreeFallSim::expand_sweep_grid(grid);
+    FreeFallSim::FreeFallWorkStealingPool pool{2};
+    FreeFallSim::FreeFallResultCache cache;
+
+    const auto first = FreeFallSim::run_parallel_sweep(sim_models, pool, cache);
+    const auto second = FreeFallSim::run_parallel_sweep(sim_models, pool, cache);
+    const auto sim_plots = FreeFallSim::run_parallel_sweep(sim_models, pool);
+    ASSERT_EQ(second.size(), sim_models.size());
+    for (std::size_t i = 0; i < sim_models.size(); ++i)
+    {
+        EXPECT_EQ(second[i], first[i]);
+        EXPECT_EQ(second[i]->to_plot().position_data, sim_plots[i].position_data);
+    }
+    const auto stats = cache.stats();
+    EXPECT_EQ(stats.misses, sim_models.size());
+    EXPECT_EQ(stats.memory_hits, sim_models.size());
+}
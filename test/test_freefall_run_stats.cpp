@@ -0,0 +1,105 @@
+#include "freefall_parallel_sweep.h"
+#include "freefall_run_stats.h"
+#include "freefall_demo_profiles.h"
+#include <gtest/gtest.h>
+#include <iomanip>
+#include <sstream>
+
+class FreeFallRunStatsTest: public ::testing::Test
+{
+    protected:
+    void SetUp() override
+    {
+        freefall_sim_obj = FreeFallSim::make_demo_ball_profile();
+        freefall_sim_vars = FreeFallSim::make_demo_sim_vars();
+    }
+
+    FreeFallSim::FreeFallObjProfile freefall_sim_obj;
+    FreeFallSim::FreeFallSimulationProfile freefall_sim_vars;
+};
+
+TEST_F(FreeFallRunStatsTest, GivenRunStatsCountersMatchPlainRun)
+{
+    FreeFallSim::FreeFallNewtonGravitySimlation plain_sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    FreeFallSim::FreeFallNewtonGravitySimlation instrumented_sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    const auto plain_plot = plain_sim.run_sim();
+    FreeFallSim::FreeFallRunStats run_stats;
+    const auto instrumented_plot = instrumented_sim.run_sim(run_stats);
+
+    EXPECT_EQ(instrumented_plot.position_data, plain_plot.position_data);
+    EXPECT_EQ(run_stats.name, "NewtonGravitationModel");
+    EXPECT_EQ(run_stats.steps, plain_plot.integrator_stats.steps_taken);
+    EXPECT_EQ(run_stats.samples, instrumented_plot.time_data.size());
+    EXPECT_GE(run_stats.peak_trajectory_bytes, 4 * run_stats.samples * sizeof(double));
+    // the run reserves from the impact estimate, the columns never grow mid run
+    EXPECT_EQ(run_stats.reallocations, 0u);
+    EXPECT_GT(run_stats.wall_time_s, 0.0);
+    EXPECT_NEAR(run_stats.integration_time_s + run_stats.output_time_s, run_stats.wall_time_s, 1e-9);
+}
+
+TEST_F(FreeFallRunStatsTest, GivenUnreservedSinkReallocationsAreCounted)
+{
+    // a sink ignoring the size hint grows by doubling
+    class UnreservedSink : public FreeFallSim::FreeFallTrajectorySink
+    {
+        public:
+        void write(double time, double, double, double) override { m_time.push_back(time); }
+        std::size_t buffered_bytes() const override { return m_time.capacity() * sizeof(double); }
+
+        private:
+        std::vector<double> m_time;
+    };
+
+    freefall_sim_vars.sampling = FreeFallSim::SamplingProfile::TimeInterval;
+    freefall_sim_vars.sample_interval = 0.01;
+    FreeFallSim::FreeFallConstGravitySimlation const_gravity_sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    UnreservedSink unreserved_sink;
+    FreeFallSim::FreeFallRunStats run_stats;
+    const_gravity_sim.run_sim(unreserved_sink, run_stats);
+    EXPECT_GT(run_stats.reallocations, 5u);
+    EXPECT_EQ(run_stats.peak_trajectory_bytes, unreserved_sink.buffered_bytes());
+}
+
+TEST_F(FreeFallRunStatsTest, GivenSweepRunStatsChromeTraceHasOneEventPerRun)
+{
+    std::vector<FreeFallSim::FreeFallSimModels> sim_models;
+    for (const auto height : {40.0, 400.0, 1000.0})
+    {
+        freefall_sim_vars.position = height;
+        sim_models.emplace_back(FreeFallSim::FreeFallConstGravitySimlation{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}});
+    }
+    FreeFallSim::FreeFallWorkStealingPool pool{2};
+    std::vector<FreeFallSim::FreeFallRunStats> run_stats;
+    const auto sim_plots = FreeFallSim::run_parallel_sweep(sim_models, pool, run_stats);
+    ASSERT_EQ(run_stats.size(), sim_models.size());
+    for (std::size_t i = 0; i < run_stats.size(); ++i)
+    {
+        EXPECT_EQ(run_stats[i].name, "sweep[" + std::to_string(i) + "]");
+        EXPECT_EQ(run_stats[i].samples, sim_plots[i].time_data.size());
+    }
+
+    run_stats[0].name = "quoted \"name\"";
+    std::ostringstream trace;
+    FreeFallSim::write_chrome_trace(trace, run_stats);
+    const auto json = trace.str();
+    EXPECT_EQ(json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0), 0u);
+    std::size_t events{0};
+    for (auto found = json.find("\"ph\":\"X\""); found != std::string::npos; found = json.find("\"ph\":\"X\"", found + 1))
+        ++events;
+    EXPECT_EQ(events, run_stats.size());
+    EXPECT_NE(json.find("quoted \\\"name\\\""), std::string::npos);
+
+    // the caller's formatting survives the trace, also the fill of the \u escapes
+    run_stats[0].name = "tab\x01";
+    std::ostringstream mixed;
+    mixed<< std::setprecision(2)<< std::setfill('*');
+    const auto flags = mixed.flags();
+    FreeFallSim::write_chrome_trace(mixed, run_stats);
+    EXPECT_NE(mixed.str().find("tab\\u0001"), std::string::npos);
+    EXPECT_EQ(mixed.flags(), flags);
+    EXPECT_EQ(mixed.precision(), 2);
+    EXPECT_EQ(mixed.fill(), '*');
+    mixed.str("");
+    mixed<< std::setw(4)<< 1.2345;
+    EXPECT_EQ(mixed.str(), "*1.2");
+}
@@ -0,0 +1,136 @@
+#include "freefall_dragforce_simulation.h"
+#include "freefall_analytic_solution.h"
+#include "freefall_downsampling.h"
+#include "freefall_demo_profiles.h"
+#include <gtest/gtest.h>
+#include <cmath>
+
+class FreeFallSamplingTest: public ::testing::Test
+{
+    protected:
+    void SetUp() override
+    {
+        freefall_sim_obj = FreeFallSim::make_demo_ball_profile();
+        freefall_sim_vars = FreeFallSim::make_demo_sim_vars();
+    }
+
+    FreeFallSim::FreeFallObjProfile freefall_sim_obj;
+    FreeFallSim::FreeFallSimulationProfile freefall_sim_vars;
+};
+
+TEST_F(FreeFallSamplingTest, GivenTimeIntervalSamplesLandOnExactMultiples)
+{
+    freefall_sim_vars.sampling = FreeFallSim::SamplingProfile::TimeInterval;
+    freefall_sim_vars.sample_interval = 0.25;
+    const FreeFallSim::FreeFallConstGravityAnalytic analytic{freefall_sim_obj, freefall_sim_vars};
+
+    for (const auto integrator : {FreeFallSim::IntegratorProfile::FixedStep, FreeFallSim::IntegratorProfile::DormandPrince45,
+        FreeFallSim::IntegratorProfile::ClosedForm})
+    {
+        auto sim_vars = freefall_sim_vars;
+        sim_vars.integrator = integrator;
+        FreeFallSim::FreeFallConstGravitySimlation const_gravity_sim{freefall_sim_obj, sim_vars, FreeFallSim::FreeFallSimPlot{}};
+        const auto sim_plot = const_gravity_sim.run_sim();
+
+        // the fixed step scheme is first order, its trajectory drifts by a few centimetres over the drop
+        const auto tolerance = integrator == FreeFallSim::IntegratorProfile::FixedStep ? 1e-1 : 1e-3;
+        const auto impact_time = analytic.impact().time;
+        ASSERT_GE(sim_plot.time_data.size(), static_cast<std::size_t>(impact_time / 0.25));
+        // every sample but the final state sits on a multiple of the interval
+        for (std::size_t i = 0; i + 1 < sim_plot.time_data.size(); ++i)
+        {
+            EXPECT_DOUBLE_EQ(sim_plot.time_data[i], i * 0.25);
+            const auto state = analytic.state_at(sim_plot.time_data[i]);
+            EXPECT_NEAR(sim_plot.position_data[i], state.position, tolerance);
+            EXPECT_NEAR(sim_plot.velocity_data[i], -state.velocity, tolerance);
+        }
+        EXPECT_NEAR(sim_plot.time_data.back(), impact_time, 2.0 * freefall_sim_vars.time_step);
+        EXPECT_NEAR(sim_plot.position_data.back(), 0.0, 0.5);
+    }
+}
+
+TEST_F(FreeFallSamplingTest, GivenMaxPointsBudgetIsKeptAndFlightIsCovered)
+{
+    freefall_sim_vars.sampling = FreeFallSim::SamplingProfile::MaxPoints;
+    freefall_sim_vars.max_points = 50;
+
+    FreeFallSim::FreeFallConstGravitySimlation const_gravity_sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    FreeFallSim::FreeFallNewtonGravitySimlation newton_gravity_sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    for (const auto& sim_plot : {const_gravity_sim.run_sim(), newton_gravity_sim.run_sim()})
+    {
+        ASSERT_LE(sim_plot.time_data.size(), freefall_sim_vars.max_points);
+        EXPECT_GE(sim_plot.time_data.size(), freefall_sim_vars.max_points - 1);
+        EXPECT_DOUBLE_EQ(sim_plot.time_data.front(), 0.0);
+        EXPECT_NEAR(sim_plot.position_data.back(), 0.0, 0.5);
+    }
+}
+
+TEST_F(FreeFallSamplingTest, GivenReleaseAboveTerminalVelocityMaxPointsStillRecordsImpact)
+{
+    // thrown down faster than terminal velocity the drag slows the ball and it lands after the estimate
+    freefall_sim_vars.position = 100;
+    freefall_sim_vars.velocity = 60;
+    freefall_sim_vars.sampling = FreeFallSim::SamplingProfile::TimeInterval;
+    freefall_sim_vars.sample_interval = 0.01;
+    FreeFallSim::FreeFallConstGravitySimlation reference_sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    const auto reference = reference_sim.run_sim();
+
+    freefall_sim_vars.sampling = FreeFallSim::SamplingProfile::MaxPoints;
+    freefall_sim_vars.max_points = 10;
+    FreeFallSim::FreeFallConstGravitySimlation const_gravity_sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    const auto sim_plot = const_gravity_sim.run_sim();
+    ASSERT_LE(sim_plot.time_data.size(), freefall_sim_vars.max_points);
+    EXPECT_DOUBLE_EQ(sim_plot.position_data.back(), reference.position_data.back());
+    EXPECT_NEAR(sim_plot.position_data.back(), 0.0, 0.5);
+    EXPECT_DOUBLE_EQ(sim_plot.time_data.back(), reference.time_data.back());
+}
+
+TEST_F(FreeFallSamplingTest, GivenNewtonModelImpactEstimateIsUpperBound)
+{
+    FreeFallSim::FreeFallNewtonGravitySimlation newton_gravity_sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    const auto estimate = FreeFallSim::estimate_impact_time(freefall_sim_obj, freefall_sim_vars,
+        FreeFallSim::GravityProfile::NewtonGravitationModel);
+    FreeFallSim::FreeFallStatsSink stats_sink;
+    const auto integrator_stats = newton_gravity_sim.run_sim(stats_sink);
+    const auto impact_time = integrator_stats.steps_taken * static_cast<double>(freefall_sim_vars.time_step);
+    EXPECT_GE(estimate + freefall_sim_vars.time_step, impact_time);
+    EXPECT_NEAR(estimate, impact_time, 1e-2 * impact_time);
+
+    freefall_sim_vars.finish_time = 3;
+    EXPECT_DOUBLE_EQ(FreeFallSim::estimate_impact_time(freefall_sim_obj, freefall_sim_vars,
+        FreeFallSim::GravityProfile::ConstantGravity), 3.0);
+}
+
+TEST_F(FreeFallSamplingTest, GivenFinishTimeRunStopsAtRealElapsedTime)
+{
+    freefall_sim_vars.sampling = FreeFallSim::SamplingProfile::TimeInterval;
+    freefall_sim_vars.sample_interval = 0.5;
+    freefall_sim_vars.finish_time = 2;
+    FreeFallSim::FreeFallConstGravitySimlation const_gravity_sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    const auto sim_plot = const_gravity_sim.run_sim();
+    // samples up to finish_time plus the state of the step which reached it
+    ASSERT_GE(sim_plot.time_data.size(), 5u);
+    EXPECT_DOUBLE_EQ(sim_plot.time_data[4], 2.0);
+    EXPECT_NEAR(sim_plot.time_data.back(), 2.0, freefall_sim_vars.time_step);
+}
+
+TEST(FreeFallDownsamplingTest, GivenSeriesLttbKeepsEndpointsAndPeak)
+{
+    std::vector<double> x;
+    std::vector<double> y;
+    for (int i = 0; i < 1001; ++i)
+    {
+        x.push_back(i);
+        y.push_back(i == 537 ? 100.0 : std::sin(i * 0.01));
+    }
+    const auto indices = FreeFallSim::lttb_indices(x, y, 40);
+    ASSERT_EQ(indices.size(), 40u);
+    EXPECT_EQ(indices.front(), 0u);
+    EXPECT_EQ(indices.back(), 1000u);
+    EXPECT_TRUE(std::is_sorted(indices.begin(), indices.end()));
+    EXPECT_NE(std::find(indices.begin(), indices.end(), 537u), indices.end());
+
+    const auto reduced = FreeFallSim::lttb_downsample(x, y, 0);
+    EXPECT_EQ(reduced.x, x);
+    EXPECT_EQ(FreeFallSim::lttb_downsample(x, y, 2000).y.size(), y.size());
+}
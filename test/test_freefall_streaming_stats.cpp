@@ -0,0 +1,114 @@
+#include "freefall_streaming_stats.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace
+{
+    std::vector<double> make_values(std::size_t count, unsigned seed)
+    {
+        std::mt19937_64 generator{seed};
+        std::lognormal_distribution<double> value{1.0, 0.75};
+        std::vector<double> values(count);
+        for (auto& entry : values)
+            entry = value(generator);
+        return values;
+    }
+}
+
+TEST(FreeFallStreamingStatsTest, GivenSplitInputMergedWelfordMatchesTwoPassStatistics)
+{
+    const auto values = make_values(10000, 3);
+    FreeFallSim::FreeFallWelford whole;
+    FreeFallSim::FreeFallWelford first_part;
+    FreeFallSim::FreeFallWelford second_part;
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        whole.add(values[i]);
+        (i < 3000 ? first_part : second_part).add(values[i]);
+    }
+    first_part.merge(second_part);
+
+    double mean{0.0};
+    for (const auto value : values)
+        mean += value;
+    mean /= static_cast<double>(values.size());
+    double squares{0.0};
+    for (const auto value : values)
+        squares += (value - mean) * (value - mean);
+    const auto variance = squares / static_cast<double>(values.size() - 1);
+
+    for (const auto* stats : {&whole, &first_part})
+    {
+        EXPECT_EQ(stats->count(), values.size());
+        EXPECT_NEAR(stats->mean(), mean, 1e-12 * mean);
+        EXPECT_NEAR(stats->variance(), variance, 1e-10 * variance);
+        EXPECT_EQ(stats->min(), *std::min_element(values.begin(), values.end()));
+        EXPECT_EQ(stats->max(), *std::max_element(values.begin(), values.end()));
+    }
+}
+
+TEST(FreeFallStreamingStatsTest, GivenQuantileSketchEveryQuantileIsWithinTheRelativeAccuracy)
+{
+    auto values = make_values(20000, 5);
+    FreeFallSim::FreeFallQuantileSketch whole{0.01};
+    FreeFallSim::FreeFallQuantileSketch first_part{0.01};
+    FreeFallSim::FreeFallQuantileSketch second_part{0.01};
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        whole.add(values[i]);
+        (i % 3 == 0 ? first_part : second_part).add(values[i]);
+    }
+    first_part.merge(second_part);
+    std::sort(values.begin(), values.end());
+
+    for (const auto q : {0.0, 0.01, 0.1, 0.5, 0.9, 0.99, 1.0})
+    {
+        const auto exact = values[static_cast<std::size_t>(q * static_cast<double>(values.size() - 1))];
+        EXPECT_NEAR(whole.quantile(q) / exact, 1.0, 0.01) << q;
+        EXPECT_EQ(first_part.quantile(q), whole.quantile(q)) << q;
+    }
+    EXPECT_EQ(first_part.count(), values.size());
+    // O(log(max/min) / a) buckets, not O(count)
+    EXPECT_LT(whole.bucket_count(), 1000u);
+    EXPECT_THROW(whole.merge(FreeFallSim::FreeFallQuantileSketch{0.02}), std::invalid_argument);
+}
+
+TEST(FreeFallStreamingStatsTest, GivenBucketCapLowestBucketsFoldAndHighQuantilesStayAccurate)
+{
+    FreeFallSim::FreeFallQuantileSketch sketch{0.01, 64};
+    for (int exponent = -6; exponent <= 6; ++exponent)
+        for (int i = 0; i < 100; ++i)
+            sketch.add(std::pow(10.0, exponent) * (1.0 + 0.001 * i));
+    sketch.add(0.0);
+    EXPECT_LE(sketch.bucket_count(), 64u);
+    EXPECT_EQ(sketch.count(), 1301u);
+    EXPECT_EQ(sketch.quantile(0.0), 0.0);
+    EXPECT_NEAR(sketch.quantile(1.0) / 1.099e6, 1.0, 0.01);
+}
+
+TEST(FreeFallStreamingStatsTest, GivenEnvelopeEveryRunCountsOncePerBin)
+{
+    FreeFallSim::FreeFallTimeEnvelope envelope{0.5, 2.0};
+    ASSERT_EQ(envelope.size(), 5u);
+    FreeFallSim::FreeFallTimeEnvelope other{0.5, 2.0};
+    for (int run = 0; run < 4; ++run)
+    {
+        auto& target = run < 2 ? envelope : other;
+        target.begin_run();
+        // sampled every 0.1 s, landing after 0.6 s for the first run and 1.2 s for the others
+        const auto landing = run == 0 ? 0.6 : 1.2;
+        for (int step = 0; step * 0.1 <= landing + 1e-12; ++step)
+            target.add(step * 0.1, 10.0 - run - step * 0.1, -step * 0.1);
+    }
+    envelope.merge(other);
+
+    EXPECT_EQ(envelope[0].position.count(), 4u);
+    EXPECT_DOUBLE_EQ(envelope[0].position.mean(), 10.0 - 1.5);
+    EXPECT_EQ(envelope[1].position.count(), 4u);
+    EXPECT_EQ(envelope[2].position.count(), 3u);
+    EXPECT_EQ(envelope[3].position.count(), 0u);
+    EXPECT_DOUBLE_EQ(envelope.bin_time(2), 1.0);
+    EXPECT_THROW(envelope.merge(FreeFallSim::FreeFallTimeEnvelope{0.25, 2.0}), std::invalid_argument);
+}
@@ -0,0 +1,102 @@
+#include "freefall_trajectory_sink.h"
+#include "freefall_demo_profiles.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+class FreeFallTrajectorySinkTest: public ::testing::Test
+{
+    protected:
+    void SetUp() override
+    {
+        freefall_sim_obj = FreeFallSim::make_demo_ball_profile();
+        freefall_sim_vars = FreeFallSim::make_demo_sim_vars();
+    }
+
+    FreeFallSim::FreeFallSimPlot reference_plot() const
+    {
+        FreeFallSim::FreeFallNewtonGravitySimlation sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+        return sim.run_sim();
+    }
+
+    FreeFallSim::FreeFallObjProfile freefall_sim_obj;
+    FreeFallSim::FreeFallSimulationProfile freefall_sim_vars;
+};
+
+TEST_F(FreeFallTrajectorySinkTest, GivenStatsSinkSummaryMatchesPlotData)
+{
+    const auto sim_plot = reference_plot();
+    FreeFallSim::FreeFallNewtonGravitySimlation sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    FreeFallSim::FreeFallStatsSink stats_sink;
+    const auto stats = sim.run_sim(stats_sink);
+
+    EXPECT_EQ(stats_sink.sample_count(), sim_plot.time_data.size());
+    EXPECT_EQ(stats_sink.last_position(), sim_plot.position_data.back());
+    EXPECT_EQ(stats_sink.last_velocity(), sim_plot.velocity_data.back());
+    EXPECT_EQ(stats.steps_taken, sim_plot.integrator_stats.steps_taken);
+}
+
+TEST_F(FreeFallTrajectorySinkTest, GivenRingBufferSinkOnlyLatestSamplesAreKept)
+{
+    const auto sim_plot = reference_plot();
+    FreeFallSim::FreeFallNewtonGravitySimlation sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+    FreeFallSim::FreeFallRingBufferSink ring_sink{16};
+    sim.run_sim(ring_sink);
+
+    ASSERT_GT(sim_plot.time_data.size(), 16u);
+    EXPECT_EQ(ring_sink.total_samples(), sim_plot.time_data.size());
+    const auto latest = ring_sink.to_plot();
+    ASSERT_EQ(latest.position_data.size(), 16u);
+    const auto offset = sim_plot.position_data.size() - 16;
+    for (std::size_t i = 0; i < 16; ++i)
+        EXPECT_EQ(latest.position_data[i], sim_plot.position_data[offset + i]);
+}
+
+TEST_F(FreeFallTrajectorySinkTest, GivenBinaryFileSinkTrajectoryRoundTrips)
+{
+    const auto sim_plot = reference_plot();
+    const std::string path = ::testing::TempDir() + "freefall_trajectory_sink_test.fftrj";
+    {
+        FreeFallSim::FreeFallNewtonGravitySimlation sim{freefall_sim_obj, freefall_sim_vars, FreeFallSim::FreeFallSimPlot{}};
+        // small blocks so the file holds several of them
+        FreeFallSim::FreeFallBinaryFileSink file_sink{path, 7};
+        sim.run_sim(file_sink);
+        EXPECT_EQ(file_sink.sample_count(), sim_plot.time_data.size());
+    }
+    const auto loaded = FreeFallSim::read_binary_trajectory(path);
+    EXPECT_EQ(loaded.time_data, sim_plot.time_data);
+    EXPECT_EQ(loaded.position_data, sim_plot.position_data);
+    EXPECT_EQ(loaded.velocity_data, sim_plot.velocity_data);
+    EXPECT_EQ(loaded.netforce_data, sim_plot.netforce_data);
+    std::remove(path.c_str());
+}
+
+TEST_F(FreeFallTrajectorySinkTest, GivenHeaderCountBeyondFileSizeReadThrowsBeforeAllocating)
+{
+    const std::string path = ::testing::TempDir() + "freefall_trajectory_sink_corrupt.fftrj";
+    {
+        FreeFallSim::FreeFallBinaryFileSink file_sink{path, 4};
+        for (int i = 0; i < 10; ++i)
+            file_sink.write(0.1 * i, 10.0 - i, -1.0 * i, 0.5);
+    }
+    ASSERT_EQ(FreeFallSim::read_binary_trajectory(path).time_data.size(), 10u);
+
+    // sample_count follows magic, version and block_capacity
+    std::FILE* file = std::fopen(path.c_str(), "r+b");
+    ASSERT_NE(file, nullptr);
+    const std::uint64_t huge_count{std::uint64_t{1} << 60};
+    std::fseek(file, 16, SEEK_SET);
+    std::fwrite(&huge_count, sizeof(huge_count), 1, file);
+    std::fclose(file);
+    EXPECT_THROW(FreeFallSim::read_binary_trajectory(path), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+TEST_F(FreeFallTrajectorySinkTest, GivenConsoleSinkLinesFollowLegacyFormat)
+{
+    std::ostringstream output;
+    FreeFallSim::FreeFallConsoleSink console_sink{output};
+    console_sink.write(1.5, 390.0, -12.3456, 0.12344);
+    EXPECT_EQ(output.str(), "Time: 1.5 Height: 390 NetForce: 0.1234 Velocity: 12.346 \n");
+}